@@ -20,8 +20,11 @@
 #include "storage/FileSystem.h"
 #include "storage/PasscodeRepository.h"
 #include "utils/CommandQueue.h"
+#include "utils/HeapMonitor.h"
 #include "utils/JsonUtils.h"
 #include "utils/Logger.h"
+#include "utils/Profiler.h"
+#include "utils/Scheduler.h"
 #include "utils/TimeUtils.h"
 #include "utils/WatchdogManager.h"
 
@@ -34,7 +37,7 @@ class AppImpl
 {
   public:
     AppImpl()
-        : publish_(appState_, passRepo_, cardRepo_), 
+        : publish_(appState_, passRepo_, cardRepo_, lockConfig_),
         ctx_{appState_, publish_},
           door_(
               lockServo_, LED_PIN, SERVO_PIN, DOOR_CONTACT_PIN,
@@ -54,29 +57,34 @@ class AppImpl
     begin()
     {
         Logger::begin(115200);
-        Logger::info("APP", "Smart Lock Starting...");
+        LOG_I("APP", "Smart Lock Starting...");
+
+        HeapMonitor::begin();
 
         WatchdogManager::begin(30);
-        Logger::info("APP", "Watchdog enabled (30s)");
+        LOG_I("APP", "Watchdog enabled (30s)");
 
         FileSystem::begin();
 
         if (lockConfig_.loadFromFile())
         {
-            Logger::info("APP", "Lock config loaded");
+            LOG_I("APP", "Lock config loaded");
         }
         else
         {
-            Logger::warn("APP", "Lock config missing, saving defaults");
+            LOG_W("APP", "Lock config missing, saving defaults");
             lockConfig_.saveToFile();
         }
 
+        publish_.begin();
+
         configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
 
         WiFi.mode(WIFI_STA);
         delay(100);
 
         appState_.init(WiFi.macAddress());
+        appState_.wireFormat = lockConfig_.wireFormat;
 
         const bool hasConfig = cfgMgr_.load();
         setBaseTopicFromConfigOrDefault_();
@@ -91,19 +99,21 @@ class AppImpl
 
         if (!hasConfig || !cfgMgr_.isProvisioned())
         {
-            Logger::warn("APP", "Not provisioned -> BLE mode");
+            LOG_W("APP", "Not provisioned -> BLE mode");
             ble_.begin();
         }
         else
         {
-            Logger::info("APP", "Provisioned -> Network mode");
+            LOG_I("APP", "Provisioned -> Network mode");
 
             const String clientId = "ESP32DoorLock-" + appState_.macAddress;
             NetworkManager::begin(cfgMgr_.get(), clientId);
             mqtt_.attachCallback();
         }
 
-        Logger::info("APP", "Initialization complete");
+        scheduleTasks_();
+
+        LOG_I("APP", "Initialization complete");
         WatchdogManager::feed();
     }
 
@@ -112,44 +122,10 @@ class AppImpl
     {
         WatchdogManager::feed();
 
-        processCommandQueue_();
-
-        handleWifiProvisionValidation_();
-
-        NetworkManager::loop();
-
-        door_.loop(ctx_);
-
-        if (appState_.wifiProvision.waitingForConnection &&
-        WiFi.status() == WL_CONNECTED)
-        {
-            Logger::info("APP", "Sending information for client...");
-            
-            ble_.notifyProvisionSuccess();
-
-            Logger::info("APP", "WiFi provision successful! Restarting...");
-
-            appState_.wifiProvision.reset();
-            ble_.forceCleanup();
-            delay(1000);
-            ESP.restart();
-            return;
-        }
-
-        const bool isConnected = MqttManager::connected();
-        if (isConnected && !wasConnected_)
-        {
-            mqtt_.onConnected(/*infoVersion=*/3);
-        }
-        wasConnected_ = isConnected;
-
-        keypad_.loop();
-        rfid_.loop();
+        sched_.runDue();
+        publish_.flush();
 
-        serviceTempPasscodeExpiry_();
-        monitorSystemHealth_();
-
-        yield();
+        sched_.sleep();
     }
 
     void
@@ -168,13 +144,13 @@ class AppImpl
 
         appState_.wifiProvision.recordAttempt();
         
-        Logger::warn("APP", "WiFi connection attempt %d/%d failed", 
+        LOG_W("APP", "WiFi connection attempt %d/%d failed", 
                     appState_.wifiProvision.connectionAttempts,
                     WifiProvisionState::MAX_ATTEMPTS);
 
         if (appState_.wifiProvision.hasExceededMaxAttempts())
         {
-            Logger::error("APP", "WiFi provision failed. Clearing WiFi config...");
+            LOG_E("APP", "WiFi provision failed. Clearing WiFi config...");
             
             AppConfig cfg = cfgMgr_.get();
             cfg.clear(AppConfig::ClearMode::WIFI_ONLY);
@@ -184,11 +160,85 @@ class AppImpl
             
             ble_.notifyProvisionFailed("WiFi connection failed after 5 attempts");
             
-            Logger::info("APP", "BLE mode active - waiting for new WiFi credentials");
+            LOG_I("APP", "BLE mode active - waiting for new WiFi credentials");
         }
     }
 
   private:
+    // Periods are the slowest each job can run without adding latency; keys,
+    // reader IRQs, inbound MQTT and commands also wake the loop directly.
+    void
+    scheduleTasks_()
+    {
+        sched_.begin();
+
+        sched_.on("commands", WakeEvent::COMMAND, [this] { processCommandQueue_(); });
+        sched_.every("commands", 250, [this] { processCommandQueue_(); });
+
+        sched_.every("provision", 200, [this] { serviceWifiProvision_(); });
+
+        sched_.on("network", WakeEvent::NETWORK, [this] { serviceNetwork_(); });
+        sched_.every("network", 20, [this] { serviceNetwork_(); });
+
+        sched_.every("door", 20, [this] { door_.loop(ctx_); });
+
+        sched_.on("keypad", WakeEvent::KEY, [this] { keypad_.loop(); });
+        sched_.every("keypad", keypad_.backgroundScan() ? 100 : 5, [this] { keypad_.loop(); });
+
+        // Runs at the next IRQ-cycle phase change or 30 ms pass, not on a
+        // fixed tick; a card answering the armed REQA raises RFID.
+        sched_.on("rfid", WakeEvent::RFID, [this] { rfid_.loop(); });
+        sched_.paced(
+            "rfid",
+            [this]
+            {
+                rfid_.loop();
+                return rfid_.msUntilDue();
+            }
+        );
+
+        sched_.every("publish", 20, [this] { publish_.loop(); });
+        sched_.every("expiry", 1000, [this] { servicePasscodeExpiry_(); });
+        sched_.every("health", 30000, [this] { monitorSystemHealth_(); });
+    }
+
+    void
+    serviceNetwork_()
+    {
+        PROFILE_SCOPE(ProfileSection::Network);
+
+        NetworkManager::loop();
+
+        const uint32_t session = MqttManager::sessionCount();
+        if (session != mqttSession_ && MqttManager::connected())
+        {
+            mqttSession_ = session;
+            mqtt_.onConnected(/*infoVersion=*/3);
+        }
+    }
+
+    void
+    serviceWifiProvision_()
+    {
+        PROFILE_SCOPE(ProfileSection::Provision);
+
+        handleWifiProvisionValidation_();
+
+        if (!appState_.wifiProvision.waitingForConnection || WiFi.status() != WL_CONNECTED)
+            return;
+
+        LOG_I("APP", "Sending information for client...");
+
+        ble_.notifyProvisionSuccess();
+
+        LOG_I("APP", "WiFi provision successful! Restarting...");
+
+        appState_.wifiProvision.reset();
+        ble_.forceCleanup();
+        delay(1000);
+        ESP.restart();
+    }
+
     void
     setBaseTopicFromConfigOrDefault_()
     {
@@ -197,26 +247,38 @@ class AppImpl
     }
 
     void
-    serviceTempPasscodeExpiry_()
+    servicePasscodeExpiry_()
     {
-        if (!passRepo_.hasTemp())
-            return;
+        PROFILE_SCOPE(ProfileSection::Expiry);
+
+        const uint64_t now = passRepo_.nowSecondsFallback();
 
-        const Passcode t = passRepo_.getTemp();
-        if (t.isExpired(passRepo_.nowSecondsFallback()))
+        bool tempExpired = false;
+        if (passRepo_.hasTemp() && passRepo_.getTemp().isExpired(now))
         {
             passRepo_.clearTemp();
-            publish_.publishPasscodeList();
+            tempExpired = true;
         }
+
+        const uint32_t rev = passRepo_.rev();
+        const size_t purged = passRepo_.purgeExpired(now);
+
+        // One publish per sweep, however many codes went.
+        if (tempExpired)
+            publish_.publishPasscodeList();
+        else if (purged > 0)
+            publish_.publishPasscodeChanges(rev);
     }
 
     void
     processCommandQueue_()
     {
+        PROFILE_SCOPE(ProfileSection::Commands);
+
         Command cmd;
         while (cmdQueue_.dequeue(cmd))
         {
-            Logger::info("APP", "Command: type=%d src=%s", (int)cmd.type, cmd.source.c_str());
+            LOG_I("APP", "Command: type=%d src=%s", (int)cmd.type, cmd.source.c_str());
 
             if (cmd.type == CommandType::APPLY_CONFIG)
             {
@@ -225,14 +287,14 @@ class AppImpl
 
                 if (!ok)
                 {
-                    Logger::error("APP", "APPLY_CONFIG failed: invalid config");
+                    LOG_E("APP", "APPLY_CONFIG failed: invalid config");
                     continue;
                 }
 
                 const String clientId = "ESP32DoorLock-" + appState_.macAddress;
                 NetworkManager::begin(cfgMgr_.get(), clientId);
                 mqtt_.attachCallback();
-                Logger::info("APP", "APPLY_CONFIG ok -> Network begin");
+                LOG_I("APP", "APPLY_CONFIG ok -> Network begin");
             }
         }
     }
@@ -240,26 +302,17 @@ class AppImpl
     void
     monitorSystemHealth_()
     {
-        static uint32_t lastHealthCheck = 0;
-    if ((uint32_t)(millis() - lastHealthCheck) < 30000)
-        return;
+        PROFILE_SCOPE(ProfileSection::Health);
 
-    lastHealthCheck = millis();
+        HeapMonitor::sample();
+        if (HeapMonitor::evaluate() != HeapVerdict::Restart)
+            return;
 
-    const size_t freeHeap = ESP.getFreeHeap();
-    
-    if (freeHeap < 20000)
-    {
-        Logger::error("APP", "CRITICAL: Low heap %d bytes. Restarting...", (int)freeHeap);
+        // Leave the numbers behind for whoever looks at the restart.
+        LOG_E("APP", "CRITICAL: heap exhausted or fragmented. Restarting...");
+        publish_.publishDiagnostics(false);
         delay(1000);
         ESP.restart();
-        return;
-    }
-    
-    if (freeHeap < 30000)
-    {
-        Logger::warn("APP", "Low heap warning: %d bytes", (int)freeHeap);
-    }
     }
 
   private:
@@ -283,7 +336,8 @@ class AppImpl
     KeypadService keypad_;
     RfidService rfid_;
 
-    bool wasConnected_{false};
+    Scheduler sched_;
+    uint32_t mqttSession_{0};
 };
 
 static AppImpl g_app;
@@ -58,7 +58,7 @@
         pConfig_ = nullptr;
         pNotify_ = nullptr;
         
-        Logger::info("BLE", "Cleanup complete. Free heap: %d", ESP.getFreeHeap());
+        LOG_I("BLE", "Cleanup complete. Free heap: %d", ESP.getFreeHeap());
     }
 
     bool
@@ -80,14 +80,14 @@
     BleProvisionService::ServerCallback::onConnect(BLEServer*)
     {
         svc_.appState_.deviceState.setBleState(true);
-        Logger::info("BLE", "Client connected");
+        LOG_I("BLE", "Client connected");
     }
 
     void
     BleProvisionService::ServerCallback::onDisconnect(BLEServer*)
     {
         svc_.appState_.deviceState.setBleState(false);
-        Logger::info("BLE", "Client disconnected");
+        LOG_I("BLE", "Client disconnected");
 
         BLEAdvertising* adv = BLEDevice::getAdvertising();
         if (adv)
@@ -127,11 +127,11 @@
 
         if (!svc_.cmdQueue_.enqueue(cmd))
         {
-            Logger::error("BLE", "Failed to enqueue APPLY_CONFIG command");
+            LOG_E("BLE", "Failed to enqueue APPLY_CONFIG command");
             return;
         }
         
-        Logger::info("BLE", "WiFi config saved, waiting for connection validation...");
+        LOG_I("BLE", "WiFi config saved, waiting for connection validation...");
     }
 
     void
@@ -1,9 +1,8 @@
 #include "app/services/KeypadService.h"
 
-#include "config/HardwarePins.h"
-#include "models/PasscodeTemp.h"
+#include "models/HashedPasscode.h"
 #include "utils/Logger.h"
-#include "utils/SecureCompare.h"
+#include "utils/Profiler.h"
 #include "utils/TimeUtils.h"
 
 #include <Arduino.h>
@@ -12,16 +11,8 @@
 
 namespace
 {
-static constexpr byte ROWS = 4;
-static constexpr byte COLS = 4;
-
-static char KEYS[ROWS][COLS] = {
-    {'D', 'C', 'B', 'A'}, {'#', '9', '6', '3'}, {'0', '8', '5', '2'}, {'*', '7', '4', '1'}
-};
-
-static byte ROW_PINS[ROWS] = {KEYPAD_ROW_1, KEYPAD_ROW_2, KEYPAD_ROW_3, KEYPAD_ROW_4};
-
-static byte COL_PINS[COLS] = {KEYPAD_COL_1, KEYPAD_COL_2, KEYPAD_COL_3, KEYPAD_COL_4};
+// Key-to-processing latency is summarised after this many keys.
+constexpr uint32_t kLatencyReportKeys = 32;
 } // namespace
 
 KeypadService::KeypadService(
@@ -29,50 +20,52 @@ KeypadService::KeypadService(
     const LockConfig& lockConfig
 )
     : appState_(appState), passRepo_(passRepo), publish_(publish), door_(door),
-      lockConfig_(lockConfig), keypad_(makeKeymap(KEYS), ROW_PINS, COL_PINS, ROWS, COLS)
+      lockConfig_(lockConfig)
 {
 }
 
 void
 KeypadService::begin()
 {
-    Logger::info("KEYPAD", "=== KEYPAD SERVICE INIT ===");
+    LOG_I("KEYPAD", "=== KEYPAD SERVICE INIT ===");
+
+    scanner_.begin();
 
     // ---- Master ----
-    const String master = passRepo_.getMaster();
-    if (!master.isEmpty())
+    if (passRepo_.hasMaster())
     {
-        Logger::info(
-            "KEYPAD",
-            "MASTER PIN loaded: '%s' (len=%u)",
-            master.c_str(),
-            (unsigned)master.length()
-        );
+        LOG_D("KEYPAD", "MASTER PIN loaded");
     }
     else
     {
-        Logger::warn("KEYPAD", "NO MASTER PIN");
+        LOG_W("KEYPAD", "NO MASTER PIN");
     }
 
     // ---- Items (one_time / timed) ----
     const auto& items = passRepo_.listItems();
-    Logger::info("KEYPAD", "PASSCODE ITEMS count=%u", (unsigned)items.size());
+    LOG_I("KEYPAD", "PASSCODE ITEMS count=%u", (unsigned)items.size());
+
+    // The dump prints every item; debug builds only.
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG))
+        return;
 
     const uint64_t now = TimeUtils::nowSeconds();
 
     for (size_t i = 0; i < items.size(); ++i)
     {
-        const Passcode& p = items[i];
+        const HashedPasscode& p = items[i];
+        char id[HashedPasscode::kIdChars + 1];
+        p.formatId(id);
 
         bool expired = p.isExpired(now);
         bool effective = p.isEffective(now);
 
-        Logger::info(
+        LOG_D(
             "KEYPAD",
-            "ITEM[%u]: code='%s' type='%s' effectiveAt=%llu expireAt=%llu effective=%d expired=%d",
+            "ITEM[%u]: id=%s type='%s' effectiveAt=%llu expireAt=%llu effective=%d expired=%d",
             (unsigned)i,
-            p.code.c_str(),
-            p.type.c_str(),
+            id,
+            p.typeName(),
             (unsigned long long)p.effectiveAt,
             (unsigned long long)p.expireAt,
             (int)effective,
@@ -80,83 +73,111 @@ KeypadService::begin()
         );
     }
 
-    Logger::info("KEYPAD", "===========================");
+    LOG_D("KEYPAD", "===========================");
 }
 
 
 bool
-KeypadService::checkPIN_(const String& pin)
+KeypadService::checkPIN_(const PinAuthState::Buffer& pin)
 {
-    Logger::info("KEYPAD", "Checking PIN: %s", pin.c_str());
+    LOG_D("KEYPAD", "Checking PIN (len=%u)", (unsigned)pin.length());
 
     const uint64_t now = passRepo_.nowSecondsFallback();
 
-    const String master = passRepo_.getMaster();
-    if (master.length() >= (size_t)lockConfig_.minPinLength &&
-        SecureCompare::safeEquals(pin, master))
+    if (pin.length() >= (size_t)lockConfig_.minPinLength &&
+        passRepo_.matchesMaster(pin.c_str(), pin.length()))
     {
-        Logger::info("KEYPAD", "PIN matched MASTER");
-        Logger::info("KEYPAD", "UNLOCK by master PIN");
+        LOG_I("KEYPAD", "PIN matched MASTER");
+        LOG_I("KEYPAD", "UNLOCK by master PIN");
         return true;
     }
 
-    if (passRepo_.validateAndConsume(pin, now))
+    const uint32_t rev = passRepo_.rev();
+    if (passRepo_.validateAndConsume(pin.c_str(), pin.length(), now))
     {
-        Logger::info("KEYPAD", "UNLOCK by item PIN");
+        LOG_I("KEYPAD", "UNLOCK by item PIN");
 
-        publish_.publishPasscodeList();
+        publish_.publishPasscodeChanges(rev);
         return true;
     }
 
-    Logger::info("KEYPAD", "PIN mismatch or invalid: %s", pin.c_str());
+    LOG_D("KEYPAD", "PIN mismatch or invalid");
     return false;
 }
 
 void
 KeypadService::loop()
 {
-    if (appState_.pinAuth.isLockedOut())
+    PROFILE_SCOPE(ProfileSection::Keypad);
+
+    scanner_.poll();
+
+    KeyEvent e;
+    while (scanner_.next(e))
     {
-        const char k = keypad_.getKey();
-        if (k)
-        {
-            Logger::info("KEYPAD", "Key '%c' ignored (LOCKOUT)", k);
-        }
-        return;
+        handleKey_(e.key);
+        recordLatency_(e);
     }
+}
 
-    const char k = keypad_.getKey();
-    if (!k)
+bool
+KeypadService::backgroundScan() const
+{
+    return scanner_.timerRunning();
+}
+
+void
+KeypadService::recordLatency_(const KeyEvent& e)
+{
+    latency_.record((uint32_t)(esp_timer_get_time() - e.atUs));
+    if (latency_.total() < kLatencyReportKeys)
         return;
 
+    LOG_I(
+        "KEYPAD", "key latency us: p50<=%u p99<=%u max=%u (n=%u dropped=%u)",
+        (unsigned)latency_.percentileUs(50), (unsigned)latency_.percentileUs(99),
+        (unsigned)latency_.maxUs(), (unsigned)latency_.total(), (unsigned)scanner_.dropped()
+    );
+    latency_.reset();
+}
+
+void
+KeypadService::handleKey_(char k)
+{
+    if (appState_.pinAuth.isLockedOut())
+    {
+        LOG_I("KEYPAD", "Key '%c' ignored (LOCKOUT)", k);
+        return;
+    }
+
     if (k == '*')
     {
-        Logger::info("KEYPAD", "PIN buffer cleared by user");
+        LOG_I("KEYPAD", "PIN buffer cleared by user");
         appState_.pinAuth.clearBuffer();
         return;
     }
 
     if (k == '#')
     {
-        const String pin = appState_.pinAuth.getBuffer();
+        const PinAuthState::Buffer& pin = appState_.pinAuth.getBuffer();
 
-        Logger::info("KEYPAD", "PIN SUBMIT: %s", pin.c_str());
+        LOG_D("KEYPAD", "PIN SUBMIT: %s", pin.c_str());
 
         if ((int)pin.length() < lockConfig_.minPinLength)
         {
-            Logger::info(
-                "KEYPAD", "PIN too short (%d < %d)", pin.length(), lockConfig_.minPinLength
+            LOG_I(
+                "KEYPAD", "PIN too short (%d < %d)", (int)pin.length(), lockConfig_.minPinLength
             );
 
             const bool lockedOut = appState_.pinAuth.recordFailedAttempt(
                 lockConfig_.maxFailedAttempts, lockConfig_.lockoutDurationMs
             );
 
-            Logger::info("KEYPAD", "PIN auth failed (length)");
+            LOG_I("KEYPAD", "PIN auth failed (length)");
 
             if (lockedOut)
             {
-                Logger::info(
+                LOG_I(
                     "KEYPAD", "LOCKOUT triggered (%lds remaining)",
                     appState_.pinAuth.remainingLockoutSeconds()
                 );
@@ -168,13 +189,13 @@ KeypadService::loop()
 
         if (checkPIN_(pin))
         {
-            Logger::info("KEYPAD", "PIN auth SUCCESS");
+            LOG_I("KEYPAD", "PIN auth SUCCESS");
             appState_.pinAuth.recordSuccess();
             door_.requestUnlock("Passcode");
         }
         else
         {
-            Logger::info("KEYPAD", "PIN auth FAILED");
+            LOG_I("KEYPAD", "PIN auth FAILED");
 
             const bool lockedOut = appState_.pinAuth.recordFailedAttempt(
                 lockConfig_.maxFailedAttempts, lockConfig_.lockoutDurationMs
@@ -182,7 +203,7 @@ KeypadService::loop()
 
             if (lockedOut)
             {
-                Logger::info(
+                LOG_I(
                     "KEYPAD", "LOCKOUT triggered (%lds remaining)",
                     appState_.pinAuth.remainingLockoutSeconds()
                 );
@@ -196,9 +217,9 @@ KeypadService::loop()
     if (k >= '0' && k <= '9')
     {
         appState_.pinAuth.appendDigit(k, lockConfig_.maxPinLength);
-        Logger::info("KEYPAD", "Digit appended: %c", k);
+        LOG_D("KEYPAD", "Digit appended: %c", k);
         return;
     }
 
-    Logger::info("KEYPAD", "Non-numeric key ignored: %c", k);
+    LOG_D("KEYPAD", "Non-numeric key ignored: %c", k);
 }
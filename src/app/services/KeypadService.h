@@ -2,11 +2,12 @@
 #include "app/services/PublishService.h"
 #include "config/LockConfig.h"
 #include "hardware/DoorHardware.h"
+#include "hardware/KeypadScanner.h"
 #include "models/AppState.h"
 #include "storage/PasscodeRepository.h"
+#include "utils/LatencyHistogram.h"
 
 #include <Arduino.h>
-#include <Keypad.h>
 
 class KeypadService
 {
@@ -19,12 +20,23 @@ class KeypadService
     void
     begin();
 
+    // Drains the keys queued by the background scanner.
     void
     loop();
 
+    // False when the scan timer could not start and loop() has to scan.
+    bool
+    backgroundScan() const;
+
   private:
+    void
+    handleKey_(char k);
+
+    void
+    recordLatency_(const KeyEvent& e);
+
     bool
-    checkPIN_(const String& pin);
+    checkPIN_(const PinAuthState::Buffer& pin);
 
     AppState& appState_;
     PasscodeRepository& passRepo_;
@@ -32,5 +44,6 @@ class KeypadService
     DoorHardware& door_;
     const LockConfig& lockConfig_;
 
-    Keypad keypad_;
+    KeypadScanner scanner_;
+    LatencyHistogram latency_;
 };
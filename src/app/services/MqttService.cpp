@@ -5,10 +5,11 @@
 #include "app/services/Topics.h"
 #include "models/PasscodeTemp.h"
 #include "network/MqttManager.h"
-#include "utils/JsonUtils.h"
+#include "utils/HeapMonitor.h"
 #include "utils/Logger.h"
 #include "utils/SecureCompare.h"
 #include "utils/TimeUtils.h"
+#include "utils/WireCodec.h"
 
 #include <ArduinoJson.h>
 
@@ -29,24 +30,59 @@ defaultCardNameNext(const CardRepository& repo)
 }
 
 static inline void
-logPayloadTruncated_(const char* tag, const char* prefix, const String& s, unsigned maxShow = 256)
+logPayloadTruncated_(
+    const char* tag, const char* prefix, const uint8_t* payload, size_t length,
+    unsigned maxShow = 256
+)
 {
-    Logger::debug(tag, "%s len=%u", prefix, (unsigned)s.length());
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG))
+        return;
+
+    LOG_D(tag, "%s len=%u", prefix, (unsigned)length);
 
-    if (s.length() <= maxShow)
+    if (WireCodec::detect(payload, length) == WireFormat::MsgPack)
     {
-        Logger::debug(tag, "%s='%s'", prefix, s.c_str());
+        LOG_D(tag, "%s=<msgpack>", prefix);
         return;
     }
 
-    String head = s.substring(0, maxShow);
-    Logger::debug(tag, "%s(head %u)='%s...'", prefix, maxShow, head.c_str());
+    if (length <= maxShow)
+    {
+        LOG_D(tag, "%s='%.*s'", prefix, (int)length, (const char*)payload);
+        return;
+    }
+
+    LOG_D(tag, "%s(head %u)='%.*s...'", prefix, maxShow, (int)maxShow, (const char*)payload);
+}
+
+// FNV-1a; only used to reject non-matching routes before memcmp.
+uint32_t
+topicHash(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Sync requests carry the last revision the client applied: {"since": R}.
+uint32_t
+sinceFromPayload(const uint8_t* payload, size_t length)
+{
+    StaticJsonDocument<64> doc;
+    if (!WireCodec::decode(payload, length, doc))
+        return 0;
+
+    return doc["since"] | 0U;
 }
 
 static inline void
-logSubscribeTopic_(const String& t)
+logSubscribeTopic_(const char* t)
 {
-    Logger::info(TAG_SUB, "subscribe topic=%s", t.c_str());
+    LOG_I(TAG_SUB, "subscribe topic=%s", t);
 }
 } // namespace
 
@@ -54,25 +90,27 @@ MqttService* MqttService::s_instance_ = nullptr;
 
 MqttService::MqttService(
     AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo,
-    PublishService& publish, const LockConfig& lockConfig, DoorHardware& door
+    PublishService& publish, LockConfig& lockConfig, DoorHardware& door
 )
     : appState_(appState), passRepo_(passRepo), cardRepo_(cardRepo), publish_(publish),
-      lockConfig_(lockConfig), door_(door)
+      lockConfig_(lockConfig), door_(door), inbound_(kInboundJsonBytes)
 {
-    Logger::info(
+    LOG_I(
         TAG_DISP,
         "ctor | mqttTopicPrefix='%s' doorName='%s' mac='%s'",
         appState_.mqttTopicPrefix.c_str(),
         appState_.doorName.c_str(),
         appState_.macAddress.c_str()
     );
+
+    buildRoutes_();
 }
 
 void
 MqttService::attachCallback()
 {
     s_instance_ = this;
-    Logger::info(TAG_CB, "attachCallback | instance=%p", (void*)s_instance_);
+    LOG_I(TAG_CB, "attachCallback | instance=%p", (void*)s_instance_);
     MqttManager::setCallback(&MqttService::callbackThunk);
 }
 
@@ -84,7 +122,7 @@ MqttService::onConnected(int infoVersion)
     if (now > 1700000000ULL)
     {
         passRepo_.setTs(now);
-        Logger::info(
+        LOG_I(
             "MQTT",
             "Passcode ts synchronized on connect: %llu",
             (unsigned long long)now
@@ -92,15 +130,15 @@ MqttService::onConnected(int infoVersion)
     }
     else
     {
-        Logger::warn(
+        LOG_W(
             "MQTT",
             "Skip ts sync on connect (invalid time=%llu)",
             (unsigned long long)now
         );
     }
 
-    const String base = appState_.mqttTopicPrefix;
-    Logger::info(
+    const String& base = appState_.mqttTopicPrefix;
+    LOG_I(
         TAG_DISP,
         "connected | base='%s' infoVersion=%d now=%llu",
         base.c_str(),
@@ -108,35 +146,60 @@ MqttService::onConnected(int infoVersion)
         (unsigned long long)TimeUtils::nowSeconds()
     );
 
-    Logger::info(TAG_DISP, "subscribing topics...");
+    LOG_I(TAG_DISP, "subscribing topics...");
 
-    const String tPass = Topics::passcodes(base);
-    const String tPassReq = Topics::passcodesReq(base);
-    const String tCards = Topics::iccards(base);
-    const String tCardsReq = Topics::iccardsReq(base);
-    const String tCtrl = Topics::control(base);
-    const String tBatReq = Topics::batteryReq(base);
-
-    logSubscribeTopic_(tPass);
-    MqttManager::subscribe(tPass, 0);
-
-    logSubscribeTopic_(tPassReq);
-    MqttManager::subscribe(tPassReq, 0);
+    for (const Route& r : routes_)
+    {
+        if (!r.subscribe)
+            continue;
 
-    logSubscribeTopic_(tCards);
-    MqttManager::subscribe(tCards, 0);
+        const Topics::Topic t = Topics::join(base, r.suffix);
+        logSubscribeTopic_(t.c_str());
+        MqttManager::subscribe(t.c_str(), 0);
+    }
 
-    logSubscribeTopic_(tCardsReq);
-    MqttManager::subscribe(tCardsReq, 0);
+    // Tells clients which encoding this session speaks, including one
+    // restored from flash rather than negotiated since boot.
+    publish_.publishInfo(random(20, 100), infoVersion);
 
-    logSubscribeTopic_(tCtrl);
-    MqttManager::subscribe(tCtrl, 0);
+    LOG_I(TAG_DISP, "bootstrap publish deferred");
+    pendingBootstrapPublish_ = true;
+}
 
-    logSubscribeTopic_(tBatReq);
-    MqttManager::subscribe(tBatReq, 0);
+void
+MqttService::buildRoutes_()
+{
+    static const struct
+    {
+        const char* suffix;
+        Handler handler;
+        bool subscribe;
+    } kTable[kRouteCount] = {
+        {Topics::Suffix::PASSCODES, &MqttService::handlePasscodesTopic_, true},
+        {Topics::Suffix::PASSCODES_REQ, &MqttService::handlePasscodesReq_, true},
+        {Topics::Suffix::PASSCODES_SYNC, &MqttService::handlePasscodesSync_, true},
+        {Topics::Suffix::ICCARDS, &MqttService::handleIccardsTopic_, true},
+        {Topics::Suffix::ICCARDS_REQ, &MqttService::handleIccardsReq_, true},
+        {Topics::Suffix::ICCARDS_SYNC, &MqttService::handleIccardsSync_, true},
+        {Topics::Suffix::CONTROL, &MqttService::handleControlTopic_, true},
+        {Topics::Suffix::INFO, &MqttService::handleInfoTopic_, true},
+        {Topics::Suffix::BATTERY_REQ, &MqttService::handleBatteryReq_, true},
+        {Topics::Suffix::DIAGNOSTICS_REQ, &MqttService::handleDiagnosticsReq_, true},
+    };
+
+    for (size_t i = 0; i < kRouteCount; ++i)
+    {
+        const size_t len = strlen(kTable[i].suffix);
+
+        Route& r = routes_[i];
+        r.suffix = kTable[i].suffix;
+        r.handler = kTable[i].handler;
+        r.subscribe = kTable[i].subscribe;
+        r.len = (uint8_t)len;
+        r.hash = topicHash(kTable[i].suffix, len);
+    }
 
-    Logger::info(TAG_DISP, "bootstrap publish deferred");
-    pendingBootstrapPublish_ = true;
+    routesBase_ = appState_.mqttTopicPrefix;
 }
 
 void
@@ -145,82 +208,126 @@ MqttService::callbackThunk(char* topic, byte* payload, unsigned int length)
     if (!s_instance_)
         return;
 
-    const String topicStr(topic);
-
-    String payloadStr;
-    payloadStr.reserve(length);
-    for (unsigned int i = 0; i < length; i++)
-        payloadStr += (char)payload[i];
-
-    Logger::debug(TAG_CB, "RX topic=%s len=%u", topicStr.c_str(), length);
-    logPayloadTruncated_(TAG_CB, "payload", payloadStr);
+    LOG_D(TAG_CB, "RX topic=%s len=%u", topic, length);
+    logPayloadTruncated_(TAG_CB, "payload", payload, length);
 
-    s_instance_->dispatch_(topicStr, payloadStr);
+    s_instance_->dispatch_(topic, payload, length);
 }
 
 void
-MqttService::dispatch_(const String& topicStr, const String& payloadStr)
+MqttService::dispatch_(const char* topic, const uint8_t* payload, size_t length)
 {
-    const String base = appState_.mqttTopicPrefix;
+    HEAP_SCOPE(HeapTag::Mqtt);
 
-    Logger::debug(TAG_DISP, "dispatch | base='%s' topic=%s", base.c_str(), topicStr.c_str());
+    // The prefix can change on APPLY_CONFIG without a reconnect.
+    if (routesBase_ != appState_.mqttTopicPrefix)
+        routesBase_ = appState_.mqttTopicPrefix;
 
-    if (topicStr == Topics::passcodes(base))
-    {
-        Logger::info(TAG_DISP, "route -> passcodes");
-        return handlePasscodesTopic_(payloadStr);
-    }
+    const size_t baseLen = routesBase_.length();
+    const size_t topicLen = strlen(topic);
 
-    if (topicStr == Topics::passcodesReq(base))
-    {
-        Logger::info(TAG_DISP, "route -> passcodesReq (publish list)");
-        return publish_.publishPasscodeList();
-    }
+    LOG_D(TAG_DISP, "dispatch | base='%s' topic=%s", routesBase_.c_str(), topic);
 
-    if (topicStr == Topics::iccards(base))
+    if (topicLen > baseLen && strncmp(topic, routesBase_.c_str(), baseLen) == 0)
     {
-        Logger::info(TAG_DISP, "route -> iccards");
-        return handleIccardsTopic_(payloadStr);
-    }
+        const char* suffix = topic + baseLen;
+        const size_t len = topicLen - baseLen;
+        const uint32_t hash = topicHash(suffix, len);
 
-    if (topicStr == Topics::iccardsReq(base))
-    {
-        Logger::info(TAG_DISP, "route -> iccardsReq (publish list)");
-        return publish_.publishICCardList();
-    }
+        for (const Route& r : routes_)
+        {
+            if (r.len != len || r.hash != hash || memcmp(r.suffix, suffix, len) != 0)
+                continue;
 
-    if (topicStr == Topics::control(base))
-    {
-        Logger::info(TAG_DISP, "route -> control");
-        return handleControlTopic_(payloadStr);
+            LOG_D(TAG_DISP, "route -> %s", r.suffix);
+            return (this->*r.handler)(payload, length);
+        }
     }
-    if (topicStr == Topics::info(base))
-    {
-        Logger::debug(TAG_DISP, "route -> info (ignored)");
-        // ignore
+
+    LOG_W(TAG_DISP, "unhandled topic=%s (base='%s')", topic, routesBase_.c_str());
+    logPayloadTruncated_(TAG_DISP, "unhandledPayload", payload, length);
+}
+
+void
+MqttService::handlePasscodesReq_(const uint8_t*, size_t)
+{
+    publish_.publishPasscodeList();
+}
+
+void
+MqttService::handlePasscodesSync_(const uint8_t* payload, size_t length)
+{
+    publish_.publishPasscodeChanges(sinceFromPayload(payload, length));
+}
+
+void
+MqttService::handleIccardsReq_(const uint8_t*, size_t)
+{
+    publish_.publishICCardList();
+}
+
+void
+MqttService::handleIccardsSync_(const uint8_t* payload, size_t length)
+{
+    publish_.publishICCardChanges(sinceFromPayload(payload, length));
+}
+
+void
+MqttService::handleInfoTopic_(const uint8_t* payload, size_t length)
+{
+    // Clients pick the payload encoding with {"encoding": "json"|"msgpack"}.
+    // Our own info messages echo back here too; they carry "mac" and are
+    // ignored so a stale echo cannot undo a switch.
+    StaticJsonDocument<128> doc;
+    if (!WireCodec::decode(payload, length, doc) || doc.containsKey("mac"))
         return;
-    }
-    if (topicStr == Topics::batteryReq(base))
+
+    WireFormat format;
+    if (!WireCodec::parse(doc["encoding"].as<const char*>(), format))
     {
-        Logger::info(TAG_DISP, "route -> batteryReq (publish battery)");
-        publish_.publishBattery(random(20, 100));
+        LOG_W(TAG_DISP, "info: unknown encoding");
         return;
     }
 
-    Logger::warn(TAG_DISP, "unhandled topic=%s (base='%s')", topicStr.c_str(), base.c_str());
-    logPayloadTruncated_(TAG_DISP, "unhandledPayload", payloadStr);
+    if (format == appState_.wireFormat)
+        return;
+
+    appState_.wireFormat = format;
+    LOG_I(TAG_DISP, "encoding -> %s", WireCodec::name(format));
+
+    lockConfig_.wireFormat = format;
+    if (!lockConfig_.saveToFile())
+        LOG_W(TAG_DISP, "encoding not saved; a reboot restores the previous one");
+}
+
+// {"reset": true} starts a fresh profiling window after this report.
+void
+MqttService::handleDiagnosticsReq_(const uint8_t* payload, size_t length)
+{
+    StaticJsonDocument<64> doc;
+    const bool reset = WireCodec::decode(payload, length, doc) && (doc["reset"] | false);
+
+    publish_.publishDiagnostics(reset);
+}
+
+void
+MqttService::handleBatteryReq_(const uint8_t*, size_t)
+{
+    publish_.publishBattery(random(20, 100));
 }
 
 void
-MqttService::handlePasscodesTopic_(const String& payloadStr)
+MqttService::handlePasscodesTopic_(const uint8_t* payload, size_t length)
 {
-    Logger::info(TAG_PASS, "handlePasscodesTopic_()");
-    logPayloadTruncated_(TAG_PASS, "payload", payloadStr);
+    LOG_D(TAG_PASS, "handlePasscodesTopic_()");
+    logPayloadTruncated_(TAG_PASS, "payload", payload, length);
 
-    DynamicJsonDocument doc(512);
-    if (!JsonUtils::deserialize(payloadStr, doc))
+    JsonArena::Lease lease(inbound_, kInboundJsonBytes);
+
+    JsonDocument& doc = lease.doc();
+    if (!WireCodec::decode(payload, length, doc))
     {
-        Logger::warn(TAG_JSON, "passcodes: JSON deserialize FAILED");
+        LOG_W(TAG_JSON, "passcodes: decode FAILED");
         publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Phân tích dữ liệu thất bại.");
         return;
     }
@@ -228,19 +335,26 @@ MqttService::handlePasscodesTopic_(const String& payloadStr)
     const String action = doc["action"] | "";
     const String type = doc["type"] | "";
     const uint64_t now = passRepo_.nowSecondsFallback();
+    const uint32_t rev = passRepo_.rev();
 
-    Logger::info(TAG_PASS, "parsed | action='%s' type='%s' now=%llu", action.c_str(), type.c_str(), (unsigned long long)now);
+    LOG_D(TAG_PASS, "parsed | action='%s' type='%s' now=%llu", action.c_str(), type.c_str(), (unsigned long long)now);
 
     if (action == "add" && type == "master")
     {
         const String newCode = doc["code"] | "";
-        Logger::info(TAG_PASS, "add master | codeLen=%u", (unsigned)newCode.length());
+        LOG_I(TAG_PASS, "add master | codeLen=%u", (unsigned)newCode.length());
 
-        passRepo_.setMaster(newCode);
+        if (!passRepo_.setMaster(newCode))
+        {
+            publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Lưu Passcode thất bại.");
+            return;
+        }
         passRepo_.setTs((uint64_t)now);
 
-        publish_.publishPasscodeList();
-        publish_.publishLog("MasterCodeAdded", "AppRequest", newCode);
+        publish_.publishPasscodeChanges(rev);
+        // No detail: log events can be spilled to /outbox.bin and resent
+        // after a reboot, so they must never carry the code itself.
+        publish_.publishLog("MasterCodeAdded", "AppRequest", "");
         return;
     }
 
@@ -257,7 +371,7 @@ MqttService::handlePasscodesTopic_(const String& payloadStr)
         t.effectiveAt = effectiveAt;
         t.expireAt = expireAt;
 
-        Logger::info(
+        LOG_I(
             TAG_PASS,
             "add temp | type='%s' codeLen=%u effectiveAt=%llu expireAt=%llu ts=%llu",
             type.c_str(),
@@ -269,7 +383,7 @@ MqttService::handlePasscodesTopic_(const String& payloadStr)
 
         if (expireAt > 0 && now >= expireAt)
         {
-            Logger::warn(TAG_PASS, "expired | now=%llu >= expireAt=%llu", (unsigned long long)now, (unsigned long long)expireAt);
+            LOG_W(TAG_PASS, "expired | now=%llu >= expireAt=%llu", (unsigned long long)now, (unsigned long long)expireAt);
             publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Passcode đã hết hạn.");
             return;
         }
@@ -280,41 +394,50 @@ MqttService::handlePasscodesTopic_(const String& payloadStr)
             return;
         }
 
-        Passcode dummy;
-        if (passRepo_.findItemByCode(t.code, dummy))
+        if (passRepo_.containsCode(t.code))
         {
             publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Passcode đã tồn tại.");
             return;
         }
 
-        passRepo_.addItem(t);
+        if (!passRepo_.addItem(t))
+        {
+            publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Lưu Passcode thất bại.");
+            return;
+        }
         passRepo_.setTs((uint64_t)ts);
 
-        Logger::info(TAG_PASS, "added -> publish list");
-        publish_.publishPasscodeList();
+        LOG_I(TAG_PASS, "added -> publish list");
+        publish_.publishPasscodeChanges(rev);
         publish_.publishLog("PasscodeAdded", "AppRequest", "Thêm Passcode thành công.");
         return;
     }
 
     if (action == "delete")
     {
+        // By code, or by the id published in lists and deltas.
         const String code = doc["code"] | "";
+        const String id = doc["id"] | "";
         const String type = doc["type"] | ""; // one_time | timed
 
-        Logger::info(TAG_PASS, "delete | type='%s' codeLen=%u", type.c_str(), (unsigned)code.length());
+        LOG_I(
+            TAG_PASS, "delete | type='%s' codeLen=%u id='%s'", type.c_str(),
+            (unsigned)code.length(), id.c_str()
+        );
 
         passRepo_.clearTemp();
 
         if (type == "one_time" || type == "timed")
         {
-            const bool removed = passRepo_.removeItemByCode(code);
-            Logger::info(TAG_PASS, "removeItemByCode -> %d", (int)removed);
+            const bool removed = code.isEmpty() ? passRepo_.removeItemById(id.c_str())
+                                                : passRepo_.removeItemByCode(code);
+            LOG_I(TAG_PASS, "removeItem -> %d", (int)removed);
 
             if (removed)
             {
                 passRepo_.setTs((uint64_t)now);
 
-                publish_.publishPasscodeList();
+                publish_.publishPasscodeChanges(rev);
                 publish_.publishLog("PasscodeDeleted", "AppRequest", "Xóa Passcode thành công.");
                 return;
             }
@@ -323,24 +446,26 @@ MqttService::handlePasscodesTopic_(const String& payloadStr)
             return;
         }
 
-        Logger::warn(TAG_PASS, "invalid type for delete: '%s'", type.c_str());
+        LOG_W(TAG_PASS, "invalid type for delete: '%s'", type.c_str());
         publish_.publishLog("HandlePasscodeRequestFailed", "AppRequest", "Loại Passcode không hợp lệ.");
         return;
     }
 
-    Logger::warn(TAG_PASS, "unknown action/type | action='%s' type='%s'", action.c_str(), type.c_str());
+    LOG_W(TAG_PASS, "unknown action/type | action='%s' type='%s'", action.c_str(), type.c_str());
 }
 
 void
-MqttService::handleIccardsTopic_(const String& payloadStr)
+MqttService::handleIccardsTopic_(const uint8_t* payload, size_t length)
 {
-    Logger::info(TAG_CARD, "handleIccardsTopic_()");
-    logPayloadTruncated_(TAG_CARD, "payload", payloadStr);
+    LOG_D(TAG_CARD, "handleIccardsTopic_()");
+    logPayloadTruncated_(TAG_CARD, "payload", payload, length);
+
+    JsonArena::Lease lease(inbound_, kInboundJsonBytes);
 
-    DynamicJsonDocument doc(512);
-    if (!JsonUtils::deserialize(payloadStr, doc))
+    JsonDocument& doc = lease.doc();
+    if (!WireCodec::decode(payload, length, doc))
     {
-        Logger::warn(TAG_JSON, "iccards: JSON deserialize FAILED");
+        LOG_W(TAG_JSON, "iccards: decode FAILED");
         publish_.publishLog("HandleCardFailed", "AppRequest", "Phân tích dữ liệu thất bại.");
         return;
     }
@@ -349,7 +474,9 @@ MqttService::handleIccardsTopic_(const String& payloadStr)
     const String id = doc["uid"] | "";
     const String name = doc["name"] | "";
 
-    Logger::info(TAG_CARD, "parsed | action='%s' uid='%s' nameLen=%u", action.c_str(), id.c_str(), (unsigned)name.length());
+    const uint32_t rev = cardRepo_.rev();
+
+    LOG_D(TAG_CARD, "parsed | action='%s' uid='%s' nameLen=%u", action.c_str(), id.c_str(), (unsigned)name.length());
 
     if (action == "add" && !id.isEmpty())
     {
@@ -361,16 +488,16 @@ MqttService::handleIccardsTopic_(const String& payloadStr)
         if (finalName.isEmpty())
         {
             finalName = defaultCardNameNext(cardRepo_);
-            Logger::info(TAG_CARD, "auto name -> '%s'", finalName.c_str());
+            LOG_I(TAG_CARD, "auto name -> '%s'", finalName.c_str());
         }
 
         const bool ok = cardRepo_.add(uid, finalName);
-        Logger::info(TAG_CARD, "cardRepo_.add(uid=%s, name=%s) -> %d", uid.c_str(), finalName.c_str(), (int)ok);
+        LOG_I(TAG_CARD, "cardRepo_.add(uid=%s, name=%s) -> %d", uid.c_str(), finalName.c_str(), (int)ok);
 
         if (ok)
         {
             cardRepo_.setTs((uint64_t)TimeUtils::nowSeconds());
-            publish_.publishICCardList();
+            publish_.publishICCardChanges(rev);
             publish_.publishLog("CardAdded", "AppRequest", "Thêm Card thành công");
         }
         else
@@ -387,12 +514,12 @@ MqttService::handleIccardsTopic_(const String& payloadStr)
         uid.toUpperCase();
 
         const bool ok = cardRepo_.remove(uid);
-        Logger::info(TAG_CARD, "cardRepo_.remove(uid=%s) -> %d", uid.c_str(), (int)ok);
+        LOG_I(TAG_CARD, "cardRepo_.remove(uid=%s) -> %d", uid.c_str(), (int)ok);
 
         if (ok)
         {
             cardRepo_.setTs((uint64_t)TimeUtils::nowSeconds());
-            publish_.publishICCardList();
+            publish_.publishICCardChanges(rev);
             publish_.publishLog("CardDeleted", "AppRequest", "Xóa Card thành công.");
         }
         return;
@@ -400,44 +527,46 @@ MqttService::handleIccardsTopic_(const String& payloadStr)
 
     if (action == "start_swipe_add")
     {
-        Logger::info(TAG_CARD, "start_swipe_add | timeoutMs=%u", (unsigned)lockConfig_.swipeAddTimeoutMs);
+        LOG_I(TAG_CARD, "start_swipe_add | timeoutMs=%u", (unsigned)lockConfig_.swipeAddTimeoutMs);
         appState_.swipeAdd.start(lockConfig_.swipeAddTimeoutMs);
         appState_.runtimeFlags.swipeAddMode = true;
         return;
     }
 
-    Logger::warn(TAG_CARD, "unknown action or missing uid | action='%s' uid='%s'", action.c_str(), id.c_str());
+    LOG_W(TAG_CARD, "unknown action or missing uid | action='%s' uid='%s'", action.c_str(), id.c_str());
 }
 
 void
-MqttService::handleControlTopic_(const String& payloadStr)
+MqttService::handleControlTopic_(const uint8_t* payload, size_t length)
 {
-    Logger::info(TAG_CTRL, "handleControlTopic_()");
-    logPayloadTruncated_(TAG_CTRL, "payload", payloadStr);
+    LOG_D(TAG_CTRL, "handleControlTopic_()");
+    logPayloadTruncated_(TAG_CTRL, "payload", payload, length);
+
+    JsonArena::Lease lease(inbound_, 256);
 
-    DynamicJsonDocument doc(256);
-    if (!JsonUtils::deserialize(payloadStr, doc))
+    JsonDocument& doc = lease.doc();
+    if (!WireCodec::decode(payload, length, doc))
     {
-        Logger::warn(TAG_JSON, "control: JSON deserialize FAILED");
+        LOG_W(TAG_JSON, "control: decode FAILED");
         publish_.publishLog("HandleControlFailed", "AppRequest", "Yêu cầu điều khiển thất bại.");
         return;
     }
 
     const String action = doc["action"] | "";
-    Logger::info(TAG_CTRL, "parsed | action='%s'", action.c_str());
+    LOG_D(TAG_CTRL, "parsed | action='%s'", action.c_str());
 
     if (action == "unlock")
     {
-        Logger::info(TAG_CTRL, "door requestUnlock(Remote)");
+        LOG_I(TAG_CTRL, "door requestUnlock(Remote)");
         door_.requestUnlock("Remote");
     }
     else if (action == "lock")
     {
-        Logger::info(TAG_CTRL, "door requestLock(Remote)");
+        LOG_I(TAG_CTRL, "door requestLock(Remote)");
         door_.requestLock("Remote");
     }
     else
     {
-        Logger::warn(TAG_CTRL, "unknown action='%s'", action.c_str());
+        LOG_W(TAG_CTRL, "unknown action='%s'", action.c_str());
     }
 }
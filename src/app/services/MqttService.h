@@ -5,6 +5,7 @@
 #include "models/AppState.h"
 #include "storage/CardRepository.h"
 #include "storage/PasscodeRepository.h"
+#include "utils/JsonArena.h"
 
 #include <Arduino.h>
 
@@ -13,7 +14,7 @@ class MqttService
   public:
     MqttService(
         AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo,
-        PublishService& publish, const LockConfig& lockConfig, DoorHardware& door
+        PublishService& publish, LockConfig& lockConfig, DoorHardware& door
     );
 
     void
@@ -26,27 +27,74 @@ class MqttService
     static void
     callbackThunk(char* topic, byte* payload, unsigned int length);
 
+    using Handler = void (MqttService::*)(const uint8_t* payload, size_t length);
+
+    // Inbound topics are matched on the suffix after the cached prefix, by
+    // length and hash first, so routing allocates nothing.
+    struct Route
+    {
+        const char* suffix;
+        Handler handler;
+        bool subscribe;
+        uint8_t len;
+        uint32_t hash;
+    };
+
+    static constexpr size_t kRouteCount = 10;
+    // Largest inbound document (passcode and card requests).
+    static constexpr size_t kInboundJsonBytes = 512;
+
+    void
+    buildRoutes_();
+
+    void
+    dispatch_(const char* topic, const uint8_t* payload, size_t length);
+
+    void
+    handlePasscodesTopic_(const uint8_t* payload, size_t length);
+
+    void
+    handleIccardsTopic_(const uint8_t* payload, size_t length);
+
     void
-    dispatch_(const String& topicStr, const String& payloadStr);
+    handleControlTopic_(const uint8_t* payload, size_t length);
 
     void
-    handlePasscodesTopic_(const String& payloadStr);
+    handlePasscodesReq_(const uint8_t* payload, size_t length);
 
     void
-    handleIccardsTopic_(const String& payloadStr);
+    handlePasscodesSync_(const uint8_t* payload, size_t length);
 
     void
-    handleControlTopic_(const String& payloadStr);
+    handleIccardsReq_(const uint8_t* payload, size_t length);
+
+    void
+    handleIccardsSync_(const uint8_t* payload, size_t length);
+
+    void
+    handleInfoTopic_(const uint8_t* payload, size_t length);
+
+    void
+    handleBatteryReq_(const uint8_t* payload, size_t length);
+
+    void
+    handleDiagnosticsReq_(const uint8_t* payload, size_t length);
 
     AppState& appState_;
     PasscodeRepository& passRepo_;
     CardRepository& cardRepo_;
     PublishService& publish_;
-    const LockConfig& lockConfig_;
+    LockConfig& lockConfig_;
     DoorHardware& door_;
 
     static MqttService* s_instance_;
 
+    Route routes_[kRouteCount];
+    String routesBase_;
+
+    // Inbound requests are decoded in here, one message at a time.
+    JsonArena inbound_;
+
     uint32_t lastOnConnectedMs_ = 0;
     bool pendingBootstrapPublish_ = false;
 };
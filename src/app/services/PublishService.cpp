@@ -1,16 +1,38 @@
 #include "app/services/PublishService.h"
 
 #include "app/services/Topics.h"
-#include "models/PasscodeTemp.h"
+#include "models/HashedPasscode.h"
 #include "network/MqttManager.h"
+#include "utils/HeapMonitor.h"
 #include "utils/JsonUtils.h"
 #include "utils/TimeUtils.h"
 #include "utils/Logger.h"
+#include "utils/Profiler.h"
 
 #include <ArduinoJson.h>
+#include <vector>
 
 namespace
 {
+constexpr const char* TAG = "PUBLISH";
+
+// Snapshot pages are capped by item count, which bounds the document pool
+// and the time one loop() iteration spends serializing, and by encoded size,
+// since most strings are referenced rather than counted in the pool (passcode
+// ids are formatted per entry and copied). Two full pages (list and changes
+// targets) fit the outbound ring together.
+constexpr size_t kSnapshotPageItems = 32;
+constexpr size_t kItemJsonBytes = 136;
+constexpr size_t kPageJsonBytes = 128 + kSnapshotPageItems * kItemJsonBytes;
+constexpr size_t kPageHeaderBytes = 128;
+constexpr size_t kPageMaxBytes = 3072;
+
+// Queued events sent per loop() once the connection is back.
+constexpr size_t kOutboxBatch = 8;
+constexpr size_t kEventJsonBytes = 112;
+
+constexpr size_t kDiagnosticsJsonBytes = 2048;
+
 static String
 defaultCardNameByIndex(size_t idx)
 {
@@ -38,62 +60,292 @@ isBlank(const String& s)
     }
     return true;
 }
+
+// Passcodes go out by id; the repository has no codes to publish.
+void
+putPasscodeId(JsonObject o, const HashedPasscode& p)
+{
+    char id[HashedPasscode::kIdChars + 1];
+    p.formatId(id);
+    o["id"] = id; // char[]: copied
+}
+
+void
+putPasscode(JsonObject o, const HashedPasscode& p)
+{
+    putPasscodeId(o, p);
+    o["type"] = p.typeName();
+    o["effectiveAt"] = (uint64_t)p.effectiveAt;
+    o["expireAt"] = (uint64_t)p.expireAt;
+}
+
+void
+putMaster(JsonObject o, const HashedPasscode& master)
+{
+    putPasscodeId(o, master);
+    o["type"] = "master";
+}
+
+void
+putCard(JsonObject o, const CardItem& c, const String& defaultName)
+{
+    o["uid"] = c.uid.c_str();
+    if (isBlank(c.name))
+        o["name"] = defaultName;
+    else
+        o["name"] = c.name.c_str();
+}
+
+// Batch entry; strings are referenced from the event.
+void
+putEvent(JsonObject o, const OutboxEvent& e)
+{
+    if (e.kind == OutboxEvent::Kind::State)
+    {
+        o["type"] = "state";
+        o["state"] = e.a.c_str();
+        o["source"] = "device";
+        o["method"] = e.b.c_str();
+    }
+    else
+    {
+        o["type"] = "log";
+        o["event"] = e.a.c_str();
+        o["method"] = e.b.c_str();
+        if (!e.c.isEmpty())
+            o["detail"] = e.c.c_str();
+    }
+    o["ts"] = e.ts;
+}
+
+// Encoded size of one page entry, separator included.
+template <typename Put>
+size_t
+entryBytes(WireFormat format, Put put)
+{
+    StaticJsonDocument<kItemJsonBytes> doc;
+    put(doc.to<JsonObject>());
+    return WireCodec::measure(doc, format) + 1;
+}
+
+// Splits `total` entries into pages and records the first entry of each.
+template <typename EntryBytes>
+void
+planPages(std::vector<size_t>& starts, size_t total, EntryBytes entryBytesAt)
+{
+    starts.assign(1, 0);
+
+    size_t count = 0;
+    size_t bytes = kPageHeaderBytes;
+    for (size_t i = 0; i < total; ++i)
+    {
+        const size_t b = entryBytesAt(i);
+        if (count == kSnapshotPageItems || (count > 0 && bytes + b > kPageMaxBytes))
+        {
+            starts.push_back(i);
+            count = 0;
+            bytes = kPageHeaderBytes;
+        }
+        count++;
+        bytes += b;
+    }
+}
+
+void
+putPageHeader(
+    JsonDocument& doc, uint64_t ts, uint32_t rev, uint32_t id, size_t page, size_t pages
+)
+{
+    doc[AppJsonKeys::TS] = ts;
+    doc["rev"] = rev;
+    doc["snapshot"] = id;
+    doc["page"] = page;
+    doc["pages"] = pages;
+}
 } // namespace
 
 PublishService::PublishService(
-    AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo
+    AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo,
+    const LockConfig& lockConfig
 )
-    : appState_(appState), passRepo_(passRepo), cardRepo_(cardRepo)
+    : appState_(appState), passRepo_(passRepo), cardRepo_(cardRepo), lockConfig_(lockConfig),
+      outbound_(kPageJsonBytes)
 {
 }
 
+void
+PublishService::begin()
+{
+    outbox_.configure(
+        lockConfig_.outboxMaxEvents,
+        lockConfig_.outboxDropOldest ? EventOutbox::DropPolicy::DropOldest
+                                     : EventOutbox::DropPolicy::DropNewest
+    );
+    outbox_.begin();
+}
+
 void
 PublishService::publishState(const String& state, const String& reason)
 {
-    if (!MqttManager::connected())
+    OutboxEvent e;
+    e.kind = OutboxEvent::Kind::State;
+    e.ts = (uint64_t)TimeUtils::nowSeconds();
+    e.a = state;
+    e.b = reason;
+
+    collect_(e);
+}
+
+void
+PublishService::publishLog(const String& ev, const String& method, const String& detail)
+{
+    OutboxEvent e;
+    e.kind = OutboxEvent::Kind::Log;
+    e.ts = (uint64_t)TimeUtils::nowSeconds();
+    e.a = ev;
+    e.b = method;
+    e.c = detail;
+
+    collect_(e);
+}
+
+void
+PublishService::collect_(const OutboxEvent& e)
+{
+    if (pendingCount_ == kMaxBatch)
+        flush();
+
+    if (pendingCount_ == 0)
+        pendingSinceMs_ = millis();
+
+    pending_[pendingCount_++] = e;
+}
+
+void
+PublishService::flush()
+{
+    if (pendingCount_ == 0)
         return;
 
-    MqttManager::publishStream(
-        Topics::state(appState_.mqttTopicPrefix),
-        [&](Print& out)
-        {
-            StaticJsonDocument<128> doc;
+    if (pendingCount_ < kMaxBatch && lockConfig_.eventBatchWindowMs > 0 &&
+        (uint32_t)(millis() - pendingSinceMs_) < lockConfig_.eventBatchWindowMs)
+        return;
 
-            doc["state"] = state;
-            doc["source"] = "device";
-            doc["method"] = reason;
-            doc["ts"] = (uint64_t)TimeUtils::nowSeconds();
+    // Everything goes through the outbox, so an event only leaves it once
+    // the network task has written it, and in order behind older ones.
+    for (size_t i = 0; i < pendingCount_; ++i)
+    {
+        outbox_.push(pending_[i]);
+        pending_[i] = OutboxEvent();
+    }
+    pendingCount_ = 0;
 
-            serializeJson(doc, out);
-        },
-        false
-    );
+    drainOutbox_();
 }
 
+bool
+PublishService::publishBatch_(const OutboxEvent* events, size_t count, uint32_t& seq)
+{
+    JsonArena::Lease lease(outbound_, 64 + count * kEventJsonBytes);
+    JsonDocument& doc = lease.doc();
+    JsonArray items = doc.createNestedArray("events");
+
+    for (size_t i = 0; i < count; ++i)
+        putEvent(items.createNestedObject(), events[i]);
+
+    if (doc.overflowed())
+    {
+        LOG_E(TAG, "event batch overflow (count=%u)", (unsigned)count);
+        return false;
+    }
+
+    if (!publishDoc_(Topics::events(appState_.mqttTopicPrefix).c_str(), doc))
+        return false;
+
+    seq = MqttManager::lastQueued();
+
+    if (lockConfig_.legacyEventTopics)
+    {
+        for (size_t i = 0; i < count; ++i)
+            publishEvent_(events[i]);
+    }
+    return true;
+}
+
+bool
+PublishService::publishEvent_(const OutboxEvent& e)
+{
+    StaticJsonDocument<192> doc;
+
+    if (e.kind == OutboxEvent::Kind::State)
+    {
+        doc["state"] = e.a;
+        doc["source"] = "device";
+        doc["method"] = e.b;
+        doc["ts"] = e.ts;
+        return publishDoc_(Topics::state(appState_.mqttTopicPrefix).c_str(), doc);
+    }
+
+    doc["event"] = e.a;
+    doc["method"] = e.b;
+    if (!e.c.isEmpty())
+        doc["detail"] = e.c;
+
+    doc["ts"] = e.ts;
+    return publishDoc_(Topics::log(appState_.mqttTopicPrefix).c_str(), doc);
+}
+
+bool
+PublishService::publishDoc_(const char* topic, const JsonDocument& doc)
+{
+    return MqttManager::publishDoc(topic, doc, appState_.wireFormat);
+}
 
 void
-PublishService::publishLog(const String& ev, const String& method, const String& detail)
+PublishService::drainOutbox_()
 {
+    if (inFlightCount_ > 0)
+    {
+        const Delivery d = MqttManager::delivery(inFlightSeq_);
+        if (d == Delivery::Pending)
+            return;
+
+        if (d == Delivery::Written)
+        {
+            // Events dropped from the front meanwhile were part of the batch.
+            const uint32_t gone = outbox_.headIndex() - inFlightHead_;
+            if (gone < inFlightCount_)
+                outbox_.pop(inFlightCount_ - gone);
+
+            LOG_D(
+                TAG, "outbox: sent %u, depth=%u dropped=%u", (unsigned)inFlightCount_,
+                (unsigned)outbox_.depth(), (unsigned)outbox_.dropped()
+            );
+        }
+        else
+        {
+            LOG_W(TAG, "outbox: batch of %u not sent, retrying", (unsigned)inFlightCount_);
+        }
+        inFlightCount_ = 0;
+    }
+
     if (!MqttManager::connected())
         return;
 
-    MqttManager::publishStream(
-        Topics::log(appState_.mqttTopicPrefix),
-        [&](Print& out)
-        {
-            StaticJsonDocument<192> doc;
+    OutboxEvent batch[kOutboxBatch];
 
-            doc["event"] = ev;
-            doc["method"] = method;
-            if (!detail.isEmpty())
-                doc["detail"] = detail;
+    const size_t n = outbox_.peek(batch, kOutboxBatch);
+    if (n == 0 || !publishBatch_(batch, n, inFlightSeq_))
+        return;
 
-            doc["ts"] = (uint64_t)TimeUtils::nowSeconds();
+    inFlightCount_ = n;
+    inFlightHead_ = outbox_.headIndex();
+}
 
-            serializeJson(doc, out);
-        },
-        false
-    );
+const EventOutbox&
+PublishService::outbox() const
+{
+    return outbox_;
 }
 
 void
@@ -102,19 +354,12 @@ PublishService::publishBattery(int percent)
     if (!MqttManager::connected())
         return;
 
-    MqttManager::publishStream(
-        Topics::battery(appState_.mqttTopicPrefix),
-        [&](Print& out)
-        {
-            StaticJsonDocument<64> doc;
+    StaticJsonDocument<64> doc;
 
-            doc["battery"] = percent;
-            doc["ts"] = (uint64_t)TimeUtils::nowSeconds();
+    doc["battery"] = percent;
+    doc["ts"] = (uint64_t)TimeUtils::nowSeconds();
 
-            serializeJson(doc, out);
-        },
-        false
-    );
+    publishDoc_(Topics::battery(appState_.mqttTopicPrefix).c_str(), doc);
 }
 
 void
@@ -123,127 +368,340 @@ PublishService::publishPasscodeList()
     if (!MqttManager::connected())
         return;
 
-    const long ts = (uint64_t)TimeUtils::nowSeconds();
+    startSnapshot_(passcodeJob_, passRepo_.rev(), kTargetList);
+}
 
-    const auto& stored = passRepo_.listItems();
-    const String master = passRepo_.getMaster();
-    const bool hasMaster = !isBlank(master);
+void
+PublishService::publishICCardList()
+{
+    if (!MqttManager::connected())
+        return;
+
+    startSnapshot_(cardJob_, cardRepo_.rev(), kTargetList);
+}
 
-    const size_t itemCount = stored.size() + (hasMaster ? 1 : 0);
-    const size_t requiredSize = 128 + (itemCount * 120);
+void
+PublishService::publishPasscodeChanges(uint32_t since)
+{
+    if (!MqttManager::connected())
+        return;
+
+    const auto& changes = passRepo_.changes();
+    if (!changes.covers(since))
+    {
+        LOG_I(
+            TAG, "passcode changes since rev %u unavailable (rev=%u), sending snapshot",
+            (unsigned)since, (unsigned)changes.rev()
+        );
+        startSnapshot_(passcodeJob_, changes.rev(), kTargetChanges);
+        return;
+    }
 
-    Logger::info("PUBLISH", "publishPasscodeList: items=%d, buffer=%d bytes", 
-                itemCount, requiredSize);
+    const size_t count = changes.countSince(since);
+    JsonArena::Lease lease(outbound_, 128 + count * kItemJsonBytes);
+    JsonDocument& doc = lease.doc();
 
-    MqttManager::publishStream(
-        Topics::passcodesList(appState_.mqttTopicPrefix),
-        [&](Print& out)
+    doc["rev"] = changes.rev();
+    doc["since"] = since;
+    JsonArray items = doc.createNestedArray("changes");
+
+    changes.forEachSince(
+        since,
+        [&](const PasscodeRepository::Changes::Entry& e)
         {
-            DynamicJsonDocument doc(requiredSize);
+            JsonObject o = items.createNestedObject();
+            o["rev"] = e.rev;
+            o["op"] = changeOpName(e.op);
+            if (e.op == ChangeOp::Add)
+                putPasscode(o, e.value);
+            else
+                putPasscodeId(o, e.value);
+        }
+    );
 
-            doc[AppJsonKeys::TS] = ts;
-            JsonArray items = doc.createNestedArray(AppJsonKeys::PASSCODES);
+    if (doc.overflowed())
+    {
+        LOG_E(TAG, "passcode changes JSON overflow (count=%u)", (unsigned)count);
+        return;
+    }
 
-            if (hasMaster)
-            {
-                JsonObject o = items.createNestedObject();
-                o["code"] = master;
-                o["type"] = "master";
-            }
+    // Paged instead when the delta would not fit the outbound ring.
+    if (WireCodec::measure(doc, appState_.wireFormat) > kPageMaxBytes)
+    {
+        startSnapshot_(passcodeJob_, changes.rev(), kTargetChanges);
+        return;
+    }
 
-            for (const auto& p : stored)
-            {
-                JsonObject o = items.createNestedObject();
-                o["code"] = p.code;
-                o["type"] = p.type;
-                o["effectiveAt"] = (uint64_t)p.effectiveAt;
-                o["expireAt"] = (uint64_t)p.expireAt;
-            }
+    publishDoc_(Topics::passcodesChanges(appState_.mqttTopicPrefix).c_str(), doc);
+}
 
-            if (doc.overflowed())
-            {
-                Logger::error("PUBLISH", "JSON buffer overflow! Required: %d", requiredSize);
-                return;
-            }
+void
+PublishService::publishICCardChanges(uint32_t since)
+{
+    if (!MqttManager::connected())
+        return;
+
+    const auto& changes = cardRepo_.changes();
+    if (!changes.covers(since))
+    {
+        LOG_I(
+            TAG, "card changes since rev %u unavailable (rev=%u), sending snapshot",
+            (unsigned)since, (unsigned)changes.rev()
+        );
+        startSnapshot_(cardJob_, changes.rev(), kTargetChanges);
+        return;
+    }
 
-            serializeJson(doc, out);
+    const size_t count = changes.countSince(since);
+    JsonArena::Lease lease(outbound_, 128 + count * kItemJsonBytes);
+    JsonDocument& doc = lease.doc();
 
-            Logger::info("PUBLISH", "JSON size: %d bytes, buffer: %d bytes", 
-                        measureJson(doc), requiredSize);
-        },
-        false
+    doc["rev"] = changes.rev();
+    doc["since"] = since;
+    JsonArray items = doc.createNestedArray("changes");
+
+    changes.forEachSince(
+        since,
+        [&](const CardRepository::Changes::Entry& e)
+        {
+            JsonObject o = items.createNestedObject();
+            o["rev"] = e.rev;
+            o["op"] = changeOpName(e.op);
+            if (e.op == ChangeOp::Remove)
+                o["uid"] = e.value.uid.c_str();
+            else
+                putCard(o, e.value, defaultCardNameFromUid(e.value.uid));
+        }
     );
 
-    passRepo_.setTs(ts);
+    if (doc.overflowed())
+    {
+        LOG_E(TAG, "card changes JSON overflow (count=%u)", (unsigned)count);
+        return;
+    }
+
+    if (WireCodec::measure(doc, appState_.wireFormat) > kPageMaxBytes)
+    {
+        startSnapshot_(cardJob_, changes.rev(), kTargetChanges);
+        return;
+    }
+
+    publishDoc_(Topics::iccardsChanges(appState_.mqttTopicPrefix).c_str(), doc);
 }
 
 void
-PublishService::publishICCardList()
+PublishService::loop()
 {
+    PROFILE_SCOPE(ProfileSection::Publish);
+    HEAP_SCOPE(HeapTag::Publish);
+
     if (!MqttManager::connected())
+    {
+        // Pages sent before the drop are lost to the broker session anyway.
+        passcodeJob_.targets = 0;
+        cardJob_.targets = 0;
         return;
+    }
 
-    const long ts = (uint64_t)TimeUtils::nowSeconds();
-    const auto& cards = cardRepo_.list();
+    if (inFlightCount_ > 0 || !outbox_.empty())
+        drainOutbox_();
 
-    const size_t itemCount = cards.size();
-    const size_t requiredSize = 128 + (itemCount * 120);
+    if (passcodeJob_.targets)
+        stepPasscodeSnapshot_();
 
-    Logger::info(
-        "PUBLISH",
-        "publishICCardList: items=%d, buffer=%d bytes",
-        itemCount,
-        requiredSize
+    if (cardJob_.targets)
+        stepICCardSnapshot_();
+}
+
+void
+PublishService::startSnapshot_(SnapshotJob& job, uint32_t rev, uint8_t target)
+{
+    // A request during a running snapshot restarts it so every receiver gets
+    // a complete set of pages under one snapshot id.
+    job.targets |= target;
+    job.id = nextSnapshotId_++;
+    job.rev = rev;
+    job.ts = (uint64_t)TimeUtils::nowSeconds();
+    job.page = 0;
+    job.starts.clear();
+
+    LOG_I(
+        TAG, "snapshot %u started (rev=%u targets=0x%02x)", (unsigned)job.id, (unsigned)rev,
+        (unsigned)job.targets
     );
+}
 
-    MqttManager::publishStream(
-        Topics::iccardsList(appState_.mqttTopicPrefix),
-        [&](Print& out)
-        {
-            DynamicJsonDocument doc(requiredSize);
+bool
+PublishService::publishPage_(
+    SnapshotJob& job, JsonDocument& doc, size_t pages, const char* listTopic,
+    const char* changesTopic
+)
+{
+    if (doc.overflowed())
+    {
+        LOG_E(TAG, "snapshot %u page %u overflow", (unsigned)job.id, (unsigned)job.page);
+        job.targets = 0;
+        return false;
+    }
 
-            doc[AppJsonKeys::TS] = ts;
-            JsonArray items = doc.createNestedArray(AppJsonKeys::CARDS);
+    // Wait for the network task to drain rather than fail the page; it is
+    // rebuilt and measured again on the next loop().
+    const size_t frames = ((job.targets & kTargetList) ? 1 : 0) +
+                          ((job.targets & kTargetChanges) ? 1 : 0);
+    if (!MqttManager::outboundFits(WireCodec::measure(doc, appState_.wireFormat), frames))
+        return false;
 
-            for (size_t i = 0; i < cards.size(); i++)
-            {
-                const auto& c = cards[i];
+    bool ok = true;
+    if (job.targets & kTargetList)
+        ok = publishDoc_(listTopic, doc) && ok;
+    if (job.targets & kTargetChanges)
+        ok = publishDoc_(changesTopic, doc) && ok;
+
+    if (!ok)
+    {
+        // Receivers discard the incomplete snapshot and ask again.
+        LOG_W(TAG, "snapshot %u aborted at page %u", (unsigned)job.id, (unsigned)job.page);
+        job.targets = 0;
+        return false;
+    }
+
+    if (++job.page < pages)
+        return false;
+
+    LOG_I(TAG, "snapshot %u done (%u pages)", (unsigned)job.id, (unsigned)pages);
+    job.targets = 0;
+    return true;
+}
 
-                JsonObject o = items.createNestedObject();
-                o["uid"] = c.uid;
+void
+PublishService::stepPasscodeSnapshot_()
+{
+    SnapshotJob& job = passcodeJob_;
+    if (passRepo_.rev() != job.rev)
+    {
+        LOG_I(TAG, "passcodes changed during snapshot %u", (unsigned)job.id);
+        startSnapshot_(job, passRepo_.rev(), 0);
+    }
+
+    const auto& stored = passRepo_.listItems();
+    const HashedPasscode& master = passRepo_.getMaster();
+    const size_t offset = passRepo_.hasMaster() ? 1 : 0;
 
-                String name = c.name;
-                if (isBlank(name))
-                    name = defaultCardNameByIndex(i);
+    const size_t total = stored.size() + offset;
+    const WireFormat format = appState_.wireFormat;
 
-                o["name"] = name;
+    if (job.starts.empty())
+    {
+        planPages(
+            job.starts, total,
+            [&](size_t i) -> size_t
+            {
+                if (i < offset)
+                    return entryBytes(format, [&](JsonObject o) { putMaster(o, master); });
+                return entryBytes(
+                    format, [&](JsonObject o) { putPasscode(o, stored[i - offset]); }
+                );
             }
+        );
+    }
+    const size_t pages = job.starts.size();
+
+    JsonArena::Lease lease(outbound_, kPageJsonBytes);
+
+    JsonDocument& doc = lease.doc();
+    putPageHeader(doc, job.ts, job.rev, job.id, job.page, pages);
+    JsonArray items = doc.createNestedArray(AppJsonKeys::PASSCODES);
+
+    const size_t first = job.starts[job.page];
+    const size_t last = job.page + 1 < pages ? job.starts[job.page + 1] : total;
+    for (size_t i = first; i < last; ++i)
+    {
+        if (i < offset)
+            putMaster(items.createNestedObject(), master);
+        else
+            putPasscode(items.createNestedObject(), stored[i - offset]);
+    }
+
+    const String& base = appState_.mqttTopicPrefix;
+    const Topics::Topic listTopic = Topics::passcodesList(base);
+    const Topics::Topic changesTopic = Topics::passcodesChanges(base);
+    if (publishPage_(job, doc, pages, listTopic.c_str(), changesTopic.c_str()))
+        passRepo_.setTs(job.ts);
+}
+
+void
+PublishService::stepICCardSnapshot_()
+{
+    SnapshotJob& job = cardJob_;
+    if (cardRepo_.rev() != job.rev)
+    {
+        LOG_I(TAG, "cards changed during snapshot %u", (unsigned)job.id);
+        startSnapshot_(job, cardRepo_.rev(), 0);
+    }
+
+    const auto& cards = cardRepo_.list();
+    const WireFormat format = appState_.wireFormat;
 
-            if (doc.overflowed())
+    if (job.starts.empty())
+    {
+        planPages(
+            job.starts, cards.size(),
+            [&](size_t i)
             {
-                Logger::error(
-                    "PUBLISH",
-                    "ICCard JSON buffer overflow! Required: %d",
-                    requiredSize
+                return entryBytes(
+                    format,
+                    [&](JsonObject o) { putCard(o, cards[i], defaultCardNameByIndex(i)); }
                 );
-                return;
             }
+        );
+    }
+    const size_t pages = job.starts.size();
 
-            serializeJson(doc, out);
+    JsonArena::Lease lease(outbound_, kPageJsonBytes);
 
-            Logger::info(
-                "PUBLISH",
-                "ICCard JSON size: %d bytes, buffer: %d bytes",
-                measureJson(doc),
-                requiredSize
-            );
-        },
-        false
-    );
+    JsonDocument& doc = lease.doc();
+    putPageHeader(doc, job.ts, job.rev, job.id, job.page, pages);
+    JsonArray items = doc.createNestedArray(AppJsonKeys::CARDS);
+
+    const size_t first = job.starts[job.page];
+    const size_t last = job.page + 1 < pages ? job.starts[job.page + 1] : cards.size();
+    for (size_t i = first; i < last; ++i)
+        putCard(items.createNestedObject(), cards[i], defaultCardNameByIndex(i));
 
-    cardRepo_.setTs(ts);
+    const String& base = appState_.mqttTopicPrefix;
+    const Topics::Topic listTopic = Topics::iccardsList(base);
+    const Topics::Topic changesTopic = Topics::iccardsChanges(base);
+    if (publishPage_(job, doc, pages, listTopic.c_str(), changesTopic.c_str()))
+        cardRepo_.setTs(job.ts);
 }
 
+void
+PublishService::publishDiagnostics(bool resetProfile)
+{
+#ifdef ENABLE_PROFILER
+    Profiler::logSummary();
+#endif
+
+    if (MqttManager::connected())
+    {
+        JsonArena::Lease lease(outbound_, kDiagnosticsJsonBytes);
+        JsonDocument& doc = lease.doc();
+
+        doc["uptimeMs"] = (uint32_t)millis();
+        HeapMonitor::toJson(doc.createNestedObject("heap"));
+        doc["logDropped"] = Logger::dropped();
+#ifdef ENABLE_PROFILER
+        Profiler::toJson(doc.createNestedArray("profile"));
+#endif
+
+        publishDoc_(Topics::diagnostics(appState_.mqttTopicPrefix).c_str(), doc);
+    }
+
+#ifdef ENABLE_PROFILER
+    if (resetProfile)
+        Profiler::reset();
+#endif
+}
 
 void
 PublishService::publishInfo(int batteryPercent, int version)
@@ -251,19 +709,17 @@ PublishService::publishInfo(int batteryPercent, int version)
     if (!MqttManager::connected())
         return;
 
-    MqttManager::publishStream(
-        Topics::info(appState_.mqttTopicPrefix),
-        [&](Print& out)
-        {
-            StaticJsonDocument<128> doc;
+    StaticJsonDocument<256> doc;
 
-            doc["mac"] = appState_.macAddress;
-            doc["topic"] = appState_.mqttTopicPrefix;
-            doc["battery"] = batteryPercent;
-            doc["version"] = version;
+    doc["mac"] = appState_.macAddress;
+    doc["topic"] = appState_.mqttTopicPrefix;
+    doc["battery"] = batteryPercent;
+    doc["version"] = version;
+    doc["outboxDepth"] = (uint32_t)outbox_.depth();
+    doc["outboxDropped"] = outbox_.dropped();
 
-            serializeJson(doc, out);
-        },
-        false
-    );
+    doc["encoding"] = WireCodec::name(appState_.wireFormat);
+
+    // Always JSON, so a client can read the encoding before switching.
+    MqttManager::publishDoc(Topics::info(appState_.mqttTopicPrefix).c_str(), doc, WireFormat::Json);
 }
@@ -1,15 +1,30 @@
 #pragma once
+#include "config/LockConfig.h"
 #include "models/AppState.h"
 #include "storage/CardRepository.h"
+#include "storage/EventOutbox.h"
 #include "storage/PasscodeRepository.h"
+#include "utils/JsonArena.h"
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
 
 class PublishService
 {
   public:
-    PublishService(AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo);
+    PublishService(
+        AppState& appState, PasscodeRepository& passRepo, CardRepository& cardRepo,
+        const LockConfig& lockConfig
+    );
 
+    // Call once the file system and lock config are loaded.
+    void
+    begin();
+
+    // State and log events are collected and sent as one batch by flush().
+    // While offline they are queued and replayed, with their original
+    // timestamps, once the connection is back.
     void
     publishState(const String& state, const String& reason = "");
 
@@ -19,17 +34,112 @@ class PublishService
     void
     publishBattery(int percent);
 
+    // Full lists go out as a paged snapshot, one page per loop() call.
     void
     publishPasscodeList();
 
     void
     publishICCardList();
 
+    // Publishes the changes after revision `since` on the changes topic, or a
+    // paged snapshot there when the change log no longer reaches back that far.
+    void
+    publishPasscodeChanges(uint32_t since);
+
+    void
+    publishICCardChanges(uint32_t since);
+
     void
     publishInfo(int batteryPercent, int version);
 
+    // Runtime diagnostics on <base>/diagnostics, plus per-section timings
+    // when built with ENABLE_PROFILER (also logged to Serial).
+    void
+    publishDiagnostics(bool resetProfile);
+
+    void
+    loop();
+
+    // Sends the events collected so far; called at the end of every loop()
+    // pass and honours LockConfig::eventBatchWindowMs.
+    void
+    flush();
+
+    const EventOutbox&
+    outbox() const;
+
   private:
+    // Where the pages of a snapshot go; a snapshot can serve both at once.
+    static constexpr uint8_t kTargetList = 1 << 0;
+    static constexpr uint8_t kTargetChanges = 1 << 1;
+
+    struct SnapshotJob
+    {
+        uint8_t targets{0}; // 0 = idle
+        uint32_t id{0};
+        uint32_t rev{0};
+        uint64_t ts{0};
+        size_t page{0};
+        // First entry of each page, planned on the first step.
+        std::vector<size_t> starts;
+    };
+
+    static constexpr size_t kMaxBatch = 16;
+
+    void
+    collect_(const OutboxEvent& e);
+
+    // `seq` is the MqttManager sequence number of the batch document.
+    bool
+    publishBatch_(const OutboxEvent* events, size_t count, uint32_t& seq);
+
+    bool
+    publishEvent_(const OutboxEvent& e);
+
+    // Publishes in the encoding negotiated over the info topic.
+    bool
+    publishDoc_(const char* topic, const JsonDocument& doc);
+
+    // Pops the batch in flight once it is written, then sends the next one.
+    void
+    drainOutbox_();
+
+    void
+    startSnapshot_(SnapshotJob& job, uint32_t rev, uint8_t target);
+
+    // Publishes one page and advances the job; true once the last page is out.
+    bool
+    publishPage_(
+        SnapshotJob& job, JsonDocument& doc, size_t pages, const char* listTopic,
+        const char* changesTopic
+    );
+
+    void
+    stepPasscodeSnapshot_();
+
+    void
+    stepICCardSnapshot_();
+
     AppState& appState_;
     PasscodeRepository& passRepo_;
     CardRepository& cardRepo_;
+    const LockConfig& lockConfig_;
+
+    EventOutbox outbox_;
+
+    // Every event, change and snapshot document is built in here.
+    JsonArena outbound_;
+
+    OutboxEvent pending_[kMaxBatch];
+    size_t pendingCount_{0};
+    uint32_t pendingSinceMs_{0};
+
+    // The outbox batch handed to MqttManager and not yet confirmed written.
+    size_t inFlightCount_{0};
+    uint32_t inFlightSeq_{0};
+    uint32_t inFlightHead_{0}; // outbox_.headIndex() when it was sent
+
+    SnapshotJob passcodeJob_;
+    SnapshotJob cardJob_;
+    uint32_t nextSnapshotId_{1};
 };
\ No newline at end of file
@@ -9,12 +9,50 @@
 #include "network/MqttManager.h"
 #include "storage/CardRepository.h"
 #include "utils/Logger.h"
+#include "utils/Profiler.h"
+#include "utils/Scheduler.h"
 #include "utils/TimeUtils.h"
 
 #include <SPI.h>
 
 namespace
 {
+// Polling mode: one presence check per pass.
+constexpr uint32_t kPassIntervalMs = 30;
+
+// IRQ mode idle cycle: field off, field on and settle, listen for a REQA answer.
+constexpr uint32_t kFieldOffMs = 20;
+constexpr uint32_t kFieldSettleMs = 5;
+constexpr uint32_t kListenMs = 5;
+
+// Tap latency is summarised after this many taps.
+constexpr uint32_t kLatencyReportTaps = 16;
+
+// ComIEnReg: IRqInv | RxIEn, so IRQ idles high and falls when a frame arrives.
+// DivIEnReg: IRQPushPull, as GPIO35 has no pull-up.
+constexpr byte kComIEn = 0xA0;
+constexpr byte kDivIEn = 0x80;
+
+// Self-test: ComIEnReg TimerIEn, ControlReg TStartNow/TStopNow. PCD_Init
+// leaves the timer at 25 ms.
+constexpr byte kTimerIEn = 0x01;
+constexpr byte kTStartNow = 0x40;
+constexpr byte kTStopNow = 0x80;
+constexpr uint32_t kIrqSelfTestMs = 50;
+
+volatile bool s_irqFired = false;
+volatile uint32_t s_irqAtUs = 0;
+
+void IRAM_ATTR
+onRfidIrq()
+{
+    if (!s_irqFired)
+        s_irqAtUs = micros();
+    s_irqFired = true;
+
+    Scheduler::notifyFromIsr(WakeEvent::RFID);
+}
+
 String
 defaultCardNameNext(const CardRepository& repo)
 {
@@ -40,35 +78,229 @@ RfidService::begin()
     SPI.setFrequency(1000000);
 #endif
 
+    initPcd_(50);
+    mfrc522_.PCD_DumpVersionToSerial();
+
+    irqMode_ = lockConfig_.rfidIrqMode;
+    if (irqMode_)
+    {
+        pinMode(RFID_IRQ_PIN, INPUT);
+        attachInterrupt(digitalPinToInterrupt(RFID_IRQ_PIN), onRfidIrq, FALLING);
+
+        if (irqLineWorks_())
+        {
+            LOG_I("RFID", "IRQ mode on pin %d", RFID_IRQ_PIN);
+        }
+        else
+        {
+            detachInterrupt(digitalPinToInterrupt(RFID_IRQ_PIN));
+            irqMode_ = false;
+            LOG_W(
+                "RFID", "no IRQ on pin %d, polling every %u ms", RFID_IRQ_PIN,
+                (unsigned)kPassIntervalMs
+            );
+        }
+    }
+
+    enterIdle_();
+}
+
+// Fires the reader's own timer with its IRQ enabled and checks that the
+// line actually reaches RFID_IRQ_PIN, so a missing wire does not leave the
+// reader deaf.
+bool
+RfidService::irqLineWorks_()
+{
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);
+    s_irqFired = false;
+
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIEnReg, kComIEn | kTimerIEn);
+    mfrc522_.PCD_WriteRegister(MFRC522::ControlReg, kTStartNow);
+
+    const uint32_t startMs = millis();
+    while (!s_irqFired && (uint32_t)(millis() - startMs) < kIrqSelfTestMs)
+        delay(1);
+    const bool fired = s_irqFired;
+
+    mfrc522_.PCD_WriteRegister(MFRC522::ControlReg, kTStopNow);
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIEnReg, kComIEn);
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);
+    s_irqFired = false;
+    return fired;
+}
+
+void
+RfidService::initPcd_(uint32_t settleMs)
+{
     mfrc522_.PCD_Init();
-    delay(50);
+    delay(settleMs);
 
     mfrc522_.PCD_AntennaOn();
     mfrc522_.PCD_SetAntennaGain(mfrc522_.RxGain_max);
-    mfrc522_.PCD_DumpVersionToSerial();
+
+    // PCD_Init resets the interrupt configuration.
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIEnReg, kComIEn);
+    mfrc522_.PCD_WriteRegister(MFRC522::DivIEnReg, kDivIEn);
 }
 
 void
-RfidService::cleanupPcd_()
+RfidService::enterIdle_()
 {
-    mfrc522_.PICC_HaltA();
-    mfrc522_.PCD_StopCrypto1();
+    scanState_ = ScanState::Idle;
+    heldUid_.clear();
+
+    if (!irqMode_)
+        return;
+
+    mfrc522_.PCD_AntennaOff();
+    irqPhase_ = IrqPhase::FieldOff;
+    irqPhaseMs_ = millis();
 }
 
-String
-RfidService::getUID_()
+// Sends REQA without waiting for the answer; a card in the field replies
+// within about 100 us and the reader raises IRQ.
+void
+RfidService::armIrq_()
 {
-    String uid;
-    uid.reserve(2 * mfrc522_.uid.size);
+    mfrc522_.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+    mfrc522_.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);
+    s_irqFired = false;
+
+    mfrc522_.PCD_WriteRegister(MFRC522::FIFOLevelReg, 0x80);
+    mfrc522_.PCD_WriteRegister(MFRC522::FIFODataReg, MFRC522::PICC_CMD_REQA);
+    mfrc522_.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    mfrc522_.PCD_WriteRegister(MFRC522::BitFramingReg, 0x87); // StartSend, 7-bit frame
+}
 
-    for (byte i = 0; i < mfrc522_.uid.size; i++)
+bool
+RfidService::serviceIrqIdle_()
+{
+    const uint32_t now = millis();
+    const uint32_t inPhase = now - irqPhaseMs_;
+
+    switch (irqPhase_)
+    {
+        case IrqPhase::FieldOff:
+        {
+            if (inPhase < kFieldOffMs)
+                return false;
+
+            mfrc522_.PCD_AntennaOn();
+            irqPhase_ = IrqPhase::Settling;
+            irqPhaseMs_ = now;
+            return false;
+        }
+
+        case IrqPhase::Settling:
+        {
+            // Cards need the field for a few ms before they can answer.
+            if (inPhase < kFieldSettleMs)
+                return false;
+
+            armIrq_();
+            irqPhase_ = IrqPhase::Listening;
+            irqPhaseMs_ = now;
+            return false;
+        }
+
+        case IrqPhase::Listening:
+        {
+            if (s_irqFired)
+            {
+                mfrc522_.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+                return true;
+            }
+
+            if (inPhase < kListenMs)
+                return false;
+
+            mfrc522_.PCD_AntennaOff();
+            irqPhase_ = IrqPhase::FieldOff;
+            irqPhaseMs_ = now;
+            return false;
+        }
+    }
+    return false;
+}
+
+uint32_t
+RfidService::msUntilDue() const
+{
+    const uint32_t now = millis();
+    const auto left = [now](uint32_t sinceMs, uint32_t spanMs)
+    { return (uint32_t)(now - sinceMs) < spanMs ? spanMs - (uint32_t)(now - sinceMs) : 0; };
+
+    if (scanState_ != ScanState::Idle)
+        return left(lastPassMs_, kPassIntervalMs);
+
+    const uint32_t debounce = left(lastReadMs_, lockConfig_.rfidDebounceMs);
+    if (debounce)
+        return debounce;
+
+    if (!irqMode_)
+        return left(lastPassMs_, kPassIntervalMs);
+
+    switch (irqPhase_)
     {
-        if (mfrc522_.uid.uidByte[i] < 0x10)
-            uid += "0";
-        uid += String(mfrc522_.uid.uidByte[i], HEX);
+        case IrqPhase::FieldOff:
+            return left(irqPhaseMs_, kFieldOffMs);
+        case IrqPhase::Settling:
+            return left(irqPhaseMs_, kFieldSettleMs);
+        case IrqPhase::Listening:
+            return left(irqPhaseMs_, kListenMs);
     }
+    return 0;
+}
+
+void
+RfidService::beginTap_()
+{
+    tapStartUs_ = irqMode_ ? s_irqAtUs : micros();
+    tapPcdOps_ = 0;
+
+    scanState_ = ScanState::Trying;
+    presenceLastSeenMs_ = millis();
+    lastAttemptMs_ = 0;
+    failCount_ = 0;
+    heldUid_.clear();
+}
+
+void
+RfidService::finishTap_(const char* outcome)
+{
+    const uint32_t us = micros() - tapStartUs_;
+    tapLatency_.record(us);
+
+    LOG_I(
+        "RFID", "tap %s: %u us to decision, %u PCD commands", outcome, (unsigned)us,
+        (unsigned)tapPcdOps_
+    );
+
+    if (tapLatency_.total() < kLatencyReportTaps)
+        return;
 
-    uid.toUpperCase();
+    LOG_I(
+        "RFID", "tap latency us: p50<=%u p99<=%u max=%u (n=%u)",
+        (unsigned)tapLatency_.percentileUs(50), (unsigned)tapLatency_.percentileUs(99),
+        (unsigned)tapLatency_.maxUs(), (unsigned)tapLatency_.total()
+    );
+    tapLatency_.reset();
+}
+
+void
+RfidService::cleanupPcd_()
+{
+    tapPcdOps_ += 2;
+    mfrc522_.PICC_HaltA();
+    mfrc522_.PCD_StopCrypto1();
+}
+
+CardUidHex
+RfidService::getUID_() const
+{
+    CardUidHex uid;
+    for (byte i = 0; i < mfrc522_.uid.size; i++)
+        uid.appendHex(mfrc522_.uid.uidByte[i]);
     return uid;
 }
 
@@ -78,11 +310,12 @@ RfidService::detectCollision_()
     byte bufferATQA[2];
     byte bufferSize = sizeof(bufferATQA);
 
+    tapPcdOps_++;
     const MFRC522::StatusCode status = mfrc522_.PICC_RequestA(bufferATQA, &bufferSize);
 
     if (status == MFRC522::STATUS_COLLISION)
     {
-        Logger::info("RFID", "Collision detected (multiple cards)");
+        LOG_I("RFID", "Collision detected (multiple cards)");
         return true;
     }
     return false;
@@ -94,6 +327,7 @@ RfidService::isAnyCardPresent_()
     byte atqa[2] = {0, 0};
     byte atqaSize = sizeof(atqa);
 
+    tapPcdOps_++;
     const MFRC522::StatusCode st = mfrc522_.PICC_WakeupA(atqa, &atqaSize);
     const bool present = (st == MFRC522::STATUS_OK || st == MFRC522::STATUS_COLLISION);
 
@@ -102,8 +336,9 @@ RfidService::isAnyCardPresent_()
 }
 
 bool
-RfidService::tryReadUidOnce_(String& outUid)
+RfidService::tryReadUidOnce_(CardUidHex& outUid)
 {
+    tapPcdOps_++;
     if (!mfrc522_.PICC_ReadCardSerial())
         return false;
 
@@ -114,10 +349,7 @@ RfidService::tryReadUidOnce_(String& outUid)
 void
 RfidService::loop()
 {
-    static uint32_t lastLoopMs = 0;
-    if (millis() - lastLoopMs < 30)
-        return;
-    lastLoopMs = millis();
+    PROFILE_SCOPE(ProfileSection::Rfid);
 
     if (appState_.runtimeFlags.swipeAddMode && appState_.swipeAdd.isTimeout())
     {
@@ -131,12 +363,37 @@ RfidService::loop()
     constexpr uint32_t kAttemptIntervalMs = 30;
     constexpr uint16_t kReinitEveryFails = 25;
 
-    // Post-success debounce (chỉ áp dụng khi đang Idle)
-    const uint32_t debounceMs = lockConfig_.rfidDebounceMs;
-    if (scanState_ == ScanState::Idle && (uint32_t)(millis() - lastReadMs_) < debounceMs)
+    if (scanState_ == ScanState::Idle)
     {
-        return;
+        // Post-success debounce (chỉ áp dụng khi đang Idle)
+        const uint32_t debounceMs = lockConfig_.rfidDebounceMs;
+        if ((uint32_t)(millis() - lastReadMs_) < debounceMs)
+            return;
+
+        if (irqMode_)
+        {
+            if (!serviceIrqIdle_())
+                return;
+        }
+        else
+        {
+            if ((uint32_t)(millis() - lastPassMs_) < kPassIntervalMs)
+                return;
+            lastPassMs_ = millis();
+
+            if (!isAnyCardPresent_())
+                return;
+        }
+
+        // Straight on to reading: no extra pass interval after detection.
+        beginTap_();
+    }
+    else
+    {
+        if ((uint32_t)(millis() - lastPassMs_) < kPassIntervalMs)
+            return;
     }
+    lastPassMs_ = millis();
 
     const bool presentNow = isAnyCardPresent_();
     if (presentNow)
@@ -145,22 +402,14 @@ RfidService::loop()
     switch (scanState_)
     {
         case ScanState::Idle:
-        {
-            if (!presentNow)
-                return;
-
-            scanState_ = ScanState::Trying;
-            lastAttemptMs_ = 0;
-            failCount_ = 0;
-            heldUid_ = "";
             return;
-        }
 
         case ScanState::Trying:
         {
             if (!presentNow && (uint32_t)(millis() - presenceLastSeenMs_) > kRemoveGraceMs)
             {
-                scanState_ = ScanState::Idle;
+                finishTap_("lost");
+                enterIdle_();
                 return;
             }
 
@@ -174,7 +423,7 @@ RfidService::loop()
                 return;
             }
 
-            String uid;
+            CardUidHex uid;
             if (!tryReadUidOnce_(uid))
             {
                 failCount_++;
@@ -182,36 +431,35 @@ RfidService::loop()
 
                 if (failCount_ % kReinitEveryFails == 0)
                 {
-                    mfrc522_.PCD_Init();
-                    delay(10);
-                    mfrc522_.PCD_AntennaOn();
-                    mfrc522_.PCD_SetAntennaGain(mfrc522_.RxGain_max);
+                    tapPcdOps_++;
+                    initPcd_(10);
                 }
                 return;
             }
 
             lastReadMs_ = millis();
-            Logger::info("RFID", "Card detected UID=%s", uid.c_str());
+            LOG_I("RFID", "Card detected UID=%s", uid.c_str());
 
             if (appState_.runtimeFlags.swipeAddMode)
             {
                 if (!appState_.swipeAdd.hasFirstSwipe())
                 {
-                    Logger::info("RFID", "Swipe-add first card: %s", uid.c_str());
+                    LOG_I("RFID", "Swipe-add first card: %s", uid.c_str());
 
                     appState_.swipeAdd.recordFirstSwipe(uid, lockConfig_.swipeAddTimeoutMs);
                 }
                 else if (appState_.swipeAdd.matchesFirstSwipe(uid))
                 {
-                    Logger::info("RFID", "Swipe-add confirmed: %s", uid.c_str());
+                    LOG_I("RFID", "Swipe-add confirmed: %s", uid.c_str());
 
                     const String name = defaultCardNameNext(cardRepo_);
-                    if (cardRepo_.add(uid, name))
+                    const uint32_t rev = cardRepo_.rev();
+                    if (cardRepo_.add(String(uid.c_str()), name))
                     {
                         cardRepo_.setTs((uint64_t)TimeUtils::nowSeconds());
-                        Logger::info("RFID", "Card added to repository: %s", uid.c_str());
+                        LOG_I("RFID", "Card added to repository: %s", uid.c_str());
                         publish_.publishLog("CardAdded", "SwipeAdd", "Thêm Card thành công");
-                        publish_.publishICCardList();
+                        publish_.publishICCardChanges(rev);
                     }
 
                     appState_.runtimeFlags.swipeAddMode = false;
@@ -219,7 +467,7 @@ RfidService::loop()
                 }
                 else
                 {
-                    Logger::info("RFID", "Swipe-add failed (UID mismatch): %s", uid.c_str());
+                    LOG_I("RFID", "Swipe-add failed (UID mismatch): %s", uid.c_str());
 
                     appState_.runtimeFlags.swipeAddMode = false;
                     appState_.swipeAdd.reset();
@@ -228,21 +476,24 @@ RfidService::loop()
                 }
 
                 cleanupPcd_();
+                finishTap_("swipe-add");
                 scanState_ = ScanState::Held;
                 heldUid_ = uid;
                 return;
             }
 
             // --- Normal auth flow ---
-            if (cardRepo_.exists(uid))
+            const bool granted = cardRepo_.exists(mfrc522_.uid.uidByte, mfrc522_.uid.size);
+            if (granted)
             {
-                Logger::info("RFID", "Card AUTH SUCCESS: %s", uid.c_str());
+                LOG_I("RFID", "Card AUTH SUCCESS: %s", uid.c_str());
                 door_.requestUnlock("Card");
             }
             else
             {
-                Logger::info("RFID", "Card AUTH FAILED: %s", uid.c_str());
+                LOG_I("RFID", "Card AUTH FAILED: %s", uid.c_str());
             }
+            finishTap_(granted ? "granted" : "denied");
 
             cleanupPcd_();
 
@@ -259,8 +510,7 @@ RfidService::loop()
             if ((uint32_t)(millis() - presenceLastSeenMs_) <= kRemoveGraceMs)
                 return;
 
-            scanState_ = ScanState::Idle;
-            heldUid_ = "";
+            enterIdle_();
             return;
         }
     }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "models/SwipeAddState.h"
+#include "utils/LatencyHistogram.h"
+
 #include <Arduino.h>
 #include <MFRC522.h>
 
@@ -22,6 +25,11 @@ class RfidService
     void
     loop();
 
+    // How long loop() can be left alone: the next IRQ-cycle phase change or
+    // pass. A card answering early in IRQ mode wakes the app on its own.
+    uint32_t
+    msUntilDue() const;
+
   private:
     enum class ScanState : uint8_t
     {
@@ -30,15 +38,40 @@ class RfidService
         Held
     };
 
-    String
-    getUID_();
+    // IRQ-mode idle cycle; the field is off most of the time.
+    enum class IrqPhase : uint8_t
+    {
+        FieldOff,
+        Settling,
+        Listening
+    };
+
+    void
+    initPcd_(uint32_t settleMs);
+    bool
+    irqLineWorks_();
+    void
+    enterIdle_();
+    void
+    armIrq_();
+    // True once a card has answered the armed REQA.
+    bool
+    serviceIrqIdle_();
+
+    void
+    beginTap_();
+    void
+    finishTap_(const char* outcome);
+
+    CardUidHex
+    getUID_() const;
     bool
     detectCollision_();
 
     bool
     isAnyCardPresent_();
     bool
-    tryReadUidOnce_(String& outUid);
+    tryReadUidOnce_(CardUidHex& outUid);
     void
     cleanupPcd_();
 
@@ -56,5 +89,16 @@ class RfidService
     uint32_t presenceLastSeenMs_ = 0;
     uint32_t lastAttemptMs_ = 0;
     uint16_t failCount_ = 0;
-    String heldUid_;
+    CardUidHex heldUid_;
+    uint32_t lastPassMs_ = 0;
+
+    bool irqMode_ = false;
+    IrqPhase irqPhase_ = IrqPhase::FieldOff;
+    uint32_t irqPhaseMs_ = 0;
+
+    // Per-tap instrumentation. PCD commands are counted rather than raw SPI
+    // transfers; each one is a handful of register accesses.
+    uint32_t tapStartUs_ = 0;
+    uint16_t tapPcdOps_ = 0;
+    LatencyHistogram tapLatency_;
 };
@@ -1,89 +1,169 @@
 #pragma once
+#include "utils/FixedString.h"
+
 #include <Arduino.h>
 
 namespace Topics
 {
-inline String
+// MqttManager frames carry the topic length in one byte.
+static constexpr size_t kMaxLength = 255;
+
+// Built on the stack; publishing a message never allocates a topic String.
+using Topic = FixedString<kMaxLength>;
+
+// Topic suffixes appended to the per-device prefix.
+namespace Suffix
+{
+static constexpr const char* PASSCODES = "/passcodes";
+static constexpr const char* PASSCODES_REQ = "/passcodes/request";
+static constexpr const char* ICCARDS = "/iccards";
+static constexpr const char* ICCARDS_REQ = "/iccards/request";
+static constexpr const char* CONTROL = "/control";
+static constexpr const char* INFO = "/info";
+static constexpr const char* STATE = "/state";
+static constexpr const char* LOG = "/log";
+static constexpr const char* EVENTS = "/events";
+static constexpr const char* BATTERY = "/battery";
+static constexpr const char* BATTERY_REQ = "/battery/request";
+static constexpr const char* PASSCODES_LIST = "/passcodeslist";
+static constexpr const char* ICCARDS_LIST = "/iccardslist";
+static constexpr const char* PASSCODES_CHANGES = "/passcodes/changes";
+static constexpr const char* PASSCODES_SYNC = "/passcodes/sync";
+static constexpr const char* ICCARDS_CHANGES = "/iccards/changes";
+static constexpr const char* ICCARDS_SYNC = "/iccards/sync";
+static constexpr const char* ICCARDS_STATUS = "/iccards/status";
+static constexpr const char* PASSCODES_ERROR = "/passcodes/error";
+static constexpr const char* DIAGNOSTICS = "/diagnostics";
+static constexpr const char* DIAGNOSTICS_REQ = "/diagnostics/request";
+} // namespace Suffix
+
+// Empty if the result would not fit; MqttManager refuses empty topics.
+inline Topic
+join(const String& base, const char* suffix)
+{
+    Topic t;
+    if (!t.append(base.c_str(), base.length()) || !t.append(suffix))
+        t.clear();
+    return t;
+}
+
+inline Topic
 passcodes(const String& base)
 {
-    return base + "/passcodes";
+    return join(base, Suffix::PASSCODES);
 }
 
-inline String
+inline Topic
 passcodesReq(const String& base)
 {
-    return base + "/passcodes/request";
+    return join(base, Suffix::PASSCODES_REQ);
 }
 
-inline String
+inline Topic
 iccards(const String& base)
 {
-    return base + "/iccards";
+    return join(base, Suffix::ICCARDS);
 }
 
-inline String
+inline Topic
 iccardsReq(const String& base)
 {
-    return base + "/iccards/request";
+    return join(base, Suffix::ICCARDS_REQ);
 }
 
-inline String
+inline Topic
 control(const String& base)
 {
-    return base + "/control";
+    return join(base, Suffix::CONTROL);
 }
 
-inline String
+inline Topic
 info(const String& base)
 {
-    return base + "/info";
+    return join(base, Suffix::INFO);
 }
 
-inline String
+inline Topic
 state(const String& base)
 {
-    return base + "/state";
+    return join(base, Suffix::STATE);
 }
 
-inline String
+inline Topic
 log(const String& base)
 {
-    return base + "/log";
+    return join(base, Suffix::LOG);
+}
+
+inline Topic
+events(const String& base)
+{
+    return join(base, Suffix::EVENTS);
 }
 
-inline String
+inline Topic
 battery(const String& base)
 {
-    return base + "/battery";
+    return join(base, Suffix::BATTERY);
 }
 
-inline String
+inline Topic
 batteryReq(const String& base)
 {
-    return base + "/battery/request";
+    return join(base, Suffix::BATTERY_REQ);
 }
 
-inline String
+inline Topic
 passcodesList(const String& base)
 {
-    return base + "/passcodeslist";
+    return join(base, Suffix::PASSCODES_LIST);
 }
 
-inline String
+inline Topic
 iccardsList(const String& base)
 {
-    return base + "/iccardslist";
+    return join(base, Suffix::ICCARDS_LIST);
+}
+
+inline Topic
+passcodesChanges(const String& base)
+{
+    return join(base, Suffix::PASSCODES_CHANGES);
+}
+
+inline Topic
+passcodesSync(const String& base)
+{
+    return join(base, Suffix::PASSCODES_SYNC);
+}
+
+inline Topic
+iccardsChanges(const String& base)
+{
+    return join(base, Suffix::ICCARDS_CHANGES);
 }
 
-inline String
+inline Topic
+iccardsSync(const String& base)
+{
+    return join(base, Suffix::ICCARDS_SYNC);
+}
+
+inline Topic
 iccardsStatus(const String& base)
 {
-    return base + "/iccards/status";
+    return join(base, Suffix::ICCARDS_STATUS);
 }
 
-inline String
+inline Topic
 passcodesError(const String& base)
 {
-    return base + "/passcodes/error";
+    return join(base, Suffix::PASSCODES_ERROR);
+}
+
+inline Topic
+diagnostics(const String& base)
+{
+    return join(base, Suffix::DIAGNOSTICS);
 }
 } // namespace Topics
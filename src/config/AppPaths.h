@@ -3,8 +3,16 @@
 namespace AppPaths
 {
 static constexpr const char* CONFIG_JSON = "/config.json";
+static constexpr const char* CARDS_BIN = "/iccards.bin";
+static constexpr const char* PASSCODES_BIN = "/passcodes.bin";
+static constexpr const char* PASSCODES_JOURNAL = "/passcodes.log";
+static constexpr const char* PASSCODES_KEY = "/passcodes.key";
+static constexpr const char* OUTBOX_BIN = "/outbox.bin";
+
+// Pre-binary formats, read once on first boot and then removed.
 static constexpr const char* CARDS_JSON = "/iccards.json";
 static constexpr const char* PASSCODES_JSON = "/passcodes.json";
+static constexpr const char* PASSCODES_JOURNAL_JSON = "/passcodes.jnl";
 } // namespace AppPaths
 
 namespace AppJsonKeys
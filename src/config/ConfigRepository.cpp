@@ -36,10 +36,12 @@ ConfigRepository::load(AppConfig& cfg)
         return false;
     }
 
-    const String json = FileSystem::readFile(AppPaths::CONFIG_JSON);
     DynamicJsonDocument doc(512);
 
-    if (!JsonUtils::deserialize(json, doc))
+    const bool parsed = FileSystem::readFile(
+        AppPaths::CONFIG_JSON, [&](Stream& in) { return JsonUtils::deserialize(in, doc); }
+    );
+    if (!parsed)
     {
         cfg = temp;
         return false;
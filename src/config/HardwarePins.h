@@ -5,6 +5,7 @@
 #define SCK_PIN 18
 #define MOSI_PIN 23
 #define MISO_PIN 19
+#define RFID_IRQ_PIN 35
 
 #define SERVO_PIN 21
 #define LED_PIN 15
@@ -1,6 +1,7 @@
 #pragma once
 #include "storage/FileSystem.h"
 #include "utils/JsonUtils.h"
+#include "utils/WireCodec.h"
 
 #include <Arduino.h>
 
@@ -15,6 +16,10 @@ struct LockConfig
     int maxPinLength = 10;
 
     uint32_t rfidDebounceMs = 2000;
+    // Wait for the reader's IRQ pin between taps instead of polling it; the
+    // antenna is only on for a few ms per cycle. Needs the IRQ line wired to
+    // RFID_IRQ_PIN; without it the service falls back to polling.
+    bool rfidIrqMode = false;
     uint32_t swipeAddTimeoutMs = 60000;
 
     uint32_t batteryPublishIntervalMs = 60000;
@@ -27,6 +32,20 @@ struct LockConfig
     uint32_t mqttReconnectMaxMs = 60000;
     uint32_t wifiReconnectDelayMs = 5000;
 
+    // Offline event queue (state/log messages published while disconnected)
+    uint32_t outboxMaxEvents = 256;
+    bool outboxDropOldest = true;
+
+    // State/log events are sent together on <base>/events, collected over one
+    // loop() pass or this window. legacyEventTopics also sends each one on
+    // <base>/state and <base>/log as before.
+    uint32_t eventBatchWindowMs = 0;
+    bool legacyEventTopics = false;
+
+    // Payload encoding last negotiated over the info topic, kept across
+    // reboots so a client that switched to MessagePack stays switched.
+    WireFormat wireFormat = WireFormat::Json;
+
     static constexpr const char* CONFIG_PATH = "/lock_config.json";
 
     bool
@@ -35,10 +54,12 @@ struct LockConfig
         if (!FileSystem::exists(CONFIG_PATH))
             return false;
 
-        const String json = FileSystem::readFile(CONFIG_PATH);
         DynamicJsonDocument doc(2048);
 
-        if (!JsonUtils::deserialize(json, doc))
+        const bool parsed = FileSystem::readFile(
+            CONFIG_PATH, [&](Stream& in) { return JsonUtils::deserialize(in, doc); }
+        );
+        if (!parsed)
             return false;
 
         unlockDurationMs = doc["unlockDurationMs"] | unlockDurationMs;
@@ -50,6 +71,7 @@ struct LockConfig
         maxPinLength = doc["maxPinLength"] | maxPinLength;
 
         rfidDebounceMs = doc["rfidDebounceMs"] | rfidDebounceMs;
+        rfidIrqMode = doc["rfidIrqMode"] | rfidIrqMode;
         swipeAddTimeoutMs = doc["swipeAddTimeoutMs"] | swipeAddTimeoutMs;
 
         batteryPublishIntervalMs = doc["batteryPublishIntervalMs"] | batteryPublishIntervalMs;
@@ -62,6 +84,15 @@ struct LockConfig
         mqttReconnectMaxMs = doc["mqttReconnectMaxMs"] | mqttReconnectMaxMs;
         wifiReconnectDelayMs = doc["wifiReconnectDelayMs"] | wifiReconnectDelayMs;
 
+        outboxMaxEvents = doc["outboxMaxEvents"] | outboxMaxEvents;
+        outboxDropOldest = doc["outboxDropOldest"] | outboxDropOldest;
+
+        eventBatchWindowMs = doc["eventBatchWindowMs"] | eventBatchWindowMs;
+        legacyEventTopics = doc["legacyEventTopics"] | legacyEventTopics;
+
+        // Left unchanged when missing or unknown.
+        WireCodec::parse(doc["wireFormat"].as<const char*>(), wireFormat);
+
         return true;
     }
 
@@ -79,6 +110,7 @@ struct LockConfig
         doc["maxPinLength"] = maxPinLength;
 
         doc["rfidDebounceMs"] = rfidDebounceMs;
+        doc["rfidIrqMode"] = rfidIrqMode;
         doc["swipeAddTimeoutMs"] = swipeAddTimeoutMs;
 
         doc["batteryPublishIntervalMs"] = batteryPublishIntervalMs;
@@ -91,6 +123,14 @@ struct LockConfig
         doc["mqttReconnectMaxMs"] = mqttReconnectMaxMs;
         doc["wifiReconnectDelayMs"] = wifiReconnectDelayMs;
 
+        doc["outboxMaxEvents"] = outboxMaxEvents;
+        doc["outboxDropOldest"] = outboxDropOldest;
+
+        doc["eventBatchWindowMs"] = eventBatchWindowMs;
+        doc["legacyEventTopics"] = legacyEventTopics;
+
+        doc["wireFormat"] = WireCodec::name(wireFormat);
+
         return FileSystem::writeFile(CONFIG_PATH, JsonUtils::serialize(doc));
     }
 
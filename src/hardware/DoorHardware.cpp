@@ -3,6 +3,7 @@
 #include "app/AppContext.h"
 #include "config/LockConfig.h"
 #include "utils/Logger.h"
+#include "utils/Profiler.h"
 
 #define TAG "DOOR_HW"
 
@@ -18,17 +19,17 @@ DoorHardware::DoorHardware(
 void
 DoorHardware::begin(AppContext& ctx)
 {
-    Logger::info(TAG, "Initializing DoorHardware");
+    LOG_I(TAG, "Initializing DoorHardware");
 
     ctx_ = &ctx;
 
     lock_.begin(ctx);
-    Logger::info(TAG, "DoorLockModule initialized");
+    LOG_I(TAG, "DoorLockModule initialized");
 
     contact_.setCallback([this](bool isOpen) { onDoorContactChanged_(isOpen); });
     contact_.begin(ctx);
 
-    Logger::info(
+    LOG_I(
         TAG, "DoorContact initialized (initial state: %s)", contact_.isOpen() ? "OPEN" : "CLOSED"
     );
 
@@ -38,6 +39,8 @@ DoorHardware::begin(AppContext& ctx)
 void
 DoorHardware::loop(AppContext& ctx)
 {
+    PROFILE_SCOPE(ProfileSection::Door);
+
     contact_.loop(ctx);
     lock_.loop(ctx);
 }
@@ -47,11 +50,11 @@ DoorHardware::requestUnlock(const String& method)
 {
     if (!ctx_)
     {
-        Logger::warn(TAG, "requestUnlock ignored (ctx is null)");
+        LOG_W(TAG, "requestUnlock ignored (ctx is null)");
         return;
     }
 
-    Logger::info(TAG, "Unlock requested (method=%s)", method.c_str());
+    LOG_I(TAG, "Unlock requested (method=%s)", method.c_str());
     lock_.unlock(*ctx_, method);
 }
 
@@ -60,11 +63,11 @@ DoorHardware::requestLock(const String& reason)
 {
     if (!ctx_)
     {
-        Logger::warn(TAG, "requestLock ignored (ctx is null)");
+        LOG_W(TAG, "requestLock ignored (ctx is null)");
         return;
     }
 
-    Logger::info(TAG, "Lock requested (reason=%s)", reason.c_str());
+    LOG_I(TAG, "Lock requested (reason=%s)", reason.c_str());
     lock_.lock(*ctx_, reason);
 }
 
@@ -79,11 +82,11 @@ DoorHardware::onDoorContactChanged_(bool isOpen)
 {
     if (!ctx_)
     {
-        Logger::warn(TAG, "Door contact changed but ctx is null");
+        LOG_W(TAG, "Door contact changed but ctx is null");
         return;
     }
 
-    Logger::info(TAG, "Door contact changed: %s", isOpen ? "OPEN" : "CLOSED");
+    LOG_I(TAG, "Door contact changed: %s", isOpen ? "OPEN" : "CLOSED");
 
     lock_.onDoorContactChanged(isOpen);
 
@@ -94,12 +97,12 @@ DoorHardware::onDoorContactChanged_(bool isOpen)
 
         if (delayMs == 0)
         {
-            Logger::info(TAG, "Auto-relock immediately (delay=0)");
+            LOG_I(TAG, "Auto-relock immediately (delay=0)");
             lock_.lock(*ctx_, "door_closed");
         }
         else
         {
-            Logger::info(TAG, "Auto-relock scheduled after %d ms", (int)delayMs);
+            LOG_I(TAG, "Auto-relock scheduled after %d ms", (int)delayMs);
 
             ctx_->app.doorLock.rearmAutoRelock(delayMs);
             ctx_->publish.publishLog("RelockScheduled", "Device", String(delayMs) + "ms");
@@ -38,7 +38,7 @@ DoorLockModule::begin(AppContext&)
 void
 DoorLockModule::unlock(AppContext& ctx, const String& method)
 {
-    Logger::info(TAG, "UNLOCK requested (method=%s)", method.c_str());
+    LOG_I(TAG, "UNLOCK requested (method=%s)", method.c_str());
 
     servo_.write(UNLOCK_ANGLE);
 
@@ -61,7 +61,7 @@ DoorLockModule::unlock(AppContext& ctx, const String& method)
 void
 DoorLockModule::lock(AppContext& ctx, const String& reason)
 {
-    Logger::info(TAG, "LOCK requested (reason=%s)", reason.c_str());
+    LOG_I(TAG, "LOCK requested (reason=%s)", reason.c_str());
 
     servo_.write(LOCK_ANGLE);
 
@@ -81,22 +81,22 @@ DoorLockModule::handleAutoRelock_(AppContext& ctx)
 {
     if (isDoorContactOpen_)
     {
-        Logger::info(TAG, "AutoRelock SKIPPED: door is OPEN");
+        LOG_I(TAG, "AutoRelock SKIPPED: door is OPEN");
         return;
     }
 
     if (!ctx.app.doorLock.shouldAutoRelock())
     {
-        Logger::debug(TAG, "AutoRelock not due yet");
+        LOG_D(TAG, "AutoRelock not due yet");
         return;
     }
 
-    Logger::info(TAG, "AutoRelock EXECUTE");
+    LOG_I(TAG, "AutoRelock EXECUTE");
 
     servo_.write(LOCK_ANGLE);
     digitalWrite(ledPin_, LOW);
 
-    Logger::info(TAG, "Servo moved to LOCK by AUTO, LED OFF");
+    LOG_I(TAG, "Servo moved to LOCK by AUTO, LED OFF");
 
     ctx.app.doorLock.lock();
     ctx.app.deviceState.setDoorState(DoorState::LOCKED);
@@ -126,7 +126,7 @@ DoorLockModule::loop(AppContext& ctx)
     if ((int32_t)(now - autoRelockAtMs_) < 0)
         return;
 
-    Logger::info(TAG, "AutoRelock EXECUTE");
+    LOG_I(TAG, "AutoRelock EXECUTE");
 
     servo_.write(LOCK_ANGLE);
     digitalWrite(ledPin_, LOW);
@@ -0,0 +1,148 @@
+#include "hardware/KeypadScanner.h"
+
+#include "config/HardwarePins.h"
+#include "utils/Logger.h"
+#include "utils/Scheduler.h"
+
+namespace
+{
+constexpr const char* TAG = "KEYSCAN";
+
+constexpr uint8_t ROWS = 4;
+constexpr uint8_t COLS = 4;
+
+const char KEYS[ROWS][COLS] = {
+    {'D', 'C', 'B', 'A'}, {'#', '9', '6', '3'}, {'0', '8', '5', '2'}, {'*', '7', '4', '1'}
+};
+
+const uint8_t ROW_PINS[ROWS] = {KEYPAD_ROW_1, KEYPAD_ROW_2, KEYPAD_ROW_3, KEYPAD_ROW_4};
+
+const uint8_t COL_PINS[COLS] = {KEYPAD_COL_1, KEYPAD_COL_2, KEYPAD_COL_3, KEYPAD_COL_4};
+} // namespace
+
+void
+KeypadScanner::begin()
+{
+    for (uint8_t r = 0; r < ROWS; ++r)
+        pinMode(ROW_PINS[r], INPUT_PULLUP);
+
+    // Columns idle as inputs and are driven low one at a time while scanning.
+    for (uint8_t c = 0; c < COLS; ++c)
+        pinMode(COL_PINS[c], INPUT);
+
+    esp_timer_create_args_t args = {};
+    args.callback = &KeypadScanner::onTimer_;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "keypad";
+
+    if (esp_timer_create(&args, &timer_) != ESP_OK ||
+        esp_timer_start_periodic(timer_, SCAN_PERIOD_US) != ESP_OK)
+    {
+        LOG_W(TAG, "scan timer unavailable, scanning from the loop");
+        timer_ = nullptr;
+        return;
+    }
+
+    LOG_I(TAG, "scanning every %u us", (unsigned)SCAN_PERIOD_US);
+}
+
+void
+KeypadScanner::poll()
+{
+    if (timer_)
+        return;
+
+    const uint32_t now = micros();
+    if (now - lastPollUs_ < SCAN_PERIOD_US)
+        return;
+
+    lastPollUs_ = now;
+    scan_();
+}
+
+bool
+KeypadScanner::timerRunning() const
+{
+    return timer_ != nullptr;
+}
+
+bool
+KeypadScanner::next(KeyEvent& out)
+{
+    const size_t len = events_.beginRead();
+    if (len == 0)
+        return false;
+
+    const bool ok = len == sizeof(out) && events_.read(&out, sizeof(out)) == sizeof(out);
+    events_.endRead();
+    return ok;
+}
+
+uint32_t
+KeypadScanner::dropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void
+KeypadScanner::onTimer_(void* arg)
+{
+    static_cast<KeypadScanner*>(arg)->scan_();
+}
+
+void
+KeypadScanner::scan_()
+{
+    const uint16_t raw = readMatrix_();
+
+    if (raw != raw_)
+    {
+        raw_ = raw;
+        sameScans_ = 0;
+        return;
+    }
+
+    if (sameScans_ < DEBOUNCE_SCANS)
+        sameScans_++;
+    if (sameScans_ != DEBOUNCE_SCANS || raw == stable_)
+        return;
+
+    const uint16_t pressed = raw & ~stable_;
+    stable_ = raw;
+
+    const int64_t now = esp_timer_get_time();
+    for (uint8_t i = 0; i < ROWS * COLS; ++i)
+    {
+        if (!(pressed & (1u << i)))
+            continue;
+
+        const KeyEvent e{KEYS[i / COLS][i % COLS], now};
+        if (!events_.push(&e, sizeof(e)))
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (pressed)
+        Scheduler::notify(WakeEvent::KEY);
+}
+
+uint16_t
+KeypadScanner::readMatrix_()
+{
+    uint16_t bits = 0;
+
+    for (uint8_t c = 0; c < COLS; ++c)
+    {
+        pinMode(COL_PINS[c], OUTPUT);
+        digitalWrite(COL_PINS[c], LOW);
+
+        for (uint8_t r = 0; r < ROWS; ++r)
+        {
+            if (digitalRead(ROW_PINS[r]) == LOW)
+                bits |= 1u << (r * COLS + c);
+        }
+
+        pinMode(COL_PINS[c], INPUT);
+    }
+    return bits;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "utils/SpscByteRing.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+
+struct KeyEvent
+{
+    char key;
+    int64_t atUs; // esp_timer_get_time() when the press was debounced
+};
+
+// Scans the 4x4 matrix from a periodic esp_timer, debounces in the
+// background and queues presses, so keys are not lost while the app loop is
+// busy writing flash or reconnecting. The timer task is the only producer
+// and the app loop the only consumer.
+class KeypadScanner
+{
+  public:
+    static constexpr uint32_t SCAN_PERIOD_US = 5000;
+    static constexpr uint8_t DEBOUNCE_SCANS = 4; // ~20 ms stable
+
+    // Falls back to scanning from poll() if the timer cannot be started.
+    void
+    begin();
+
+    // Only needed without the timer; a no-op otherwise.
+    void
+    poll();
+
+    bool
+    timerRunning() const;
+
+    bool
+    next(KeyEvent& out);
+
+    uint32_t
+    dropped() const;
+
+  private:
+    static void
+    onTimer_(void* arg);
+
+    void
+    scan_();
+
+    uint16_t
+    readMatrix_();
+
+    SpscByteRing<256> events_;
+    std::atomic<uint32_t> dropped_{0};
+
+    esp_timer_handle_t timer_{nullptr};
+    uint32_t lastPollUs_{0};
+
+    // Scanner-side state.
+    uint16_t raw_{0};
+    uint16_t stable_{0};
+    uint8_t sameScans_{0};
+};
@@ -5,6 +5,7 @@
 #include "models/RuntimeFlags.h"
 #include "models/SwipeAddState.h"
 #include "models/WifiProvisionState.h"
+#include "utils/WireCodec.h"
 
 #include <Arduino.h>
 
@@ -17,6 +18,9 @@ struct AppState
     String doorCode = "";
     String doorName = "";
 
+    // Negotiated over the info topic; persisted in LockConfig::wireFormat.
+    WireFormat wireFormat = WireFormat::Json;
+
     SwipeAddState swipeAdd;
     PinAuthState pinAuth;
     DoorLockState doorLock;
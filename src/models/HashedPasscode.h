@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+#include <string.h>
+
+// HMAC-SHA256 of a passcode under the device's passcode key.
+struct PasscodeDigest
+{
+    static constexpr size_t kBytes = 32;
+
+    uint8_t bytes[kBytes] = {};
+
+    // Leading bits of the digest; the key for PasscodeIndex.
+    uint32_t
+    tag() const
+    {
+        uint32_t t;
+        memcpy(&t, bytes, sizeof(t));
+        return t;
+    }
+
+    // All-zero: no digest (a cleared master).
+    bool
+    isZero() const
+    {
+        for (size_t i = 0; i < kBytes; ++i)
+        {
+            if (bytes[i] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Constant time, like SecureCompare.
+    bool
+    matches(const PasscodeDigest& other) const
+    {
+        volatile uint8_t diff = 0;
+        for (size_t i = 0; i < kBytes; ++i)
+            diff |= (uint8_t)(bytes[i] ^ other.bytes[i]);
+        return diff == 0;
+    }
+};
+
+// A passcode as PasscodeRepository keeps it, in RAM, on flash and in the
+// lists and deltas it publishes: the digest of the code, never the code.
+struct HashedPasscode
+{
+    enum class Type : uint8_t
+    {
+        OneTime = 1,
+        Timed = 2,
+        Master = 3
+    };
+
+    // Hex of the leading digest bytes: the public handle for an item.
+    static constexpr size_t kIdBytes = 8;
+    static constexpr size_t kIdChars = 2 * kIdBytes;
+
+    PasscodeDigest digest;
+    Type type{Type::Timed};
+    uint64_t effectiveAt{0}; // unix seconds
+    uint64_t expireAt{0};    // 0 = không hết hạn
+
+    bool
+    isEffective(uint64_t now) const
+    {
+        return effectiveAt == 0 || now >= effectiveAt;
+    }
+
+    bool
+    isExpired(uint64_t now) const
+    {
+        return expireAt > 0 && now >= expireAt;
+    }
+
+    // `out` holds kIdChars + 1 chars; empty for a zero digest.
+    void
+    formatId(char* out) const
+    {
+        if (digest.isZero())
+        {
+            out[0] = '\0';
+            return;
+        }
+
+        static const char kDigits[] = "0123456789abcdef";
+        for (size_t i = 0; i < kIdBytes; ++i)
+        {
+            out[2 * i] = kDigits[digest.bytes[i] >> 4];
+            out[2 * i + 1] = kDigits[digest.bytes[i] & 0x0F];
+        }
+        out[kIdChars] = '\0';
+    }
+
+    bool
+    hasId(const char* id) const
+    {
+        char own[kIdChars + 1];
+        formatId(own);
+        return strcmp(own, id) == 0;
+    }
+
+    const char*
+    typeName() const
+    {
+        switch (type)
+        {
+        case Type::OneTime:
+            return "one_time";
+        case Type::Timed:
+            return "timed";
+        case Type::Master:
+            return "master";
+        }
+        return "";
+    }
+
+    // Item types only; the master is never parsed from a request type.
+    static bool
+    parseType(const String& name, Type& out)
+    {
+        if (name == "one_time")
+            out = Type::OneTime;
+        else if (name == "timed")
+            out = Type::Timed;
+        else
+            return false;
+        return true;
+    }
+};
@@ -1,16 +1,22 @@
 #pragma once
+#include "utils/FixedString.h"
+
 #include <Arduino.h>
 
 struct PinAuthState
 {
-    String buffer = "";
+    // Hard cap on digits; LockConfig::maxPinLength may only lower it.
+    static constexpr size_t kMaxDigits = 16;
+    using Buffer = FixedString<kMaxDigits>;
+
+    Buffer buffer;
     int failedCount = 0;
     uint32_t lockoutUntilMs = 0;
 
     void
     clearBuffer()
     {
-        buffer = "";
+        buffer.wipe();
     }
 
     bool
@@ -19,11 +25,10 @@ struct PinAuthState
         if ((int)buffer.length() >= maxLen)
             return false;
 
-        buffer += digit;
-        return true;
+        return buffer.append(digit);
     }
 
-    String
+    const Buffer&
     getBuffer() const
     {
         return buffer;
@@ -77,7 +82,7 @@ struct PinAuthState
     void
     reset()
     {
-        buffer = "";
+        buffer.wipe();
         failedCount = 0;
         lockoutUntilMs = 0;
     }
@@ -1,20 +1,25 @@
 #pragma once
+#include "utils/FixedString.h"
+
 #include <Arduino.h>
 
+// Upper-case hex of an ISO 14443 UID: at most 10 bytes, two digits each.
+using CardUidHex = FixedString<20>;
+
 struct SwipeAddState
 {
-    String firstSwipeUid = "";
+    CardUidHex firstSwipeUid;
     uint32_t timeoutMs = 0;
 
     void
     start(uint32_t timeoutDurationMs)
     {
-        firstSwipeUid = "";
+        firstSwipeUid.clear();
         timeoutMs = millis() + timeoutDurationMs;
     }
 
     void
-    recordFirstSwipe(const String& uid, uint32_t timeoutDurationMs)
+    recordFirstSwipe(const CardUidHex& uid, uint32_t timeoutDurationMs)
     {
         firstSwipeUid = uid;
         timeoutMs = millis() + timeoutDurationMs;
@@ -32,11 +37,11 @@ struct SwipeAddState
     bool
     hasFirstSwipe() const
     {
-        return firstSwipeUid.length() > 0;
+        return !firstSwipeUid.isEmpty();
     }
 
     bool
-    matchesFirstSwipe(const String& uid) const
+    matchesFirstSwipe(const CardUidHex& uid) const
     {
         return hasFirstSwipe() && firstSwipeUid == uid;
     }
@@ -44,7 +49,7 @@ struct SwipeAddState
     void
     reset()
     {
-        firstSwipeUid = "";
+        firstSwipeUid.clear();
         timeoutMs = 0;
     }
 
@@ -3,8 +3,104 @@
 #include "ca_cert.h"
 #include "network/RetryPolicy.h"
 #include "utils/Logger.h"
+#include "utils/Profiler.h"
+#include "utils/Scheduler.h"
+#include "utils/SpscByteRing.h"
 
-#include <ArduinoJson.h>
+#include <atomic>
+
+namespace
+{
+enum class OutKind : uint8_t
+{
+    Publish = 1,
+    Subscribe = 2
+};
+
+// Outbound frame: kind(u8) arg(u8: retained or qos) topicLen(u8) topic payload
+// Inbound frame:  topicLen(u8) topic payload
+constexpr size_t kOutHeader = 3;
+constexpr size_t kMaxTopic = 255;
+
+// Matches setBufferSize(); PubSubClient never delivers more than that.
+constexpr size_t kMaxInbound = 2048;
+
+// Enough for a full snapshot page plus a burst of state/log messages.
+SpscByteRing<8192> outbound; // app loop -> network task
+SpscByteRing<4096> inbound;  // network task -> app loop
+
+// Bounds the time either side spends per pass.
+constexpr size_t kOutboundPerLoop = 8;
+constexpr size_t kInboundPerLoop = 4;
+
+// Publish frames are numbered in queue order on both sides of the ring; the
+// network task records which ones it actually wrote.
+constexpr size_t kTrackedPublishes = 64;
+uint32_t s_queuedSeq = 0; // app loop
+uint32_t s_readSeq = 0;   // network task
+std::atomic<uint32_t> s_settledSeq{0};
+std::atomic<uint32_t> s_writtenSeq[kTrackedPublishes];
+
+void
+settlePublish(bool written)
+{
+    const uint32_t seq = ++s_readSeq;
+    if (written)
+        s_writtenSeq[seq % kTrackedPublishes].store(seq, std::memory_order_relaxed);
+    s_settledSeq.store(seq, std::memory_order_release);
+}
+
+bool
+endOutboundPublish()
+{
+    if (!outbound.endWrite())
+        return false;
+
+    s_queuedSeq++;
+    return true;
+}
+
+std::atomic<bool> s_connected{false};
+std::atomic<uint32_t> s_sessions{0};
+std::atomic<int> s_retryAttempts{0};
+
+MqttCallback s_appCallback = nullptr;
+
+bool
+beginOutbound(OutKind kind, uint8_t arg, const char* topic, size_t payloadLen)
+{
+    const size_t topicLen = strlen(topic);
+    if (topicLen == 0 || topicLen > kMaxTopic)
+        return false;
+
+    if (!outbound.beginWrite(kOutHeader + topicLen + payloadLen))
+        return false;
+
+    const uint8_t hdr[kOutHeader] = {(uint8_t)kind, arg, (uint8_t)topicLen};
+    outbound.write(hdr, sizeof(hdr));
+    outbound.write(topic, topicLen);
+    return true;
+}
+
+// Lets WireCodec encode directly into a reserved outbound frame.
+class OutboundWriter : public Print
+{
+  public:
+    size_t
+    write(uint8_t c) override
+    {
+        outbound.write(&c, 1);
+        return 1;
+    }
+
+    size_t
+    write(const uint8_t* data, size_t size) override
+    {
+        outbound.write(data, size);
+        return size;
+    }
+};
+} // namespace
 
 static WiFiClientSecure secureClient;
 static PubSubClient mqtt(secureClient);
@@ -36,19 +132,28 @@ MqttManager::setupClient()
     mqtt.setServer(config.mqttHost.c_str(), config.mqttPort);
     mqtt.setKeepAlive(60);
     mqtt.setSocketTimeout(30);
-    mqtt.setBufferSize(8192);
+    // Outbound payloads are streamed past this buffer; it only has to hold
+    // the largest inbound command.
+    mqtt.setBufferSize(kMaxInbound);
+    mqtt.setCallback(&MqttManager::onMessage_);
 }
 
 void
 MqttManager::setCallback(MqttCallback cb)
 {
-    mqtt.setCallback(cb);
+    s_appCallback = cb;
 }
 
 bool
 MqttManager::connected()
 {
-    return mqtt.connected();
+    return s_connected.load(std::memory_order_acquire);
+}
+
+uint32_t
+MqttManager::sessionCount()
+{
+    return s_sessions.load(std::memory_order_acquire);
 }
 
 void
@@ -57,6 +162,7 @@ MqttManager::reconnect()
     if (!initialized || mqtt.connected())
     {
         retryPolicy.reset();
+        s_retryAttempts.store(0, std::memory_order_relaxed);
         return;
     }
 
@@ -66,26 +172,30 @@ MqttManager::reconnect()
     if (!retryPolicy.shouldRetry())
         return;
 
-    Logger::info(
+    LOG_I(
         "MQTT", "Connecting to %s:%d (attempt %d, delay %dms)", config.mqttHost.c_str(),
         config.mqttPort, retryPolicy.getAttemptCount() + 1, (int)retryPolicy.getCurrentDelay()
     );
 
     retryPolicy.recordAttempt();
+    s_retryAttempts.store(retryPolicy.getAttemptCount(), std::memory_order_relaxed);
 
     if (!mqtt.connect(clientId.c_str(), config.mqttUser.c_str(), config.mqttPass.c_str()))
     {
-        Logger::error("MQTT", "Connect failed rc=%d", mqtt.state());
+        LOG_E("MQTT", "Connect failed rc=%d", mqtt.state());
 
         if (retryPolicy.getAttemptCount() >= 5)
         {
-            Logger::warn("MQTT", "Next retry in %ds", (int)(retryPolicy.getCurrentDelay() / 1000));
+            LOG_W("MQTT", "Next retry in %ds", (int)(retryPolicy.getCurrentDelay() / 1000));
         }
         return;
     }
 
-    Logger::info("MQTT", "Connected successfully");
+    LOG_I("MQTT", "Connected successfully");
     retryPolicy.reset();
+    s_retryAttempts.store(0, std::memory_order_relaxed);
+    s_sessions.fetch_add(1, std::memory_order_release);
+    Scheduler::notify(WakeEvent::NETWORK);
 }
 
 void
@@ -95,173 +205,230 @@ MqttManager::loop()
     {
         mqtt.loop();
     }
+
+    drainOutbound_();
+    s_connected.store(mqtt.connected(), std::memory_order_release);
 }
 
-bool
-MqttManager::publish(const String& topic, const String& payload, bool retained)
+void
+MqttManager::onMessage_(char* topic, byte* payload, unsigned int length)
 {
-    if (!mqtt.connected())
+    const size_t topicLen = strlen(topic);
+    const uint8_t tl = (uint8_t)topicLen;
+
+    if (topicLen > kMaxTopic || !inbound.beginWrite(1 + topicLen + length))
     {
-        Logger::warn("MQTT", "Publish skipped - not connected");
-        return false;
+        LOG_W("MQTT", "Inbound dropped topic=%s len=%u", topic, length);
+        return;
     }
 
-    const int stateBefore = mqtt.state();
+    inbound.write(&tl, 1);
+    inbound.write(topic, topicLen);
+    inbound.write(payload, length);
+    if (inbound.endWrite())
+        Scheduler::notify(WakeEvent::NETWORK);
+}
 
-    const bool success = mqtt.publish(topic.c_str(), payload.c_str(), retained);
+void
+MqttManager::dispatchInbound()
+{
+    static char topic[kMaxTopic + 1];
+    static uint8_t payload[kMaxInbound];
+
+    for (size_t n = 0; n < kInboundPerLoop; ++n)
+    {
+        if (inbound.beginRead() == 0)
+            return;
+
+        uint8_t topicLen = 0;
+        inbound.read(&topicLen, 1);
+        inbound.read(topic, topicLen);
+        topic[topicLen] = '\0';
+
+        const size_t length = inbound.read(payload, sizeof(payload));
+        inbound.endRead();
+
+        if (s_appCallback)
+            s_appCallback(topic, payload, length);
+    }
+}
 
-    const int stateAfter = mqtt.state();
-    const bool connectedAfter = mqtt.connected();
+void
+MqttManager::drainOutbound_()
+{
+    char topic[kMaxTopic + 1];
+    uint8_t chunk[256];
 
-    if (success)
+    for (size_t n = 0; n < kOutboundPerLoop; ++n)
     {
-        Logger::info(
-            "MQTT", "Publish OK topic=%s size=%d retained=%d", topic.c_str(), payload.length(),
-            retained
-        );
+        const size_t frameLen = outbound.beginRead();
+        if (frameLen == 0)
+            return;
 
-        if (stateBefore != stateAfter)
+        uint8_t hdr[kOutHeader];
+        outbound.read(hdr, sizeof(hdr));
+        outbound.read(topic, hdr[2]);
+        topic[hdr[2]] = '\0';
+
+        const OutKind kind = (OutKind)hdr[0];
+        const size_t len = frameLen - kOutHeader - hdr[2];
+
+        if (!mqtt.connected())
         {
-            Logger::warn(
-                "MQTT", "State changed after publish: %d -> %d, connected=%d",
-                stateBefore, stateAfter, connectedAfter
-            );
+            LOG_W("MQTT", "Dropped while offline topic=%s", topic);
+            outbound.endRead();
+            if (kind == OutKind::Publish)
+                settlePublish(false);
+            continue;
         }
 
-        if (payload.length() > 0 && (payload[0] == '{' || payload[0] == '['))
+        if (kind == OutKind::Subscribe)
         {
-            StaticJsonDocument<1024> doc;
-            DeserializationError err = deserializeJson(doc, payload);
-
-            if (!err)
-            {
-                String pretty;
-                serializeJsonPretty(doc, pretty);
-                Logger::info("MQTT", "Payload:\n%s", pretty.c_str());
-            }
+            if (mqtt.subscribe(topic, hdr[1]))
+                LOG_I("MQTT", "Subscribed: %s", topic);
             else
-            {
-                Logger::warn("MQTT", "JSON parse failed (%s), raw: %s", err.c_str(), payload.c_str());
-            }
+                LOG_E("MQTT", "Subscribe failed: %s", topic);
+
+            outbound.endRead();
+            continue;
         }
-        else
+
+        const bool retained = hdr[1] != 0;
+        if (!mqtt.beginPublish(topic, len, retained))
         {
-            // Plain text payload
-            Logger::info("MQTT", "Payload: %s", payload.c_str());
+            LOG_E("MQTT", "Publish begin FAILED topic=%s state=%d", topic, mqtt.state());
+            outbound.endRead();
+            settlePublish(false);
+            continue;
         }
-    }
-    else
-    {
-        Logger::error(
-            "MQTT", "Publish FAILED topic=%s size=%d retained=%d state=%d->%d", topic.c_str(),
-            payload.length(), retained, stateBefore, stateAfter
-        );
-    }
 
-    return success;
-}
+        // Chunked so each TLS record carries a useful amount of payload.
+        size_t written = 0;
+        size_t got;
+        while ((got = outbound.read(chunk, sizeof(chunk))) > 0)
+            written += mqtt.write(chunk, got);
+        outbound.endRead();
 
-void
-MqttManager::subscribe(const String& topic, int qos)
-{
-    if (!mqtt.connected())
-        return;
+        if (!mqtt.endPublish() || written != len)
+        {
+            LOG_E(
+                "MQTT", "Publish FAILED topic=%s wrote=%u/%u state=%d", topic,
+                (unsigned)written, (unsigned)len, mqtt.state()
+            );
+            settlePublish(false);
+            continue;
+        }
 
-    const bool success = mqtt.subscribe(topic.c_str(), qos);
-    if (success)
-    {
-        Logger::info("MQTT", "Subscribed: %s", topic.c_str());
-    }
-    else
-    {
-        Logger::error("MQTT", "Subscribe failed: %s", topic.c_str());
+        settlePublish(true);
+
+        LOG_I(
+            "MQTT", "Publish OK topic=%s size=%u retained=%d", topic, (unsigned)len, retained
+        );
     }
 }
 
-int
-MqttManager::getRetryAttempts()
+bool
+MqttManager::publish(const char* topic, const String& payload, bool retained)
 {
-    return retryPolicy.getAttemptCount();
-}
+    PROFILE_SCOPE(ProfileSection::MqttPublish);
 
-class StringPrinter : public Print
-{
-public:
-    String buffer;
-    
-    size_t write(uint8_t c) override
+    if (!connected())
     {
-        buffer += (char)c;
-        return 1;
+        LOG_W("MQTT", "Publish skipped - not connected");
+        return false;
     }
-    
-    size_t write(const uint8_t* buf, size_t size) override
+
+    if (!beginOutbound(OutKind::Publish, retained, topic, payload.length()))
     {
-        buffer.reserve(buffer.length() + size);
-        for (size_t i = 0; i < size; i++)
-        {
-            buffer += (char)buf[i];
-        }
-        return size;
+        LOG_E(
+            "MQTT", "Publish queue full topic=%s size=%u", topic,
+            (unsigned)payload.length()
+        );
+        return false;
     }
-};
+
+    outbound.write(payload.c_str(), payload.length());
+    return endOutboundPublish();
+}
 
 bool
-MqttManager::publishStream(
-    const String& topic,
-    std::function<void(Print&)> writer,
-    bool retained
+MqttManager::publishDoc(
+    const char* topic, const JsonDocument& doc, WireFormat format, bool retained
 )
 {
-    if (!mqtt.connected())
-    {
-        Logger::error("MQTT", "PublishStream FAILED - not connected");
-        return false;
-    }
+    PROFILE_SCOPE(ProfileSection::MqttPublish);
 
-    StringPrinter printer;
-    
-    try
-    {
-        writer(printer);
-    }
-    catch (...)
+    if (!connected())
     {
-        Logger::error("MQTT", "Writer callback EXCEPTION");
+        LOG_E("MQTT", "PublishDoc FAILED - not connected");
         return false;
     }
 
-    const String& payload = printer.buffer;
-
-    if (payload.length() == 0)
+    const size_t len = WireCodec::measure(doc, format);
+    if (len == 0)
     {
-        Logger::warn("MQTT", "PublishStream empty payload topic=%s", topic.c_str());
+        LOG_W("MQTT", "PublishDoc empty payload topic=%s", topic);
         return false;
     }
 
-    if (payload.length() > 8192)
+    if (!beginOutbound(OutKind::Publish, retained, topic, len))
     {
-        Logger::error(
-            "MQTT", "PublishStream payload TOO LARGE (%d bytes) topic=%s", 
-            payload.length(), topic.c_str()
+        LOG_E(
+            "MQTT", "PublishDoc queue full topic=%s size=%u free=%u", topic,
+            (unsigned)len, (unsigned)outbound.freeSpace()
         );
         return false;
     }
 
-    Logger::info(
-        "MQTT", "PublishStream topic=%s size=%d retained=%d", 
-        topic.c_str(), payload.length(), retained
-    );
+    OutboundWriter out;
+    WireCodec::encode(doc, out, format);
+    return endOutboundPublish();
+}
 
-    const bool success = publish(topic, payload, false);
+void
+MqttManager::subscribe(const char* topic, int qos)
+{
+    if (!connected())
+        return;
 
-    if (!success)
-    {
-        Logger::error("MQTT", "PublishStream FAILED topic=%s state=%d", topic.c_str(), mqtt.state());
-        return false;
-    }
+    if (!beginOutbound(OutKind::Subscribe, (uint8_t)qos, topic, 0) || !outbound.endWrite())
+        LOG_E("MQTT", "Subscribe queue full: %s", topic);
+}
 
-    Logger::info("MQTT", "PublishStream OK topic=%s", topic.c_str());
+size_t
+MqttManager::outboundFree()
+{
+    const size_t free = outbound.freeSpace();
+    const size_t overhead = kOutHeader + kMaxTopic;
+    return free > overhead ? free - overhead : 0;
+}
 
-    return true;
-}
\ No newline at end of file
+bool
+MqttManager::outboundFits(size_t payloadBytes, size_t frames)
+{
+    return frames * (kOutHeader + kMaxTopic + payloadBytes) <= outbound.freeSpace();
+}
+
+uint32_t
+MqttManager::lastQueued()
+{
+    return s_queuedSeq;
+}
+
+Delivery
+MqttManager::delivery(uint32_t seq)
+{
+    const uint32_t settled = s_settledSeq.load(std::memory_order_acquire);
+    if ((int32_t)(settled - seq) < 0)
+        return Delivery::Pending;
+
+    return s_writtenSeq[seq % kTrackedPublishes].load(std::memory_order_relaxed) == seq
+               ? Delivery::Written
+               : Delivery::Failed;
+}
+
+int
+MqttManager::getRetryAttempts()
+{
+    return s_retryAttempts.load(std::memory_order_relaxed);
+}
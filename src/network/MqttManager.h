@@ -1,45 +1,94 @@
 #pragma once
 #include "config/AppConfig.h"
+#include "utils/WireCodec.h"
 
+#include <ArduinoJson.h>
 #include <PubSubClient.h>
 #include <WiFiClientSecure.h>
-#include <functional>
-#include <Print.h>
 
 using MqttCallback = void (*)(char*, byte*, unsigned int);
 
+// What became of a queued publish, by the sequence number from lastQueued().
+enum class Delivery : uint8_t
+{
+    Pending, // still in the outbound ring
+    Written, // handed to the broker connection
+    Failed   // dropped offline or the write failed
+};
+
+// The client itself is owned by the network task (see NetworkManager). The
+// app loop talks to it through two lock-free rings: publishes and subscribes
+// are queued outbound, received messages are queued inbound and handed to
+// the callback from dispatchInbound().
 class MqttManager
 {
   public:
+    // ---- network task ----
     static void
     begin(const AppConfig& cfg, const String& clientId);
 
+    // Services the client and sends everything queued outbound.
     static void
     loop();
 
+    static void
+    reconnect();
+
+    // ---- app loop ----
     static bool
     connected();
 
-    static void
-    reconnect();
+    // Bumped on every successful connect, so a drop and reconnect between two
+    // app loop passes is still noticed (subscriptions must be renewed).
+    static uint32_t
+    sessionCount();
+
+    static bool
+    publish(const char* topic, const String& payload, bool retained = false);
 
+    // Encodes `doc` straight into the outbound ring; no payload String.
     static bool
-    publish(const String& topic, const String& payload, bool retained = false);
+    publishDoc(
+        const char* topic, const JsonDocument& doc, WireFormat format, bool retained = false
+    );
 
     static void
-    subscribe(const String& topic, int qos = 1);
+    subscribe(const char* topic, int qos = 1);
 
     static void
     setCallback(MqttCallback cb);
 
-    static int
-    getRetryAttempts();
+    // Delivers queued inbound messages to the callback.
+    static void
+    dispatchInbound();
+
+    // Largest payload that can be queued right now.
+    static size_t
+    outboundFree();
+
+    // True if `frames` publishes of `payloadBytes` each can be queued now.
+    static bool
+    outboundFits(size_t payloadBytes, size_t frames);
 
-    static bool 
-    publishStream(const String& topic, std::function<void(Print&)> writer, bool retained = false);
+    // Sequence number of the last publish queued by publish()/publishDoc().
+    static uint32_t
+    lastQueued();
 
+    // Only the last 64 publishes are remembered; older ones
+    // report Failed, so callers resend rather than lose them.
+    static Delivery
+    delivery(uint32_t seq);
+
+    static int
+    getRetryAttempts();
 
   private:
     static void
     setupClient();
+
+    static void
+    onMessage_(char* topic, byte* payload, unsigned int length);
+
+    static void
+    drainOutbound_();
 };
@@ -2,26 +2,62 @@
 
 #include "network/MqttManager.h"
 #include "network/WifiManager.h"
+#include "utils/Logger.h"
+
+namespace
+{
+constexpr const char* TAG = "NET";
+
+// The Arduino loop task runs on core 1; WiFi and lwIP already live on core 0.
+constexpr BaseType_t kTaskCore = 0;
+constexpr UBaseType_t kTaskPriority = 1;
+// mbedTLS handshakes need roughly what the Arduino loop task is given.
+constexpr uint32_t kTaskStackBytes = 8192;
+constexpr TickType_t kTaskPeriod = pdMS_TO_TICKS(10);
+
+TaskHandle_t s_task = nullptr;
+
+SemaphoreHandle_t s_cfgLock = nullptr;
+AppConfig s_pendingCfg;
+String s_pendingClientId;
+bool s_pending = false;
+} // namespace
 
 void
 NetworkManager::begin(const AppConfig& cfg, const String& clientId)
 {
+    if (s_task)
+    {
+        // Applied by the network task between two service passes.
+        xSemaphoreTake(s_cfgLock, portMAX_DELAY);
+        s_pendingCfg = cfg;
+        s_pendingClientId = clientId;
+        s_pending = true;
+        xSemaphoreGive(s_cfgLock);
+        return;
+    }
+
     WifiManager::begin(cfg);
     MqttManager::begin(cfg, clientId);
+
+    s_cfgLock = xSemaphoreCreateMutex();
+    if (!s_cfgLock || xTaskCreatePinnedToCore(
+                          &NetworkManager::taskMain_, "net", kTaskStackBytes, nullptr,
+                          kTaskPriority, &s_task, kTaskCore
+                      ) != pdPASS)
+    {
+        LOG_E(TAG, "network task not started, servicing from loop()");
+        s_task = nullptr;
+    }
 }
 
 void
 NetworkManager::loop()
 {
-    WifiManager::loop();
-
-    if (!WifiManager::connected())
-        return;
-
-    if (!MqttManager::connected())
-        MqttManager::reconnect();
+    if (!s_task)
+        service_();
 
-    MqttManager::loop();
+    MqttManager::dispatchInbound();
 }
 
 bool
@@ -29,3 +65,48 @@ NetworkManager::online()
 {
     return WifiManager::connected() && MqttManager::connected();
 }
+
+void
+NetworkManager::taskMain_(void*)
+{
+    LOG_I(TAG, "network task running on core %d", (int)xPortGetCoreID());
+
+    for (;;)
+    {
+        applyPendingConfig_();
+        service_();
+        vTaskDelay(kTaskPeriod);
+    }
+}
+
+void
+NetworkManager::applyPendingConfig_()
+{
+    if (!s_cfgLock || xSemaphoreTake(s_cfgLock, 0) != pdTRUE)
+        return;
+
+    if (!s_pending)
+    {
+        xSemaphoreGive(s_cfgLock);
+        return;
+    }
+
+    const AppConfig cfg = s_pendingCfg;
+    const String clientId = s_pendingClientId;
+    s_pending = false;
+    xSemaphoreGive(s_cfgLock);
+
+    WifiManager::begin(cfg);
+    MqttManager::begin(cfg, clientId);
+}
+
+void
+NetworkManager::service_()
+{
+    WifiManager::loop();
+
+    if (WifiManager::connected() && !MqttManager::connected())
+        MqttManager::reconnect();
+
+    MqttManager::loop();
+}
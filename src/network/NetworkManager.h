@@ -1,16 +1,29 @@
 #pragma once
 #include "config/AppConfig.h"
 
+// WiFi and MQTT (including the blocking TLS handshake) run in a dedicated
+// task pinned to core 0, so broker outages never stall the app loop.
 class NetworkManager
 {
   public:
+    // First call starts the network task; later calls hand it a new config.
     static void
     begin(const AppConfig& cfg, const String& clientId);
 
+    // App loop side: delivers received MQTT messages.
     static void
     loop();
 
     static bool
     online();
 
+  private:
+    static void
+    taskMain_(void* arg);
+
+    static void
+    applyPendingConfig_();
+
+    static void
+    service_();
 };
@@ -33,7 +33,7 @@ WifiManager::begin(const AppConfig& cfg)
 {
     if (!cfg.hasWifi())
     {
-        Logger::warn("WiFi", "No WiFi config");
+        LOG_W("WiFi", "No WiFi config");
         return;
     }
 
@@ -45,8 +45,9 @@ WifiManager::begin(const AppConfig& cfg)
     WiFi.mode(WIFI_STA);
     WiFi.begin(cfg.wifiSsid.c_str(), cfg.wifiPass.c_str());
 
-    Logger::info(
-        "WiFi", "Connecting to SSID=%s (pass len=%d)", cfg.wifiSsid.c_str(), cfg.wifiPass.length()
+    LOG_I(
+        "WiFi", "Connecting to SSID=%s (pass len=%u)", cfg.wifiSsid.c_str(),
+        (unsigned)cfg.wifiPass.length()
     );
 }
 
@@ -64,7 +65,7 @@ WifiManager::loop()
     // Log khi status thay đổi
     if (status != lastStatus)
     {
-        Logger::info("WiFi", "Status changed: %s", wifiStatusToString(status));
+        LOG_I("WiFi", "Status changed: %s", wifiStatusToString(status));
         lastStatus = status;
     }
 
@@ -76,7 +77,7 @@ WifiManager::loop()
 
     lastAttempt = millis();
 
-    Logger::warn("WiFi", "Reconnecting... status=%s", wifiStatusToString(status));
+    LOG_W("WiFi", "Reconnecting... status=%s", wifiStatusToString(status));
     WiFi.reconnect();
 }
 
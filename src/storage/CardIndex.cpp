@@ -0,0 +1,144 @@
+#include "storage/CardIndex.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+int
+hexNibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+} // namespace
+
+bool
+CardUid::fromHex(const String& hex, CardUid& out)
+{
+    const size_t n = hex.length();
+    if (n == 0 || (n % 2) != 0 || n / 2 > MAX_BYTES)
+        return false;
+
+    CardUid tmp;
+    for (size_t i = 0; i < n / 2; ++i)
+    {
+        const int hi = hexNibble(hex[2 * i]);
+        const int lo = hexNibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+
+        tmp.bytes[i] = (uint8_t)((hi << 4) | lo);
+    }
+
+    tmp.len = (uint8_t)(n / 2);
+    out = tmp;
+    return true;
+}
+
+bool
+CardUid::fromBytes(const uint8_t* data, size_t size, CardUid& out)
+{
+    if (!data || size == 0 || size > MAX_BYTES)
+        return false;
+
+    out = CardUid();
+    memcpy(out.bytes, data, size);
+    out.len = (uint8_t)size;
+    return true;
+}
+
+int
+CardUid::compare(const CardUid& other) const
+{
+    if (len != other.len)
+        return (int)len - (int)other.len;
+
+    return memcmp(bytes, other.bytes, len);
+}
+
+void
+CardIndex::clear()
+{
+    entries_.clear();
+}
+
+void
+CardIndex::reserve(size_t n)
+{
+    entries_.reserve(n);
+}
+
+void
+CardIndex::append(const CardUid& uid, uint16_t pos)
+{
+    entries_.push_back(Entry{uid, pos});
+}
+
+void
+CardIndex::sort()
+{
+    // Stable so that duplicates found in old files resolve to the first card.
+    std::stable_sort(
+        entries_.begin(), entries_.end(),
+        [](const Entry& a, const Entry& b) { return a.uid.compare(b.uid) < 0; }
+    );
+}
+
+std::vector<CardIndex::Entry>::const_iterator
+CardIndex::lowerBound_(const CardUid& uid) const
+{
+    return std::lower_bound(
+        entries_.begin(), entries_.end(), uid,
+        [](const Entry& e, const CardUid& key) { return e.uid.compare(key) < 0; }
+    );
+}
+
+bool
+CardIndex::insert(const CardUid& uid, uint16_t pos)
+{
+    auto it = lowerBound_(uid);
+    if (it != entries_.end() && it->uid.compare(uid) == 0)
+        return false;
+
+    entries_.insert(entries_.begin() + (it - entries_.begin()), Entry{uid, pos});
+    return true;
+}
+
+int
+CardIndex::find(const CardUid& uid) const
+{
+    auto it = lowerBound_(uid);
+    if (it == entries_.end() || it->uid.compare(uid) != 0)
+        return -1;
+
+    return it->pos;
+}
+
+void
+CardIndex::eraseAndShift(uint16_t pos)
+{
+    auto out = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->pos == pos)
+            continue;
+
+        Entry e = *it;
+        if (e.pos > pos)
+            e.pos--;
+        *out++ = e;
+    }
+    entries_.erase(out, entries_.end());
+}
+
+size_t
+CardIndex::size() const
+{
+    return entries_.size();
+}
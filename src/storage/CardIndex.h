@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// MIFARE UIDs are 4, 7 or 10 bytes. They are kept as fixed-width binary
+// keys so a lookup is a memcmp instead of a hex String compare.
+struct CardUid
+{
+    static constexpr size_t MAX_BYTES = 10;
+
+    uint8_t len = 0;
+    uint8_t bytes[MAX_BYTES] = {};
+
+    static bool
+    fromHex(const String& hex, CardUid& out);
+
+    static bool
+    fromBytes(const uint8_t* data, size_t size, CardUid& out);
+
+    int
+    compare(const CardUid& other) const;
+};
+
+// Sorted, packed index from binary UID to position in CardRepository::cards_.
+class CardIndex
+{
+  public:
+    void
+    clear();
+
+    void
+    reserve(size_t n);
+
+    // Bulk path for load(): append unsorted, then call sort() once.
+    void
+    append(const CardUid& uid, uint16_t pos);
+
+    void
+    sort();
+
+    bool
+    insert(const CardUid& uid, uint16_t pos);
+
+    int
+    find(const CardUid& uid) const;
+
+    void
+    eraseAndShift(uint16_t pos);
+
+    size_t
+    size() const;
+
+  private:
+    struct Entry
+    {
+        CardUid uid;
+        uint16_t pos;
+    };
+
+    std::vector<Entry>::const_iterator
+    lowerBound_(const CardUid& uid) const;
+
+    std::vector<Entry> entries_;
+};
@@ -1,70 +1,207 @@
 #include "storage/CardRepository.h"
 
 #include "storage/FileSystem.h"
+#include "storage/RecordFile.h"
+#include "utils/HeapMonitor.h"
+#include "utils/HeapWatermark.h"
 #include "utils/JsonUtils.h"
+#include "utils/Logger.h"
 
 #include <ArduinoJson.h>
+
 namespace
 {
-constexpr size_t kMinCap = 1024;
-constexpr size_t kMaxCap = 32768;
+constexpr const char* TAG = "CARDS";
+
+constexpr size_t kMaxCards = 0xFFFF;
+
+// Record types in /iccards.bin
+constexpr uint8_t kRecMeta = 1; // ts(u64) [rev(u64)]
+constexpr uint8_t kRecCard = 2; // uid(str) name(str)
 
 bool
 isUidValid(const String& uid)
 {
-    return uid.length() > 0;
+    return uid.length() > 0 && uid.length() <= RecordFile::MAX_STRING;
 }
-} // namespace
 
-size_t
-CardRepository::calcDocCapacity(const String& json)
+// Longer names could not be saved; refused here rather than failing save().
+bool
+isNameValid(const String& name)
 {
-    const size_t len = static_cast<size_t>(json.length());
-    size_t cap = static_cast<size_t>(len * 13 / 10) + 1024;
-    if (cap < kMinCap)
-        cap = kMinCap;
-    if (cap > kMaxCap)
-        cap = kMaxCap;
-    return cap;
+    return name.length() <= RecordFile::MAX_STRING;
 }
+} // namespace
 
 bool
 CardRepository::load()
 {
+    HEAP_SCOPE(HeapTag::Cards);
+
     cards_.clear();
     ts_ = 0;
+    changes_.reset(0);
 
-    if (!FileSystem::exists(PATH))
-        return true;
+    bool ok = true;
+    if (FileSystem::exists(PATH))
+        ok = loadBinary_();
+    else if (FileSystem::exists(LEGACY_JSON_PATH))
+        ok = migrateFromJson_();
 
-    const String json = FileSystem::readFile(PATH);
-    DynamicJsonDocument doc(calcDocCapacity(json));
+    rebuildIndex_();
+    return ok;
+}
 
-    if (!JsonUtils::deserialize(json, doc))
-        return false;
+bool
+CardRepository::loadBinary_()
+{
+    HeapWatermark heap(TAG, "load");
 
-    if (doc.containsKey(AppJsonKeys::TS))
-        ts_ = doc[AppJsonKeys::TS] | 0;
+    return FileSystem::readFile(
+        PATH,
+        [&](Stream& in)
+        {
+            if (!RecordFile::readHeader(in, RecordFile::Kind::Cards))
+            {
+                LOG_E(TAG, "bad header in %s", PATH);
+                return false;
+            }
 
-    if (doc.containsKey(AppJsonKeys::CARDS) && doc[AppJsonKeys::CARDS].is<JsonArray>())
-    {
-        for (JsonVariant v : doc[AppJsonKeys::CARDS].as<JsonArray>())
+            RecordReader r(in);
+            while (r.next())
+            {
+                if (r.type() == kRecMeta)
+                {
+                    uint64_t ts = 0;
+                    if (r.getU64(ts))
+                        ts_ = ts;
+
+                    // Older files end the meta record before the revision.
+                    uint64_t rev = 0;
+                    if (r.getU64(rev))
+                        changes_.reset((uint32_t)rev);
+                    continue;
+                }
+
+                if (r.type() != kRecCard)
+                    continue;
+
+                CardItem item;
+                if (!r.getString(item.uid) || !r.getString(item.name))
+                    continue;
+
+                if (!isUidValid(item.uid) || cards_.size() >= kMaxCards)
+                    continue;
+
+                cards_.push_back(item);
+                heap.sample();
+            }
+
+            if (r.corrupt())
+                LOG_W(TAG, "corrupt record after %u cards", (unsigned)cards_.size());
+
+            return true;
+        }
+    );
+}
+
+bool
+CardRepository::migrateFromJson_()
+{
+    HeapWatermark heap(TAG, "json migration");
+
+    // Pass 1: top-level fields only; the items array is filtered out.
+    StaticJsonDocument<32> filter;
+    filter[AppJsonKeys::TS] = true;
+
+    const bool headOk = FileSystem::readFile(
+        LEGACY_JSON_PATH,
+        [&](Stream& in)
         {
-            if (!v.is<JsonObject>())
-                continue;
+            StaticJsonDocument<64> doc;
+            if (!JsonUtils::deserialize(in, doc, filter))
+                return false;
+
+            ts_ = doc[AppJsonKeys::TS] | 0;
+            return true;
+        }
+    );
+    if (!headOk)
+        return false;
 
-            CardItem item = CardItem::fromJson(v);
-            item.uid.trim();
-            if (!isUidValid(item.uid))
-                continue;
+    // Pass 2: one card at a time.
+    const bool itemsOk = FileSystem::readFile(
+        LEGACY_JSON_PATH,
+        [&](Stream& in)
+        {
+            StaticJsonDocument<256> itemDoc;
+            return JsonUtils::forEachArrayItem(
+                in, AppJsonKeys::CARDS, itemDoc,
+                [&](JsonObjectConst v)
+                {
+                    CardItem item = CardItem::fromJson(v);
+                    item.uid.trim();
+                    if (!isUidValid(item.uid) || cards_.size() >= kMaxCards)
+                        return;
 
-            cards_.push_back(item);
+                    cards_.push_back(item);
+                    heap.sample();
+                }
+            );
         }
+    );
+    if (!itemsOk)
+        return false;
+
+    if (!saveInternal())
+    {
+        LOG_E(TAG, "migration to %s failed, keeping %s", PATH, LEGACY_JSON_PATH);
+        return true;
     }
 
+    FileSystem::remove(LEGACY_JSON_PATH);
+    LOG_I(TAG, "migrated %u cards to %s", (unsigned)cards_.size(), PATH);
     return true;
 }
 
+void
+CardRepository::rebuildIndex_()
+{
+    index_.clear();
+    index_.reserve(cards_.size());
+    unindexed_ = 0;
+
+    for (size_t i = 0; i < cards_.size(); ++i)
+    {
+        CardUid key;
+        if (CardUid::fromHex(cards_[i].uid, key))
+            index_.append(key, (uint16_t)i);
+        else
+            unindexed_++;
+    }
+
+    index_.sort();
+}
+
+int
+CardRepository::findPos_(const String& uid) const
+{
+    CardUid key;
+    if (CardUid::fromHex(uid, key))
+    {
+        const int pos = index_.find(key);
+        if (pos >= 0 || unindexed_ == 0)
+            return pos;
+    }
+
+    for (size_t i = 0; i < cards_.size(); ++i)
+    {
+        if (cards_[i].uid == uid)
+            return (int)i;
+    }
+    return -1;
+}
+
 bool
 CardRepository::save()
 {
@@ -74,30 +211,42 @@ CardRepository::save()
 bool
 CardRepository::saveInternal()
 {
-    const size_t est = kMinCap + cards_.size() * 64;
-    DynamicJsonDocument doc(est > kMaxCap ? kMaxCap : est);
+    HEAP_SCOPE(HeapTag::Cards);
 
-    doc[AppJsonKeys::TS] = ts_;
-    JsonArray cardsArray = doc.createNestedArray(AppJsonKeys::CARDS);
+    return FileSystem::writeFileAtomic(
+        PATH,
+        [this](Print& out)
+        {
+            if (!RecordFile::writeHeader(out, RecordFile::Kind::Cards))
+                return false;
 
-    for (const auto& c : cards_)
-    {
-        JsonObject o = cardsArray.createNestedObject();
-        c.toJson(o);
-    }
+            if (!RecordWriter(kRecMeta).putU64(ts_).putU64(changes_.rev()).writeTo(out))
+                return false;
 
-    return FileSystem::writeFileAtomic(PATH, JsonUtils::serialize(doc));
+            for (const auto& c : cards_)
+            {
+                if (!RecordWriter(kRecCard).putString(c.uid).putString(c.name).writeTo(out))
+                    return false;
+            }
+            return true;
+        }
+    );
 }
 
 bool
 CardRepository::exists(const String& uid) const
 {
-    for (const auto& c : cards_)
-    {
-        if (c.uid == uid)
-            return true;
-    }
-    return false;
+    return findPos_(uid) >= 0;
+}
+
+bool
+CardRepository::exists(const uint8_t* uid, size_t len) const
+{
+    CardUid key;
+    if (!CardUid::fromBytes(uid, len, key))
+        return false;
+
+    return index_.find(key) >= 0;
 }
 
 bool
@@ -111,42 +260,58 @@ CardRepository::add(const String& uid, const String& name)
 {
     String clean = uid;
     clean.trim();
-    if (!isUidValid(clean))
+    if (!isUidValid(clean) || !isNameValid(name))
+        return false;
+
+    if (cards_.size() >= kMaxCards)
         return false;
 
     if (exists(clean))
         return false;
 
+    const uint16_t pos = (uint16_t)cards_.size();
     cards_.push_back(CardItem{clean, name});
+    changes_.record(ChangeOp::Add, cards_.back());
+
+    CardUid key;
+    if (CardUid::fromHex(clean, key))
+        index_.insert(key, pos);
+    else
+        unindexed_++;
+
     return saveInternal();
 }
 
 bool
 CardRepository::updateName(const String& uid, const String& name)
 {
-    for (auto& c : cards_)
-    {
-        if (c.uid == uid)
-        {
-            c.name = name;
-            return saveInternal();
-        }
-    }
-    return false;
+    if (!isNameValid(name))
+        return false;
+
+    const int pos = findPos_(uid);
+    if (pos < 0)
+        return false;
+
+    cards_[pos].name = name;
+    changes_.record(ChangeOp::Rename, cards_[pos]);
+    return saveInternal();
 }
 
 bool
 CardRepository::remove(const String& uid)
 {
-    for (auto it = cards_.begin(); it != cards_.end(); ++it)
-    {
-        if (it->uid == uid)
-        {
-            cards_.erase(it);
-            return saveInternal();
-        }
-    }
-    return false;
+    const int pos = findPos_(uid);
+    if (pos < 0)
+        return false;
+
+    CardUid key;
+    if (!CardUid::fromHex(cards_[pos].uid, key))
+        unindexed_--;
+
+    changes_.record(ChangeOp::Remove, cards_[pos]);
+    cards_.erase(cards_.begin() + pos);
+    index_.eraseAndShift((uint16_t)pos);
+    return saveInternal();
 }
 
 const std::vector<CardItem>&
@@ -154,6 +319,7 @@ CardRepository::list() const
 {
     return cards_;
 }
+
 bool
 CardRepository::isEmpty() const
 {
@@ -177,3 +343,15 @@ CardRepository::setTs(uint64_t ts)
 {
     ts_ = ts;
 }
+
+uint32_t
+CardRepository::rev() const
+{
+    return changes_.rev();
+}
+
+const CardRepository::Changes&
+CardRepository::changes() const
+{
+    return changes_;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "config/AppPaths.h"
+#include "storage/CardIndex.h"
+#include "storage/ChangeLog.h"
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
@@ -29,6 +31,9 @@ struct CardItem
 class CardRepository
 {
   public:
+    static constexpr size_t kChangeLogSize = 32;
+    using Changes = ChangeLog<CardItem, kChangeLogSize>;
+
     bool
     load();
 
@@ -38,6 +43,9 @@ class CardRepository
     bool
     exists(const String& uid) const;
 
+    bool
+    exists(const uint8_t* uid, size_t len) const;
+
     bool
     add(const String& uid);
 
@@ -65,15 +73,37 @@ class CardRepository
     void
     setTs(uint64_t ts);
 
+    // Revision of the list, bumped on every change and persisted with it.
+    uint32_t
+    rev() const;
+
+    const Changes&
+    changes() const;
+
   private:
     std::vector<CardItem> cards_;
     uint64_t ts_{0};
 
-    static constexpr const char* PATH = AppPaths::CARDS_JSON;
+    CardIndex index_;
+    size_t unindexed_{0}; // cards whose uid is not a hex MIFARE UID
+
+    Changes changes_;
 
-    static size_t
-    calcDocCapacity(const String& json);
+    static constexpr const char* PATH = AppPaths::CARDS_BIN;
+    static constexpr const char* LEGACY_JSON_PATH = AppPaths::CARDS_JSON;
 
     bool
     saveInternal();
+
+    bool
+    loadBinary_();
+
+    bool
+    migrateFromJson_();
+
+    int
+    findPos_(const String& uid) const;
+
+    void
+    rebuildIndex_();
 };
\ No newline at end of file
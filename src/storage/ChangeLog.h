@@ -0,0 +1,112 @@
+#pragma once
+#include <Arduino.h>
+
+enum class ChangeOp : uint8_t
+{
+    Add = 1,
+    Remove = 2,
+    Rename = 3,
+    Master = 4
+};
+
+inline const char*
+changeOpName(ChangeOp op)
+{
+    switch (op)
+    {
+    case ChangeOp::Add:
+        return "add";
+    case ChangeOp::Remove:
+        return "remove";
+    case ChangeOp::Rename:
+        return "rename";
+    case ChangeOp::Master:
+        return "master";
+    }
+    return "";
+}
+
+// Revision counter plus a RAM ring of the last N changes to a repository.
+// Every mutation bumps the revision; a client holding revision R can be
+// brought up to date with the entries after R as long as they are still in
+// the ring. History is not persisted, so after a reboot only clients already
+// at the current revision can be served incrementally.
+template <typename T, size_t N>
+class ChangeLog
+{
+  public:
+    struct Entry
+    {
+        uint32_t rev;
+        ChangeOp op;
+        T value;
+    };
+
+    uint32_t
+    rev() const
+    {
+        return rev_;
+    }
+
+    // Starts a new history at `rev`; earlier revisions become unservable.
+    void
+    reset(uint32_t rev)
+    {
+        rev_ = rev;
+        head_ = 0;
+        count_ = 0;
+    }
+
+    // Bumps the revision without a servable entry (bulk replace, journal replay).
+    void
+    bump()
+    {
+        reset(rev_ + 1);
+    }
+
+    uint32_t
+    record(ChangeOp op, const T& value)
+    {
+        rev_++;
+
+        Entry& e = ring_[head_];
+        e.rev = rev_;
+        e.op = op;
+        e.value = value;
+
+        head_ = (head_ + 1) % N;
+        if (count_ < N)
+            count_++;
+
+        return rev_;
+    }
+
+    // True when every change after `since` is still in the ring.
+    bool
+    covers(uint32_t since) const
+    {
+        return since <= rev_ && rev_ - since <= count_;
+    }
+
+    size_t
+    countSince(uint32_t since) const
+    {
+        return covers(since) ? rev_ - since : 0;
+    }
+
+    // Visits the entries after `since`, oldest first. Requires covers(since).
+    template <typename F>
+    void
+    forEachSince(uint32_t since, F fn) const
+    {
+        const size_t n = countSince(since);
+        for (size_t i = 0; i < n; ++i)
+            fn(ring_[(head_ + N - n + i) % N]);
+    }
+
+  private:
+    Entry ring_[N];
+    size_t head_{0};
+    size_t count_{0};
+    uint32_t rev_{0};
+};
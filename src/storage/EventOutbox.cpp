@@ -0,0 +1,357 @@
+#include "storage/EventOutbox.h"
+
+#include "storage/FileSystem.h"
+#include "storage/RecordFile.h"
+#include "utils/Logger.h"
+
+namespace
+{
+constexpr const char* TAG = "OUTBOX";
+
+// Record types in /outbox.bin
+constexpr uint8_t kRecEvent = 1; // kind(u8) ts(u64) a(str) b(str) c(str)
+
+// Dropped records at the head of the file are reclaimed past this size.
+constexpr size_t kCompactBytes = 4096;
+
+void
+putEvent(RecordWriter& w, const OutboxEvent& e)
+{
+    w.putU8((uint8_t)e.kind).putU64(e.ts).putString(e.a).putString(e.b).putString(e.c);
+}
+
+bool
+getEvent(RecordReader& r, OutboxEvent& e)
+{
+    uint8_t kind = 0;
+    if (r.type() != kRecEvent || !r.getU8(kind) || !r.getU64(e.ts) || !r.getString(e.a) ||
+        !r.getString(e.b) || !r.getString(e.c))
+        return false;
+
+    if (kind != (uint8_t)OutboxEvent::Kind::State && kind != (uint8_t)OutboxEvent::Kind::Log)
+        return false;
+
+    e.kind = (OutboxEvent::Kind)kind;
+    return true;
+}
+} // namespace
+
+void
+EventOutbox::begin()
+{
+    if (!FileSystem::exists(PATH))
+        return;
+
+    size_t count = 0;
+    const bool ok = FileSystem::readFile(
+        PATH,
+        [&](Stream& in)
+        {
+            if (!RecordFile::readHeader(in, RecordFile::Kind::Outbox))
+                return false;
+
+            RecordReader r(in);
+            while (r.next())
+                count++;
+            return true;
+        }
+    );
+
+    if (!ok || count == 0)
+    {
+        FileSystem::remove(PATH);
+        return;
+    }
+
+    flashCount_ = count;
+    flashOffset_ = RecordFile::HEADER_SIZE;
+    LOG_I(TAG, "%u events pending from before reboot", (unsigned)count);
+}
+
+void
+EventOutbox::configure(size_t maxEvents, DropPolicy policy)
+{
+    maxEvents_ = maxEvents < kRamEvents ? kRamEvents : maxEvents;
+    policy_ = policy;
+}
+
+bool
+EventOutbox::empty() const
+{
+    return depth() == 0;
+}
+
+size_t
+EventOutbox::depth() const
+{
+    return ramCount_ + flashCount_;
+}
+
+uint32_t
+EventOutbox::dropped() const
+{
+    return dropped_;
+}
+
+uint32_t
+EventOutbox::headIndex() const
+{
+    return headIndex_;
+}
+
+void
+EventOutbox::push(const OutboxEvent& e)
+{
+    // An event too big for a record could never be spilled, and would fail
+    // every later spill behind it; refuse it up front instead.
+    RecordWriter fits(kRecEvent);
+    putEvent(fits, e);
+    if (!fits.ok())
+    {
+        LOG_W(TAG, "event too large for a record, dropped");
+        dropped_++;
+        return;
+    }
+
+    if (depth() >= maxEvents_)
+    {
+        if (policy_ == DropPolicy::DropNewest)
+        {
+            dropped_++;
+            return;
+        }
+
+        if (flashCount_ > 0)
+        {
+            dropOldestFlash_();
+        }
+        else
+        {
+            ramHead_ = (ramHead_ + 1) % kRamEvents;
+            ramCount_--;
+            dropped_++;
+            headIndex_++;
+        }
+    }
+
+    if (ramCount_ == kRamEvents && !spill_())
+    {
+        // No flash to fall back on: lose the oldest event in RAM instead,
+        // which is only the front of the queue when the file is empty.
+        ramHead_ = (ramHead_ + 1) % kRamEvents;
+        ramCount_--;
+        dropped_++;
+        if (flashCount_ == 0)
+            headIndex_++;
+    }
+
+    ram_[(ramHead_ + ramCount_) % kRamEvents] = e;
+    ramCount_++;
+}
+
+size_t
+EventOutbox::peek(OutboxEvent* out, size_t max)
+{
+    if (flashCount_ > 0)
+    {
+        if (batchPos_ < batch_.size() || loadBatch_())
+        {
+            // Only from the loaded batch; the rest follows on the next call.
+            size_t n = 0;
+            for (; n < max && batchPos_ + n < batch_.size(); ++n)
+                out[n] = batch_[batchPos_ + n].event;
+            return n;
+        }
+
+        LOG_W(TAG, "unreadable outbox file, dropping %u events", (unsigned)flashCount_);
+        dropped_ += flashCount_;
+        headIndex_ += flashCount_;
+        clearFlash_();
+    }
+
+    size_t n = 0;
+    for (; n < max && n < ramCount_; ++n)
+        out[n] = ram_[(ramHead_ + n) % kRamEvents];
+    return n;
+}
+
+void
+EventOutbox::pop(size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        popOne_();
+}
+
+void
+EventOutbox::popOne_()
+{
+    if (flashCount_ > 0)
+    {
+        // The batch is gone if events were dropped or spilled since peek().
+        if (batchPos_ >= batch_.size() && !loadBatch_())
+            return;
+
+        flashOffset_ += batch_[batchPos_].bytes;
+        batchPos_++;
+        flashCount_--;
+        headIndex_++;
+
+        if (flashCount_ == 0)
+            clearFlash_();
+        return;
+    }
+
+    if (ramCount_ == 0)
+        return;
+
+    ram_[ramHead_] = OutboxEvent();
+    ramHead_ = (ramHead_ + 1) % kRamEvents;
+    ramCount_--;
+    headIndex_++;
+}
+
+bool
+EventOutbox::spill_()
+{
+    const bool fresh = !FileSystem::exists(PATH);
+
+    const bool ok = FileSystem::appendFile(
+        PATH,
+        [&](Print& out)
+        {
+            if (fresh && !RecordFile::writeHeader(out, RecordFile::Kind::Outbox))
+                return false;
+
+            for (size_t i = 0; i < ramCount_; ++i)
+            {
+                const OutboxEvent& e = ram_[(ramHead_ + i) % kRamEvents];
+
+                RecordWriter w(kRecEvent);
+                putEvent(w, e);
+                if (!w.writeTo(out))
+                    return false;
+            }
+            return true;
+        }
+    );
+
+    if (!ok)
+    {
+        // A partial append leaves a torn tail that loadBatch_ stops at.
+        LOG_W(TAG, "spill to %s failed", PATH);
+        return false;
+    }
+
+    if (fresh)
+        flashOffset_ = RecordFile::HEADER_SIZE;
+
+    flashCount_ += ramCount_;
+    for (size_t i = 0; i < kRamEvents; ++i)
+        ram_[i] = OutboxEvent();
+    ramHead_ = 0;
+    ramCount_ = 0;
+    return true;
+}
+
+bool
+EventOutbox::loadBatch_()
+{
+    batch_.clear();
+    batchPos_ = 0;
+
+    FileSystem::readFile(
+        PATH, flashOffset_,
+        [&](Stream& in)
+        {
+            RecordReader r(in);
+            size_t prev = 0;
+
+            while (batch_.size() < kFlashBatch && r.next())
+            {
+                Spilled s;
+                s.bytes = (uint16_t)(r.consumed() - prev);
+                prev = r.consumed();
+
+                if (!getEvent(r, s.event))
+                    break;
+
+                batch_.push_back(s);
+            }
+            return true;
+        }
+    );
+
+    return !batch_.empty();
+}
+
+void
+EventOutbox::dropOldestFlash_()
+{
+    // The loaded batch usually already knows where the oldest event ends.
+    if (batchPos_ >= batch_.size() && !loadBatch_())
+    {
+        // Nothing readable is left in the file to deliver.
+        dropped_ += flashCount_;
+        headIndex_ += flashCount_;
+        clearFlash_();
+        return;
+    }
+
+    flashOffset_ += batch_[batchPos_].bytes;
+    batchPos_++;
+    flashCount_--;
+    dropped_++;
+    headIndex_++;
+
+    if (flashCount_ == 0)
+        clearFlash_();
+    else if (flashOffset_ >= kCompactBytes)
+        compact_();
+}
+
+bool
+EventOutbox::compact_()
+{
+    const size_t from = flashOffset_;
+
+    const bool ok = FileSystem::writeFileAtomic(
+        PATH,
+        [&](Print& out)
+        {
+            if (!RecordFile::writeHeader(out, RecordFile::Kind::Outbox))
+                return false;
+
+            return FileSystem::readFile(
+                PATH, from,
+                [&](Stream& in)
+                {
+                    in.setTimeout(0);
+
+                    uint8_t buf[128];
+                    size_t n;
+                    while ((n = in.readBytes((char*)buf, sizeof(buf))) > 0)
+                    {
+                        if (out.write(buf, n) != n)
+                            return false;
+                    }
+                    return true;
+                }
+            );
+        }
+    );
+
+    if (ok)
+        flashOffset_ = RecordFile::HEADER_SIZE;
+
+    return ok;
+}
+
+void
+EventOutbox::clearFlash_()
+{
+    FileSystem::remove(PATH);
+    flashCount_ = 0;
+    flashOffset_ = 0;
+    batch_.clear();
+    batchPos_ = 0;
+}
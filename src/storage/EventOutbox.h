@@ -0,0 +1,120 @@
+#pragma once
+#include "config/AppPaths.h"
+
+#include <Arduino.h>
+#include <vector>
+
+struct OutboxEvent
+{
+    enum class Kind : uint8_t
+    {
+        State = 1,
+        Log = 2
+    };
+
+    Kind kind{Kind::Log};
+    uint64_t ts{0};
+    String a; // state | event
+    String b; // reason | method
+    String c; // (unused) | detail
+};
+
+// Events that could not be published while offline, oldest first.
+//
+// Every event may end up on flash and be resent after a reboot, so callers
+// must not put secrets (passcodes, keys) in any field.
+//
+// New events go to a small RAM ring. When it fills, the whole ring is
+// appended to /outbox.bin in one write. Draining reads the file back in
+// batches before the RAM ring, so order is preserved. Delivery is
+// at-least-once: events stay queued until the caller has confirmed them
+// with pop(), and after a reboot mid-drain the unsent tail of the file is
+// resent from the start of the file.
+class EventOutbox
+{
+  public:
+    enum class DropPolicy : uint8_t
+    {
+        DropOldest,
+        DropNewest
+    };
+
+    static constexpr size_t kRamEvents = 16;
+
+    // Picks up events spilled before a reboot.
+    void
+    begin();
+
+    // `maxEvents` bounds RAM plus flash.
+    void
+    configure(size_t maxEvents, DropPolicy policy);
+
+    bool
+    empty() const;
+
+    size_t
+    depth() const;
+
+    uint32_t
+    dropped() const;
+
+    // Counts every event ever removed from the front, popped or dropped. A
+    // caller holding a peeked batch across calls compares it to tell how
+    // much of that batch has been dropped from under it.
+    uint32_t
+    headIndex() const;
+
+    void
+    push(const OutboxEvent& e);
+
+    // Copies up to `max` of the oldest events without removing them; call
+    // pop() once they have been delivered.
+    size_t
+    peek(OutboxEvent* out, size_t max);
+
+    // Removes the `n` oldest events.
+    void
+    pop(size_t n = 1);
+
+  private:
+    static constexpr const char* PATH = AppPaths::OUTBOX_BIN;
+    static constexpr size_t kFlashBatch = 8;
+
+    struct Spilled
+    {
+        OutboxEvent event;
+        uint16_t bytes;
+    };
+
+    void
+    popOne_();
+
+    bool
+    spill_();
+
+    bool
+    loadBatch_();
+
+    void
+    dropOldestFlash_();
+
+    bool
+    compact_();
+
+    void
+    clearFlash_();
+
+    OutboxEvent ram_[kRamEvents];
+    size_t ramHead_{0};
+    size_t ramCount_{0};
+
+    size_t flashCount_{0};  // unsent events in the file
+    size_t flashOffset_{0}; // first unsent byte
+    std::vector<Spilled> batch_;
+    size_t batchPos_{0};
+
+    size_t maxEvents_{256};
+    DropPolicy policy_{DropPolicy::DropOldest};
+    uint32_t dropped_{0};
+    uint32_t headIndex_{0};
+};
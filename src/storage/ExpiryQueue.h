@@ -0,0 +1,69 @@
+#pragma once
+#include "models/HashedPasscode.h"
+
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+
+// Min-heap of passcode expiry times, earliest first. Removals are lazy: an
+// entry may outlive its passcode, so whoever pops it checks the repository
+// before acting on it.
+class ExpiryQueue
+{
+  public:
+    struct Entry
+    {
+        uint64_t expireAt;
+        PasscodeDigest digest;
+    };
+
+    void
+    clear()
+    {
+        heap_.clear();
+    }
+
+    // Codes without an expiry (expireAt == 0) are not queued.
+    void
+    push(uint64_t expireAt, const PasscodeDigest& digest)
+    {
+        if (expireAt == 0)
+            return;
+
+        heap_.push_back(Entry{expireAt, digest});
+        std::push_heap(heap_.begin(), heap_.end(), later_);
+    }
+
+    bool
+    due(uint64_t now) const
+    {
+        return !heap_.empty() && heap_.front().expireAt <= now;
+    }
+
+    bool
+    pop(Entry& out)
+    {
+        if (heap_.empty())
+            return false;
+
+        std::pop_heap(heap_.begin(), heap_.end(), later_);
+        out = heap_.back();
+        heap_.pop_back();
+        return true;
+    }
+
+    size_t
+    size() const
+    {
+        return heap_.size();
+    }
+
+  private:
+    static bool
+    later_(const Entry& a, const Entry& b)
+    {
+        return a.expireAt > b.expireAt;
+    }
+
+    std::vector<Entry> heap_;
+};
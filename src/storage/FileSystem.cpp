@@ -1,5 +1,7 @@
 #include "storage/FileSystem.h"
 
+#include "utils/Profiler.h"
+
 #include <SPIFFS.h>
 
 namespace
@@ -11,6 +13,8 @@ tmpPathFor(const char* path)
 }
 } // namespace
 
+uint32_t FileSystem::bytesWritten_ = 0;
+
 bool
 FileSystem::begin()
 {
@@ -33,28 +37,73 @@ FileSystem::readFile(const char* path)
     String content;
     content.reserve(static_cast<size_t>(f.size()));
 
-    while (f.available())
-        content += char(f.read());
+    char chunk[128];
+    size_t n;
+    while ((n = f.read(reinterpret_cast<uint8_t*>(chunk), sizeof(chunk))) > 0)
+        content.concat(chunk, n);
 
     f.close();
     return content;
 }
 
+bool
+FileSystem::readFile(const char* path, const Reader& reader)
+{
+    File f = SPIFFS.open(path, "r");
+    if (!f)
+        return false;
+
+    const bool ok = reader(f);
+    f.close();
+    return ok;
+}
+
+bool
+FileSystem::readFile(const char* path, size_t offset, const Reader& reader)
+{
+    File f = SPIFFS.open(path, "r");
+    if (!f)
+        return false;
+
+    if (!f.seek(offset))
+    {
+        f.close();
+        return false;
+    }
+
+    const bool ok = reader(f);
+    f.close();
+    return ok;
+}
+
 bool
 FileSystem::writeFile(const char* path, const String& content)
 {
+    PROFILE_SCOPE(ProfileSection::FlashWrite);
+
     File f = SPIFFS.open(path, "w");
     if (!f)
         return false;
 
     const size_t written = f.print(content);
     f.close();
+    bytesWritten_ += written;
     return written == content.length();
 }
 
 bool
 FileSystem::writeFileAtomic(const char* path, const String& content)
 {
+    return writeFileAtomic(
+        path, [&](Print& out) { return out.print(content) == content.length(); }
+    );
+}
+
+bool
+FileSystem::writeFileAtomic(const char* path, const Writer& writer)
+{
+    PROFILE_SCOPE(ProfileSection::FlashWrite);
+
     const String tmp = tmpPathFor(path);
 
     {
@@ -62,10 +111,11 @@ FileSystem::writeFileAtomic(const char* path, const String& content)
         if (!f)
             return false;
 
-        const size_t written = f.print(content);
+        const bool ok = writer(f);
+        bytesWritten_ += f.size();
         f.close();
 
-        if (written != content.length())
+        if (!ok)
         {
             SPIFFS.remove(tmp.c_str());
             return false;
@@ -90,8 +140,36 @@ FileSystem::writeFileAtomic(const char* path, const String& content)
     return true;
 }
 
+bool
+FileSystem::appendFile(const char* path, const String& content)
+{
+    return appendFile(path, [&](Print& out) { return out.print(content) == content.length(); });
+}
+
+bool
+FileSystem::appendFile(const char* path, const Writer& writer)
+{
+    PROFILE_SCOPE(ProfileSection::FlashWrite);
+
+    File f = SPIFFS.open(path, "a");
+    if (!f)
+        return false;
+
+    const size_t before = f.size();
+    const bool ok = writer(f);
+    bytesWritten_ += f.size() - before;
+    f.close();
+    return ok;
+}
+
 bool
 FileSystem::remove(const char* path)
 {
     return SPIFFS.remove(path);
+}
+
+uint32_t
+FileSystem::bytesWritten()
+{
+    return bytesWritten_;
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 #include <Arduino.h>
+#include <functional>
 
 class FileSystem
 {
   public:
+    using Writer = std::function<bool(Print& out)>;
+    using Reader = std::function<bool(Stream& in)>;
+
     static bool
     begin();
 
@@ -13,12 +17,36 @@ class FileSystem
     static String
     readFile(const char* path);
 
+    // Hands the open file to `reader`; no intermediate buffer.
+    static bool
+    readFile(const char* path, const Reader& reader);
+
+    // Same, with the file positioned at `offset`.
+    static bool
+    readFile(const char* path, size_t offset, const Reader& reader);
+
     static bool
     writeFile(const char* path, const String& content);
 
     static bool
     writeFileAtomic(const char* path, const String& content);
 
+    static bool
+    writeFileAtomic(const char* path, const Writer& writer);
+
+    static bool
+    appendFile(const char* path, const String& content);
+
+    static bool
+    appendFile(const char* path, const Writer& writer);
+
     static bool
     remove(const char* path);
+
+    // Total bytes handed to SPIFFS since boot, for flash wear accounting.
+    static uint32_t
+    bytesWritten();
+
+  private:
+    static uint32_t bytesWritten_;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "storage/PasscodeIndex.h"
+
+namespace
+{
+// Grow once the table is more than half full; probes stay short.
+bool
+overloaded(size_t count, size_t capacity)
+{
+    return count * 2 > capacity;
+}
+} // namespace
+
+void
+PasscodeIndex::clear()
+{
+    tags_.assign(kMinCapacity, 0);
+    pos_.assign(kMinCapacity, (uint16_t)kEmpty);
+    count_ = 0;
+}
+
+void
+PasscodeIndex::reserve(size_t n)
+{
+    size_t capacity = tags_.empty() ? kMinCapacity : tags_.size();
+    while (overloaded(n, capacity))
+        capacity *= 2;
+
+    if (capacity != tags_.size())
+        rehash_(capacity);
+}
+
+bool
+PasscodeIndex::insert(uint32_t tag, uint16_t pos)
+{
+    if (pos > kMaxItems)
+        return false;
+
+    if (tags_.empty())
+        clear();
+
+    if (overloaded(count_ + 1, tags_.size()))
+        rehash_(tags_.size() * 2);
+
+    place_(tag, pos);
+    count_++;
+    return true;
+}
+
+void
+PasscodeIndex::eraseAndShift(uint32_t tag, uint16_t pos)
+{
+    if (count_ == 0)
+        return;
+
+    const size_t mask = tags_.size() - 1;
+
+    size_t hole = tag & mask;
+    while (pos_[hole] != kEmpty && (tags_[hole] != tag || pos_[hole] != pos))
+        hole = (hole + 1) & mask;
+
+    if (pos_[hole] == kEmpty)
+        return;
+
+    // Backward-shift deletion: pull later members of the cluster into the
+    // hole unless that would move them before their home slot.
+    for (size_t j = (hole + 1) & mask; pos_[j] != kEmpty; j = (j + 1) & mask)
+    {
+        const size_t home = tags_[j] & mask;
+        const bool stays = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (stays)
+            continue;
+
+        tags_[hole] = tags_[j];
+        pos_[hole] = pos_[j];
+        hole = j;
+    }
+
+    pos_[hole] = kEmpty;
+    count_--;
+
+    for (size_t i = 0; i < pos_.size(); ++i)
+    {
+        if (pos_[i] != kEmpty && pos_[i] > pos)
+            pos_[i]--;
+    }
+}
+
+size_t
+PasscodeIndex::size() const
+{
+    return count_;
+}
+
+void
+PasscodeIndex::rehash_(size_t capacity)
+{
+    std::vector<uint32_t> tags;
+    std::vector<uint16_t> pos;
+    tags.swap(tags_);
+    pos.swap(pos_);
+
+    tags_.assign(capacity, 0);
+    pos_.assign(capacity, (uint16_t)kEmpty);
+
+    // Tags are kept whole, so growing needs no rehashing of the codes.
+    for (size_t i = 0; i < pos.size(); ++i)
+    {
+        if (pos[i] != kEmpty)
+            place_(tags[i], pos[i]);
+    }
+}
+
+void
+PasscodeIndex::place_(uint32_t tag, uint16_t pos)
+{
+    const size_t mask = tags_.size() - 1;
+
+    size_t i = tag & mask;
+    while (pos_[i] != kEmpty)
+        i = (i + 1) & mask;
+
+    tags_[i] = tag;
+    pos_[i] = pos;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// Open-addressing table from the tag of a passcode digest (its leading 32
+// bits, see PasscodeDigest) to the item's position in
+// PasscodeRepository::items_. Digests are keyed with the device's secret
+// passcode key, so probe lengths say nothing about which codes exist; a
+// lookup costs the one HMAC that produced the digest plus a short probe.
+//
+// A tag hit is only a candidate, which the caller confirms against the full
+// stored digest.
+class PasscodeIndex
+{
+  public:
+    static constexpr uint16_t kMaxItems = 0xFFFE;
+
+    void
+    clear();
+
+    void
+    reserve(size_t n);
+
+    bool
+    insert(uint32_t tag, uint16_t pos);
+
+    // Removes the entry for items_[pos] and shifts later positions down by one,
+    // mirroring vector::erase.
+    void
+    eraseAndShift(uint32_t tag, uint16_t pos);
+
+    // Lowest position with this tag for which confirm(pos) holds, or -1.
+    template <typename F>
+    int
+    find(uint32_t tag, F confirm) const
+    {
+        if (count_ == 0)
+            return -1;
+
+        const size_t mask = tags_.size() - 1;
+
+        int best = -1;
+        for (size_t i = tag & mask; pos_[i] != kEmpty; i = (i + 1) & mask)
+        {
+            if (tags_[i] != tag || (best >= 0 && pos_[i] > best))
+                continue;
+
+            if (confirm(pos_[i]))
+                best = pos_[i];
+        }
+        return best;
+    }
+
+    size_t
+    size() const;
+
+  private:
+    static constexpr uint16_t kEmpty = 0xFFFF;
+    static constexpr size_t kMinCapacity = 16;
+
+    void
+    rehash_(size_t capacity);
+
+    void
+    place_(uint32_t tag, uint16_t pos);
+
+    // Parallel arrays: 6 bytes per slot, capacity kept a power of two.
+    std::vector<uint32_t> tags_;
+    std::vector<uint16_t> pos_;
+    size_t count_{0};
+};
@@ -1,119 +1,602 @@
 #include "storage/PasscodeRepository.h"
 
 #include "storage/FileSystem.h"
+#include "storage/RecordFile.h"
+#include "utils/HeapMonitor.h"
+#include "utils/HeapWatermark.h"
 #include "utils/JsonUtils.h"
 #include "utils/TimeUtils.h"
 #include "utils/Logger.h"
 
 #include <ArduinoJson.h>
+#include <mbedtls/md.h>
+#include <string.h>
 
 namespace
 {
-constexpr size_t kMinCap = 1024;
-constexpr size_t kMaxCap = 32768;
+constexpr const char* TAG_REPO = "PASSCODE";
+
+// Journal is folded into the snapshot once it holds this many records.
+constexpr uint16_t kCompactRecords = 64;
+
+// Record types. Snapshot (/passcodes.bin):
+constexpr uint8_t kRecMeta = 1;       // ts(u64) master(str, always "") [rev(u64)]
+constexpr uint8_t kRecMaster = 6;     // digest(32)
+constexpr uint8_t kRecHashedItem = 7; // digest(32) type(u8) effectiveAt(u64) expireAt(u64)
+// Journal (/passcodes.log):
+constexpr uint8_t kRecHashedAdd = 8;     // same fields as kRecHashedItem
+constexpr uint8_t kRecHashedRemove = 9;  // digest(32)
+constexpr uint8_t kRecHashedConsume = 10; // digest(32)
+
+// Plaintext records from older firmware; read once and saved as digests.
+constexpr uint8_t kRecItem = 2;    // code(str) type(u8) effectiveAt(u64) expireAt(u64)
+constexpr uint8_t kRecAdd = 3;     // same fields as kRecItem
+constexpr uint8_t kRecRemove = 4;  // code(str)
+constexpr uint8_t kRecConsume = 5; // code(str)
+
+// Key file (/passcodes.key):
+constexpr uint8_t kRecKey = 1; // key(32)
+
+// Legacy JSON journal ops
+constexpr const char* kOpAdd = "add";
+constexpr const char* kOpRemove = "rm";
+constexpr const char* kOpConsume = "use";
+
+// Stale expiry entries (left by removals) tolerated before a rebuild.
+constexpr size_t kExpirySlack = 16;
 
 bool
 isCodeValid(const String& code)
 {
-    return !code.isEmpty();
+    return !code.isEmpty() && code.length() <= RecordFile::MAX_STRING;
 }
 
 bool
 isTypeValid(const String& type)
 {
-    return type == "one_time" || type == "timed";
+    HashedPasscode::Type t;
+    return HashedPasscode::parseType(type, t);
 }
-} // namespace
 
-size_t
-PasscodeRepository::calcDocCapacity(const String& json)
+void
+putItem(RecordWriter& w, const HashedPasscode& p)
+{
+    w.putBytes(p.digest.bytes, PasscodeDigest::kBytes)
+        .putU8((uint8_t)p.type)
+        .putU64(p.effectiveAt)
+        .putU64(p.expireAt);
+}
+
+bool
+getItem(RecordReader& r, HashedPasscode& p)
+{
+    uint8_t type = 0;
+    if (!r.getBytes(p.digest.bytes, PasscodeDigest::kBytes) || !r.getU8(type) ||
+        !r.getU64(p.effectiveAt) || !r.getU64(p.expireAt))
+        return false;
+
+    p.type = (HashedPasscode::Type)type;
+    return p.type == HashedPasscode::Type::OneTime || p.type == HashedPasscode::Type::Timed;
+}
+
+bool
+getLegacyItem(RecordReader& r, Passcode& p)
 {
-    const size_t len = static_cast<size_t>(json.length());
-    size_t cap = static_cast<size_t>(len * 13 / 10) + 1024;
+    uint8_t type = 0;
+    if (!r.getString(p.code) || !r.getU8(type) || !r.getU64(p.effectiveAt) ||
+        !r.getU64(p.expireAt))
+        return false;
 
-    if (cap < kMinCap)
-        cap = kMinCap;
-    if (cap > kMaxCap)
-        cap = kMaxCap;
+    if (type == (uint8_t)HashedPasscode::Type::OneTime)
+        p.type = "one_time";
+    else if (type == (uint8_t)HashedPasscode::Type::Timed)
+        p.type = "timed";
+    else
+        return false;
 
-    return cap;
+    return isCodeValid(p.code);
 }
+} // namespace
 
 bool
 PasscodeRepository::load()
 {
-    master_.clear();
+    HEAP_SCOPE(HeapTag::Passcodes);
+
+    master_ = HashedPasscode();
+    hasMaster_ = false;
     hasTemp_ = false;
     items_.clear();
+    index_.clear();
+    expiry_.clear();
     ts_ = 0;
+    journalRecords_ = 0;
+    sawPlaintext_ = false;
+    changes_.reset(0);
 
-    if (!FileSystem::exists(PATH))
-        return true;
-
-    const String json = FileSystem::readFile(PATH);
-    DynamicJsonDocument doc(calcDocCapacity(json));
-    if (!JsonUtils::deserialize(json, doc))
-        return false;
+    loadKey_();
 
-    if (doc.containsKey(AppJsonKeys::TS))
-        ts_ = doc[AppJsonKeys::TS] | 0;
+    bool ok = true;
+    if (FileSystem::exists(PATH))
+    {
+        ok = loadBinary_();
+        replayJournal_();
+    }
+    else if (FileSystem::exists(LEGACY_JSON_PATH) || FileSystem::exists(LEGACY_JOURNAL_PATH))
+    {
+        ok = migrateFromJson_();
+    }
+    else
+    {
+        replayJournal_();
+    }
 
-    if (doc.containsKey(AppJsonKeys::PASSCODES_MASTER))
+    // Codes from older firmware must not stay on flash in the clear.
+    if (sawPlaintext_)
     {
-        master_ = doc[AppJsonKeys::PASSCODES_MASTER] | "";
-        master_.trim();
+        LOG_I(TAG_REPO, "hashing plaintext passcodes in %s", PATH);
+        saveAll();
     }
 
-    if (doc.containsKey(AppJsonKeys::PASSCODES_TEMP) &&
-        doc[AppJsonKeys::PASSCODES_TEMP].is<JsonObject>())
+    tsMillisAtLoad_ = millis();
+    return ok;
+}
+
+void
+PasscodeRepository::loadKey_()
+{
+    bool loaded = false;
+    if (FileSystem::exists(KEY_PATH))
     {
-        temp_ = Passcode::fromJson(
-            doc[AppJsonKeys::PASSCODES_TEMP].as<JsonObjectConst>()
+        loaded = FileSystem::readFile(
+            KEY_PATH,
+            [this](Stream& in)
+            {
+                if (!RecordFile::readHeader(in, RecordFile::Kind::PasscodeKey))
+                    return false;
+
+                RecordReader r(in);
+                return r.next() && r.type() == kRecKey &&
+                       r.getBytes(key_, PasscodeDigest::kBytes);
+            }
         );
-        hasTemp_ = isCodeValid(temp_.code);
     }
+    if (loaded)
+        return;
 
-    if (doc.containsKey("items") &&
-        doc["items"].is<JsonArray>())
+    // Digests stored under a lost key can never match again; plaintext from
+    // older firmware is hashed under the new one.
+    if (FileSystem::exists(PATH) || FileSystem::exists(JOURNAL_PATH))
+        LOG_W(TAG_REPO, "new passcode key, digests saved under an older key will not match");
+
+    for (size_t i = 0; i < PasscodeDigest::kBytes; i += 4)
     {
-        JsonArray arr = doc["items"].as<JsonArray>();
-        items_.reserve(arr.size());
+        const uint32_t r = esp_random();
+        memcpy(key_ + i, &r, 4);
+    }
+
+    const bool saved = FileSystem::writeFileAtomic(
+        KEY_PATH,
+        [this](Print& out)
+        {
+            if (!RecordFile::writeHeader(out, RecordFile::Kind::PasscodeKey))
+                return false;
+
+            RecordWriter w(kRecKey);
+            w.putBytes(key_, PasscodeDigest::kBytes);
+            return w.writeTo(out);
+        }
+    );
+    if (!saved)
+        LOG_E(TAG_REPO, "cannot write %s", KEY_PATH);
+}
+
+PasscodeDigest
+PasscodeRepository::digestOf_(const char* code, size_t len) const
+{
+    PasscodeDigest d;
+    mbedtls_md_hmac(
+        mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key_, PasscodeDigest::kBytes,
+        (const unsigned char*)code, len, d.bytes
+    );
+    return d;
+}
+
+HashedPasscode
+PasscodeRepository::hash_(const Passcode& p) const
+{
+    HashedPasscode h;
+    h.digest = digestOf_(p.code.c_str(), p.code.length());
+    HashedPasscode::parseType(p.type, h.type);
+    h.effectiveAt = p.effectiveAt;
+    h.expireAt = p.expireAt;
+    return h;
+}
+
+bool
+PasscodeRepository::loadBinary_()
+{
+    HeapWatermark heap(TAG_REPO, "load");
+
+    return FileSystem::readFile(
+        PATH,
+        [&](Stream& in)
+        {
+            if (!RecordFile::readHeader(in, RecordFile::Kind::Passcodes))
+            {
+                LOG_E(TAG_REPO, "bad header in %s", PATH);
+                return false;
+            }
+
+            RecordReader r(in);
+            while (r.next())
+            {
+                if (r.type() == kRecMeta)
+                {
+                    uint64_t ts = 0;
+                    String legacyMaster;
+                    if (r.getU64(ts) && r.getString(legacyMaster))
+                        ts_ = ts;
+
+                    if (!legacyMaster.isEmpty())
+                    {
+                        master_.digest = digestOf_(legacyMaster.c_str(), legacyMaster.length());
+                        master_.type = HashedPasscode::Type::Master;
+                        hasMaster_ = true;
+                        sawPlaintext_ = true;
+                    }
+
+                    // Older files end the meta record before the revision.
+                    uint64_t rev = 0;
+                    if (r.getU64(rev))
+                        changes_.reset((uint32_t)rev);
+                    continue;
+                }
+
+                if (r.type() == kRecMaster)
+                {
+                    if (r.getBytes(master_.digest.bytes, PasscodeDigest::kBytes))
+                    {
+                        master_.type = HashedPasscode::Type::Master;
+                        hasMaster_ = true;
+                    }
+                    continue;
+                }
+
+                HashedPasscode h;
+                if (r.type() == kRecHashedItem && getItem(r, h))
+                {
+                    pushItem_(h);
+                    heap.sample();
+                    continue;
+                }
+
+                Passcode p;
+                if (r.type() == kRecItem && getLegacyItem(r, p))
+                {
+                    pushItem_(hash_(p));
+                    sawPlaintext_ = true;
+                    heap.sample();
+                }
+            }
 
-        for (JsonVariantConst v : arr)
+            if (r.corrupt())
+                LOG_W(TAG_REPO, "corrupt record after %u items", (unsigned)items_.size());
+
+            return true;
+        }
+    );
+}
+
+void
+PasscodeRepository::replayJournal_()
+{
+    journalRecords_ = 0;
+
+    if (!FileSystem::exists(JOURNAL_PATH))
+        return;
+
+    bool corrupt = false;
+    FileSystem::readFile(
+        JOURNAL_PATH,
+        [&](Stream& in)
         {
-            if (!v.is<JsonObject>())
-                continue;
+            if (!RecordFile::readHeader(in, RecordFile::Kind::PasscodeJournal))
+            {
+                corrupt = true;
+                return false;
+            }
+
+            RecordReader r(in);
+            while (r.next())
+            {
+                journalRecords_++;
+
+                HashedPasscode h;
+                bool add = false;
+                bool erase = false;
+                if (r.type() == kRecHashedAdd)
+                {
+                    add = getItem(r, h);
+                }
+                else if (r.type() == kRecHashedRemove || r.type() == kRecHashedConsume)
+                {
+                    erase = r.getBytes(h.digest.bytes, PasscodeDigest::kBytes);
+                }
+                else if (r.type() == kRecAdd)
+                {
+                    Passcode p;
+                    add = getLegacyItem(r, p);
+                    if (add)
+                        h = hash_(p);
+                    sawPlaintext_ = true;
+                }
+                else if (r.type() == kRecRemove || r.type() == kRecConsume)
+                {
+                    String code;
+                    erase = r.getString(code);
+                    if (erase)
+                        h.digest = digestOf_(code.c_str(), code.length());
+                    sawPlaintext_ = true;
+                }
+
+                // Replay must be idempotent: the snapshot may already hold it.
+                if (add && findPos_(h.digest) < 0)
+                {
+                    pushItem_(h);
+                    changes_.bump();
+                }
+                else if (erase && eraseDigest_(h.digest))
+                {
+                    changes_.bump();
+                }
+            }
+
+            corrupt = r.corrupt();
+            return true;
+        }
+    );
+
+    LOG_I(
+        TAG_REPO, "journal replayed: records=%u corrupt=%d", (unsigned)journalRecords_,
+        (int)corrupt
+    );
+
+    // Anything appended after a torn record would be unreachable; fold now.
+    if (corrupt)
+        saveAll();
+}
 
-            Passcode p = Passcode::fromJson(v.as<JsonObjectConst>());
-            p.code.trim();
-            p.type.trim();
+bool
+PasscodeRepository::appendJournal_(uint8_t recType, const HashedPasscode& p)
+{
+    if (journalRecords_ >= kCompactRecords)
+        return saveAll();
 
-            if (!isCodeValid(p.code))
-                continue;
+    const bool fresh = !FileSystem::exists(JOURNAL_PATH);
 
-            if (!isTypeValid(p.type))
-                continue;
+    const bool ok = FileSystem::appendFile(
+        JOURNAL_PATH,
+        [&](Print& out)
+        {
+            if (fresh && !RecordFile::writeHeader(out, RecordFile::Kind::PasscodeJournal))
+                return false;
 
-            items_.push_back(p);
+            RecordWriter w(recType);
+            if (recType == kRecHashedAdd)
+                putItem(w, p);
+            else
+                w.putBytes(p.digest.bytes, PasscodeDigest::kBytes);
+
+            return w.writeTo(out);
         }
+    );
+
+    if (!ok)
+    {
+        LOG_W(TAG_REPO, "journal append failed, compacting");
+        return saveAll();
     }
 
-    tsMillisAtLoad_ = millis();
+    journalRecords_++;
+    return true;
+}
+
+bool
+PasscodeRepository::migrateFromJson_()
+{
+    HeapWatermark heap(TAG_REPO, "json migration");
+
+    if (FileSystem::exists(LEGACY_JSON_PATH))
+    {
+        // Pass 1: top-level fields only; the items array is filtered out.
+        StaticJsonDocument<64> filter;
+        filter[AppJsonKeys::TS] = true;
+        filter[AppJsonKeys::PASSCODES_MASTER] = true;
+
+        const bool headOk = FileSystem::readFile(
+            LEGACY_JSON_PATH,
+            [&](Stream& in)
+            {
+                StaticJsonDocument<128> doc;
+                if (!JsonUtils::deserialize(in, doc, filter))
+                    return false;
+
+                ts_ = doc[AppJsonKeys::TS] | 0;
+                String master = doc[AppJsonKeys::PASSCODES_MASTER] | "";
+                master.trim();
+                if (!master.isEmpty())
+                {
+                    master_.digest = digestOf_(master.c_str(), master.length());
+                    master_.type = HashedPasscode::Type::Master;
+                    hasMaster_ = true;
+                }
+                return true;
+            }
+        );
+        if (!headOk)
+            return false;
+
+        // Pass 2: one passcode at a time.
+        const bool itemsOk = FileSystem::readFile(
+            LEGACY_JSON_PATH,
+            [&](Stream& in)
+            {
+                StaticJsonDocument<256> itemDoc;
+                return JsonUtils::forEachArrayItem(
+                    in, AppJsonKeys::PASSCODES, itemDoc,
+                    [&](JsonObjectConst v)
+                    {
+                        Passcode p = Passcode::fromJson(v);
+                        p.code.trim();
+                        p.type.trim();
+
+                        if (!isCodeValid(p.code) || !isTypeValid(p.type))
+                            return;
+
+                        pushItem_(hash_(p));
+                        heap.sample();
+                    }
+                );
+            }
+        );
+        if (!itemsOk)
+            return false;
+    }
+
+    replayLegacyJournal_();
+
+    if (!saveAll())
+    {
+        LOG_E(TAG_REPO, "migration to %s failed, keeping JSON files", PATH);
+        return true;
+    }
+
+    FileSystem::remove(LEGACY_JSON_PATH);
+    FileSystem::remove(LEGACY_JOURNAL_PATH);
+    LOG_I(TAG_REPO, "migrated %u passcodes to %s", (unsigned)items_.size(), PATH);
+    return true;
+}
+
+void
+PasscodeRepository::replayLegacyJournal_()
+{
+    if (!FileSystem::exists(LEGACY_JOURNAL_PATH))
+        return;
+
+    FileSystem::readFile(
+        LEGACY_JOURNAL_PATH,
+        [this](Stream& in)
+        {
+            // One JSON object per line; a torn tail record simply ends replay.
+            StaticJsonDocument<256> rec;
+            while (JsonUtils::deserialize(in, rec))
+            {
+                const String op = rec["op"] | "";
+                Passcode p = Passcode::fromJson(rec.as<JsonObjectConst>());
+
+                if (op == kOpAdd)
+                {
+                    if (isCodeValid(p.code) && isTypeValid(p.type) && !containsCode(p.code))
+                        pushItem_(hash_(p));
+                }
+                else if (op == kOpRemove || op == kOpConsume)
+                {
+                    eraseDigest_(digestOf_(p.code.c_str(), p.code.length()));
+                }
+            }
+            return true;
+        }
+    );
+}
+
+int
+PasscodeRepository::findPos_(const PasscodeDigest& digest) const
+{
+    return index_.find(
+        digest.tag(), [&](uint16_t pos) { return items_[pos].digest.matches(digest); }
+    );
+}
+
+bool
+PasscodeRepository::pushItem_(const HashedPasscode& p)
+{
+    if (items_.size() >= PasscodeIndex::kMaxItems)
+        return false;
+
+    index_.insert(p.digest.tag(), (uint16_t)items_.size());
+    items_.push_back(p);
+
+    if (expiry_.size() > 2 * items_.size() + kExpirySlack)
+        rebuildExpiry_();
+    else
+        expiry_.push(p.expireAt, p.digest);
     return true;
 }
 
+void
+PasscodeRepository::rebuildExpiry_()
+{
+    expiry_.clear();
+    for (const auto& p : items_)
+        expiry_.push(p.expireAt, p.digest);
+}
+
+void
+PasscodeRepository::eraseAt_(size_t pos)
+{
+    index_.eraseAndShift(items_[pos].digest.tag(), (uint16_t)pos);
+    items_.erase(items_.begin() + pos);
+}
+
+bool
+PasscodeRepository::eraseDigest_(const PasscodeDigest& digest)
+{
+    bool erased = false;
 
+    int pos;
+    while ((pos = findPos_(digest)) >= 0)
+    {
+        eraseAt_((size_t)pos);
+        erased = true;
+    }
+    return erased;
+}
 
-String
+bool
+PasscodeRepository::hasMaster() const
+{
+    return hasMaster_;
+}
+
+const HashedPasscode&
 PasscodeRepository::getMaster() const
 {
     return master_;
 }
 
+bool
+PasscodeRepository::matchesMaster(const char* code, size_t len) const
+{
+    // Hashed either way, so a missing master takes as long as a wrong code.
+    const PasscodeDigest d = digestOf_(code, len);
+    return d.matches(master_.digest) && hasMaster_ && len > 0;
+}
+
 bool
 PasscodeRepository::setMaster(const String& pass)
 {
-    master_ = pass;
+    if (pass.length() > RecordFile::MAX_STRING)
+        return false;
+
+    master_ = HashedPasscode();
+    master_.type = HashedPasscode::Type::Master;
+    hasMaster_ = !pass.isEmpty();
+    if (hasMaster_)
+        master_.digest = digestOf_(pass.c_str(), pass.length());
+
+    changes_.record(ChangeOp::Master, master_);
+
     return saveAll();
 }
 
@@ -123,28 +606,31 @@ PasscodeRepository::hasTemp() const
     return hasTemp_;
 }
 
-const Passcode&
+const HashedPasscode&
 PasscodeRepository::getTemp() const
 {
     return temp_;
 }
 
+// The temp passcode lives in RAM only (the snapshot never carried it), so
+// setting or clearing it does not touch flash.
 bool
 PasscodeRepository::setTemp(const Passcode& temp)
 {
-    temp_ = temp;
     hasTemp_ = isCodeValid(temp.code);
-    return saveAll();
+    if (hasTemp_)
+        temp_ = hash_(temp);
+    return true;
 }
 
 bool
 PasscodeRepository::clearTemp()
 {
     hasTemp_ = false;
-    return saveAll();
+    return true;
 }
 
-const std::vector<Passcode>&
+const std::vector<HashedPasscode>&
 PasscodeRepository::listItems() const
 {
     return items_;
@@ -155,6 +641,9 @@ PasscodeRepository::setItems(const std::vector<Passcode>& items, long ts)
 {
     items_.clear();
     items_.reserve(items.size());
+    index_.clear();
+    expiry_.clear();
+    index_.reserve(items.size());
 
     for (auto p : items)
     {
@@ -167,10 +656,11 @@ PasscodeRepository::setItems(const std::vector<Passcode>& items, long ts)
         if (!isTypeValid(p.type))
             continue;
 
-        items_.push_back(p);
+        pushItem_(hash_(p));
     }
 
     ts_ = ts;
+    changes_.bump();
     return saveAll();
 }
 
@@ -187,90 +677,123 @@ PasscodeRepository::addItem(const Passcode& p)
     if (!isTypeValid(c.type))
         return false;
 
-    items_.push_back(c);
-    return saveAll();
+    const HashedPasscode h = hash_(c);
+    if (!pushItem_(h))
+        return false;
+
+    changes_.record(ChangeOp::Add, h);
+    return appendJournal_(kRecHashedAdd, h);
 }
 
 bool
 PasscodeRepository::removeItemByCode(const String& code)
 {
-    bool removed = false;
+    HashedPasscode h;
+    h.digest = digestOf_(code.c_str(), code.length());
 
-    items_.erase(
-        std::remove_if(
-            items_.begin(), items_.end(),
-            [&](const Passcode& p)
-            {
-                if (p.code == code)
-                {
-                    removed = true;
-                    return true;
-                }
-                return false;
-            }
-        ),
-        items_.end()
-    );
-
-    if (removed)
-        return saveAll();
+    const int pos = findPos_(h.digest);
+    if (pos < 0)
+        return false;
 
-    return false;
+    h = items_[pos];
+    eraseDigest_(h.digest);
+    changes_.record(ChangeOp::Remove, h);
+    return appendJournal_(kRecHashedRemove, h);
 }
 
 bool
-PasscodeRepository::findItemByCode(const String& code, Passcode& out) const
+PasscodeRepository::removeItemById(const char* id)
 {
-    for (const auto& p : items_)
+    if (!id || strlen(id) != HashedPasscode::kIdChars)
+        return false;
+
+    // Ids are public, so a plain scan is fine; deletes are rare.
+    for (size_t i = 0; i < items_.size(); ++i)
     {
-        if (p.code == code)
-        {
-            out = p;
-            return true;
-        }
+        if (!items_[i].hasId(id))
+            continue;
+
+        const HashedPasscode h = items_[i];
+        eraseDigest_(h.digest);
+        changes_.record(ChangeOp::Remove, h);
+        return appendJournal_(kRecHashedRemove, h);
     }
     return false;
 }
 
 bool
-PasscodeRepository::validateAndConsume(const String& code, long now)
+PasscodeRepository::containsCode(const String& code) const
 {
-    for (size_t i = 0; i < items_.size(); ++i)
-    {
-        Passcode& p = items_[i];
+    return findPos_(digestOf_(code.c_str(), code.length())) >= 0;
+}
 
-        if (p.code != code)
-            continue;
+bool
+PasscodeRepository::validateAndConsume(const char* code, size_t len, long now)
+{
+    // One keyed hash and a probe, whatever the code and however many exist.
+    const int pos = findPos_(digestOf_(code, len));
+    if (pos < 0)
+        return false;
 
-        if (p.isExpired(now))
-        {
-            items_.erase(items_.begin() + i);
-            saveAll();
-            return false;
-        }
+    // Only copied when the item is about to be erased.
+    const HashedPasscode& p = items_[pos];
 
-        if (!p.isEffective(now))
-            return false;
+    if (p.isExpired(now))
+    {
+        const HashedPasscode gone = p;
+        eraseAt_((size_t)pos);
+        changes_.record(ChangeOp::Remove, gone);
+        appendJournal_(kRecHashedRemove, gone);
+        return false;
+    }
 
-        // ===== one_time =====
-        if (p.type == "one_time")
-        {
-            items_.erase(items_.begin() + i);
-            saveAll();
-            return true;
-        }
+    if (!p.isEffective(now))
+        return false;
 
-        if (p.type == "timed")
-        {
-            return true;
-        }
+    // ===== one_time =====
+    if (p.type == HashedPasscode::Type::OneTime)
+    {
+        const HashedPasscode used = p;
+        eraseAt_((size_t)pos);
+        changes_.record(ChangeOp::Remove, used);
+        appendJournal_(kRecHashedConsume, used);
+        return true;
+    }
 
-        return false;
+    if (p.type == HashedPasscode::Type::Timed)
+    {
+        return true;
     }
 
     return false;
 }
 
+size_t
+PasscodeRepository::purgeExpired(uint64_t now)
+{
+    size_t purged = 0;
+
+    ExpiryQueue::Entry e;
+    while (expiry_.due(now) && expiry_.pop(e))
+    {
+        // The code may have been removed, or re-added with a later expiry.
+        const int pos = findPos_(e.digest);
+        if (pos < 0 || !items_[pos].isExpired(now))
+            continue;
+
+        changes_.record(ChangeOp::Remove, items_[pos]);
+        eraseAt_((size_t)pos);
+        purged++;
+    }
+
+    if (purged == 0)
+        return 0;
+
+    LOG_I(TAG_REPO, "purged %u expired passcodes", (unsigned)purged);
+    saveAll();
+    return purged;
+}
+
 uint64_t
 PasscodeRepository::ts() const
 {
@@ -284,6 +807,18 @@ PasscodeRepository::setTs(uint64_t ts)
     tsMillisAtLoad_ = millis();
 }
 
+uint32_t
+PasscodeRepository::rev() const
+{
+    return changes_.rev();
+}
+
+const PasscodeRepository::Changes&
+PasscodeRepository::changes() const
+{
+    return changes_;
+}
+
 uint64_t 
 PasscodeRepository::nowSecondsFallback() const
 {
@@ -299,65 +834,78 @@ PasscodeRepository::nowSecondsFallback() const
 bool
 PasscodeRepository::saveAll()
 {
+    HEAP_SCOPE(HeapTag::Passcodes);
+
     const char* TAG = "PASSCODE_SAVE";
 
-    Logger::info(TAG, "==== saveAll() BEGIN ====");
-    Logger::info(TAG, "master='%s'", master_.c_str());
-    Logger::info(TAG, "ts=%llu", (unsigned long long)ts_);
-    Logger::info(TAG, "items count=%u", (unsigned)items_.size());
+    LOG_D(TAG, "==== saveAll() BEGIN ====");
+    LOG_D(TAG, "master=%d", (int)hasMaster_);
+    LOG_D(TAG, "ts=%llu", (unsigned long long)ts_);
+    LOG_D(TAG, "items count=%u", (unsigned)items_.size());
 
-    for (size_t i = 0; i < items_.size(); ++i)
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG))
     {
-        const auto& p = items_[i];
-        Logger::info(
-            TAG,
-            "item[%u]: code='%s', type='%s', effectiveAt=%llu, expireAt=%llu",
-            (unsigned)i,
-            p.code.c_str(),
-            p.type.c_str(),
-            (unsigned long long)p.effectiveAt,
-            (unsigned long long)p.expireAt
-        );
+        for (size_t i = 0; i < items_.size(); ++i)
+        {
+            const auto& p = items_[i];
+            char id[HashedPasscode::kIdChars + 1];
+            p.formatId(id);
+            LOG_D(
+                TAG,
+                "item[%u]: id=%s, type='%s', effectiveAt=%llu, expireAt=%llu",
+                (unsigned)i,
+                id,
+                p.typeName(),
+                (unsigned long long)p.effectiveAt,
+                (unsigned long long)p.expireAt
+            );
+        }
     }
 
-    const size_t est = kMinCap + items_.size() * 128;
-    DynamicJsonDocument doc(est > kMaxCap ? kMaxCap : est);
+    const bool ok = FileSystem::writeFileAtomic(
+        PATH,
+        [this](Print& out)
+        {
+            if (!RecordFile::writeHeader(out, RecordFile::Kind::Passcodes))
+                return false;
 
-    doc[AppJsonKeys::PASSCODES_MASTER] = master_;
-    doc[AppJsonKeys::TS] = (uint64_t)ts_;
+            RecordWriter meta(kRecMeta);
+            meta.putU64(ts_).putString("").putU64(changes_.rev());
+            if (!meta.writeTo(out))
+                return false;
 
-    JsonArray arr = doc.createNestedArray(AppJsonKeys::PASSCODES);
-    for (const auto& p : items_)
-    {
-        JsonObject o = arr.createNestedObject();
-        o["code"] = p.code;
-        o["type"] = p.type;
-        o["effectiveAt"] = (uint64_t)p.effectiveAt;
-        o["expireAt"] = (uint64_t)p.expireAt;
-    }
+            if (hasMaster_)
+            {
+                RecordWriter m(kRecMaster);
+                m.putBytes(master_.digest.bytes, PasscodeDigest::kBytes);
+                if (!m.writeTo(out))
+                    return false;
+            }
 
-    String json = JsonUtils::serialize(doc);
-    Logger::info(TAG, "json length=%u", (unsigned)json.length());
+            for (const auto& p : items_)
+            {
+                RecordWriter w(kRecHashedItem);
+                putItem(w, p);
+                if (!w.writeTo(out))
+                    return false;
+            }
+            return true;
+        }
+    );
 
-    const unsigned maxShow = 256;
-    if (json.length() <= maxShow)
+    // The snapshot now contains everything the journal described.
+    if (ok)
     {
-        Logger::info(TAG, "json='%s'", json.c_str());
-    }
-    else
-    {
-        Logger::info(
-            TAG,
-            "json(head %u)='%s...'",
-            maxShow,
-            json.substring(0, maxShow).c_str()
-        );
+        if (FileSystem::exists(JOURNAL_PATH))
+            FileSystem::remove(JOURNAL_PATH);
+        journalRecords_ = 0;
     }
 
-    const bool ok = FileSystem::writeFileAtomic(PATH, json);
-
-    Logger::info(TAG, "writeFileAtomic -> %d", (int)ok);
-    Logger::info(TAG, "==== saveAll() END ====");
+    LOG_I(
+        TAG, "writeFileAtomic -> %d (flash total=%u bytes)", (int)ok,
+        (unsigned)FileSystem::bytesWritten()
+    );
+    LOG_D(TAG, "==== saveAll() END ====");
 
     return ok;
 }
@@ -1,31 +1,48 @@
 #pragma once
 #include "config/AppPaths.h"
+#include "models/HashedPasscode.h"
 #include "models/PasscodeTemp.h"
+#include "storage/ChangeLog.h"
+#include "storage/ExpiryQueue.h"
+#include "storage/PasscodeIndex.h"
 
 #include <Arduino.h>
 #include <vector>
 
+// Passcodes are kept only as HMAC-SHA256 digests under a random per-device
+// key (/passcodes.key), in RAM, on flash and in what is published: codes
+// arrive in requests and on the keypad, are hashed, and are dropped. Items
+// are published and can be deleted by their id (see HashedPasscode).
 class PasscodeRepository
 {
   public:
+    static constexpr size_t kChangeLogSize = 32;
+    using Changes = ChangeLog<HashedPasscode, kChangeLogSize>;
+
     bool
     load();
 
-    String
+    bool
+    hasMaster() const;
+    // Valid while hasMaster().
+    const HashedPasscode&
     getMaster() const;
     bool
+    matchesMaster(const char* code, size_t len) const;
+    // An empty code clears the master.
+    bool
     setMaster(const String& pass);
 
     bool
     hasTemp() const;
-    const Passcode&
+    const HashedPasscode&
     getTemp() const;
     bool
     setTemp(const Passcode& temp);
     bool
     clearTemp();
 
-    const std::vector<Passcode>&
+    const std::vector<HashedPasscode>&
     listItems() const;
     bool
     setItems(const std::vector<Passcode>& items, long ts);
@@ -34,10 +51,18 @@ class PasscodeRepository
     bool
     removeItemByCode(const String& code);
     bool
-    findItemByCode(const String& code, Passcode& out) const;
+    removeItemById(const char* id);
+    bool
+    containsCode(const String& code) const;
 
+    // Takes the raw keypad buffer so a key press never builds a String.
     bool
-    validateAndConsume(const String& code, long now);
+    validateAndConsume(const char* code, size_t len, long now);
+
+    // Removes every item whose expireAt has passed and saves once if any
+    // went. Cheap to call every loop: nothing is scanned until one is due.
+    size_t
+    purgeExpired(uint64_t now);
 
     uint64_t 
     nowSecondsFallback() const;
@@ -49,21 +74,75 @@ class PasscodeRepository
     void
     setTs(uint64_t ts);
 
+    // Revision of the list, bumped on every change and persisted with it.
+    uint32_t
+    rev() const;
+
+    const Changes&
+    changes() const;
+
   private:
-    String master_;
+    HashedPasscode master_;
+    bool hasMaster_{false};
 
-    Passcode temp_;
+    // RAM only; never stored or published.
+    HashedPasscode temp_;
     bool hasTemp_{false};
 
-    std::vector<Passcode> items_;
+    // HMAC key for every digest; generated once per device.
+    uint8_t key_[PasscodeDigest::kBytes] = {};
+
+    std::vector<HashedPasscode> items_;
+    PasscodeIndex index_;
+    ExpiryQueue expiry_;
     uint64_t ts_{0ULL};
 
     uint32_t tsMillisAtLoad_ = 0;
 
-    static constexpr const char* PATH = AppPaths::PASSCODES_JSON;
+    uint16_t journalRecords_{0};
+
+    // Plaintext records were read by load(); saved again as digests.
+    bool sawPlaintext_{false};
+
+    Changes changes_;
+
+    static constexpr const char* PATH = AppPaths::PASSCODES_BIN;
+    static constexpr const char* JOURNAL_PATH = AppPaths::PASSCODES_JOURNAL;
+    static constexpr const char* KEY_PATH = AppPaths::PASSCODES_KEY;
+    static constexpr const char* LEGACY_JSON_PATH = AppPaths::PASSCODES_JSON;
+    static constexpr const char* LEGACY_JOURNAL_PATH = AppPaths::PASSCODES_JOURNAL_JSON;
 
-    static size_t
-    calcDocCapacity(const String& json);
     bool
     saveAll();
+
+    void
+    loadKey_();
+    PasscodeDigest
+    digestOf_(const char* code, size_t len) const;
+    // Hashes a validated request item.
+    HashedPasscode
+    hash_(const Passcode& p) const;
+
+    bool
+    loadBinary_();
+    bool
+    migrateFromJson_();
+    void
+    replayLegacyJournal_();
+
+    bool
+    appendJournal_(uint8_t recType, const HashedPasscode& p);
+    void
+    replayJournal_();
+    int
+    findPos_(const PasscodeDigest& digest) const;
+    // Appends to items_ and index_; false once the index is full.
+    bool
+    pushItem_(const HashedPasscode& p);
+    void
+    eraseAt_(size_t pos);
+    void
+    rebuildExpiry_();
+    bool
+    eraseDigest_(const PasscodeDigest& digest);
 };
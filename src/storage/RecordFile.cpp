@@ -0,0 +1,253 @@
+#include "storage/RecordFile.h"
+
+namespace
+{
+uint32_t
+crc32Update(uint32_t crc, const uint8_t* data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+void
+putLe(uint8_t* dst, uint64_t v, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (uint8_t)(v >> (8 * i));
+}
+
+uint64_t
+getLe(const uint8_t* src, size_t n)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i)
+        v |= (uint64_t)src[i] << (8 * i);
+    return v;
+}
+
+bool
+readExact(Stream& in, uint8_t* dst, size_t n)
+{
+    return in.readBytes((char*)dst, n) == n;
+}
+} // namespace
+
+bool
+RecordFile::writeHeader(Print& out, Kind kind)
+{
+    uint8_t h[HEADER_SIZE] = {};
+    putLe(h, MAGIC, 4);
+    h[4] = VERSION;
+    h[5] = (uint8_t)kind;
+
+    return out.write(h, sizeof(h)) == sizeof(h);
+}
+
+bool
+RecordFile::readHeader(Stream& in, Kind kind)
+{
+    uint8_t h[HEADER_SIZE];
+    if (!readExact(in, h, sizeof(h)))
+        return false;
+
+    return getLe(h, 4) == MAGIC && h[4] == VERSION && h[5] == (uint8_t)kind;
+}
+
+RecordWriter::RecordWriter(uint8_t type) : type_(type)
+{
+}
+
+bool
+RecordWriter::reserve_(size_t n)
+{
+    if (!ok_ || len_ + n > sizeof(buf_))
+    {
+        ok_ = false;
+        return false;
+    }
+    return true;
+}
+
+RecordWriter&
+RecordWriter::putU8(uint8_t v)
+{
+    if (reserve_(1))
+        buf_[len_++] = v;
+    return *this;
+}
+
+RecordWriter&
+RecordWriter::putU64(uint64_t v)
+{
+    if (reserve_(8))
+    {
+        putLe(buf_ + len_, v, 8);
+        len_ += 8;
+    }
+    return *this;
+}
+
+RecordWriter&
+RecordWriter::putString(const String& s)
+{
+    const size_t n = s.length();
+    if (n > RecordFile::MAX_STRING)
+    {
+        ok_ = false;
+        return *this;
+    }
+
+    if (reserve_(1 + n))
+    {
+        buf_[len_++] = (uint8_t)n;
+        memcpy(buf_ + len_, s.c_str(), n);
+        len_ += n;
+    }
+    return *this;
+}
+
+RecordWriter&
+RecordWriter::putBytes(const uint8_t* data, size_t n)
+{
+    if (reserve_(n))
+    {
+        memcpy(buf_ + len_, data, n);
+        len_ += n;
+    }
+    return *this;
+}
+
+bool
+RecordWriter::ok() const
+{
+    return ok_;
+}
+
+bool
+RecordWriter::writeTo(Print& out) const
+{
+    if (!ok_)
+        return false;
+
+    uint8_t head[3];
+    head[0] = type_;
+    putLe(head + 1, len_, 2);
+
+    uint8_t tail[4];
+    putLe(tail, crc32Update(crc32Update(0, head, sizeof(head)), buf_, len_), 4);
+
+    return out.write(head, sizeof(head)) == sizeof(head) && out.write(buf_, len_) == len_ &&
+        out.write(tail, sizeof(tail)) == sizeof(tail);
+}
+
+RecordReader::RecordReader(Stream& in) : in_(in)
+{
+    // Files never block; without this readBytes waits out the stream timeout at EOF.
+    in_.setTimeout(0);
+}
+
+bool
+RecordReader::next()
+{
+    len_ = 0;
+    pos_ = 0;
+
+    if (corrupt_)
+        return false;
+
+    uint8_t head[3];
+    const size_t got = in_.readBytes((char*)head, sizeof(head));
+    if (got == 0)
+        return false;
+
+    const size_t len = (size_t)getLe(head + 1, 2);
+    uint8_t tail[4];
+
+    if (got != sizeof(head) || len > sizeof(buf_) || !readExact(in_, buf_, len) ||
+        !readExact(in_, tail, sizeof(tail)))
+    {
+        corrupt_ = true;
+        return false;
+    }
+
+    const uint32_t crc = crc32Update(crc32Update(0, head, sizeof(head)), buf_, len);
+    if (crc != (uint32_t)getLe(tail, 4))
+    {
+        corrupt_ = true;
+        return false;
+    }
+
+    type_ = head[0];
+    len_ = len;
+    consumed_ += sizeof(head) + len + sizeof(tail);
+    return true;
+}
+
+uint8_t
+RecordReader::type() const
+{
+    return type_;
+}
+
+bool
+RecordReader::corrupt() const
+{
+    return corrupt_;
+}
+
+size_t
+RecordReader::consumed() const
+{
+    return consumed_;
+}
+
+bool
+RecordReader::getU8(uint8_t& out)
+{
+    if (pos_ + 1 > len_)
+        return false;
+
+    out = buf_[pos_++];
+    return true;
+}
+
+bool
+RecordReader::getU64(uint64_t& out)
+{
+    if (pos_ + 8 > len_)
+        return false;
+
+    out = getLe(buf_ + pos_, 8);
+    pos_ += 8;
+    return true;
+}
+
+bool
+RecordReader::getString(String& out)
+{
+    uint8_t n = 0;
+    if (!getU8(n) || pos_ + n > len_)
+        return false;
+
+    out = "";
+    out.concat((const char*)buf_ + pos_, n);
+    pos_ += n;
+    return true;
+}
+
+bool
+RecordReader::getBytes(uint8_t* out, size_t n)
+{
+    if (pos_ + n > len_)
+        return false;
+
+    memcpy(out, buf_ + pos_, n);
+    pos_ += n;
+    return true;
+}
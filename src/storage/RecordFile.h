@@ -0,0 +1,114 @@
+#pragma once
+#include <Arduino.h>
+
+// Versioned binary record format used for the credential stores.
+//
+//   file   := header record*
+//   header := magic(u32) version(u8) kind(u8) reserved(u16)
+//   record := type(u8) len(u16) payload[len] crc32(u32)
+//
+// Integers are little-endian. Strings are a u8 length followed by bytes;
+// fixed-size byte fields (digests, keys) are stored as is.
+// The CRC covers type, len and payload, so a torn tail record from a power
+// cut is detected and loading stops there.
+namespace RecordFile
+{
+static constexpr uint32_t MAGIC = 0x46524C53; // "SLRF"
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t HEADER_SIZE = 8;
+static constexpr size_t MAX_PAYLOAD = 512;
+static constexpr size_t MAX_STRING = 255;
+
+enum class Kind : uint8_t
+{
+    Cards = 1,
+    Passcodes = 2,
+    PasscodeJournal = 3,
+    Outbox = 4,
+    PasscodeKey = 5
+};
+
+bool
+writeHeader(Print& out, Kind kind);
+
+bool
+readHeader(Stream& in, Kind kind);
+} // namespace RecordFile
+
+class RecordWriter
+{
+  public:
+    explicit RecordWriter(uint8_t type);
+
+    RecordWriter&
+    putU8(uint8_t v);
+
+    RecordWriter&
+    putU64(uint64_t v);
+
+    // A string longer than RecordFile::MAX_STRING fails the record, like an
+    // oversized payload: ok() turns false and writeTo() writes nothing.
+    RecordWriter&
+    putString(const String& s);
+
+    RecordWriter&
+    putBytes(const uint8_t* data, size_t n);
+
+    bool
+    ok() const;
+
+    bool
+    writeTo(Print& out) const;
+
+  private:
+    bool
+    reserve_(size_t n);
+
+    uint8_t type_;
+    uint8_t buf_[RecordFile::MAX_PAYLOAD];
+    size_t len_{0};
+    bool ok_{true};
+};
+
+class RecordReader
+{
+  public:
+    explicit RecordReader(Stream& in);
+
+    // Reads the next record. Returns false at end of file or on a bad record;
+    // corrupt() tells the two apart.
+    bool
+    next();
+
+    uint8_t
+    type() const;
+
+    bool
+    corrupt() const;
+
+    // Bytes of complete records read so far.
+    size_t
+    consumed() const;
+
+    bool
+    getU8(uint8_t& out);
+
+    bool
+    getU64(uint64_t& out);
+
+    bool
+    getString(String& out);
+
+    // Exactly `n` bytes, or false.
+    bool
+    getBytes(uint8_t* out, size_t n);
+
+  private:
+    Stream& in_;
+    uint8_t type_{0};
+    uint8_t buf_[RecordFile::MAX_PAYLOAD];
+    size_t len_{0};
+    size_t pos_{0};
+    size_t consumed_{0};
+    bool corrupt_{false};
+};
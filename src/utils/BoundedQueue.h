@@ -0,0 +1,101 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Bounded lock-free MPMC queue of fixed-size cells (Vyukov). Producers claim
+// a cell, fill it in place and publish it; a full queue fails instead of
+// blocking, so it is usable from any task.
+//
+// Producer: T* c = tryClaim(ticket); fill *c; publish(ticket).
+// Consumer: T* c = tryPeek(ticket); read *c; release(ticket).
+template <typename T, size_t N>
+class BoundedQueue
+{
+    static_assert((N & (N - 1)) == 0, "BoundedQueue size must be a power of two");
+
+  public:
+    BoundedQueue()
+    {
+        for (size_t i = 0; i < N; ++i)
+            cells_[i].seq.store((uint32_t)i, std::memory_order_relaxed);
+    }
+
+    T*
+    tryClaim(uint32_t& ticket)
+    {
+        uint32_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& c = cells_[pos & (N - 1)];
+            const int32_t diff = (int32_t)(c.seq.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    ticket = pos;
+                    return &c.value;
+                }
+            }
+            else if (diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void
+    publish(uint32_t ticket)
+    {
+        cells_[ticket & (N - 1)].seq.store(ticket + 1, std::memory_order_release);
+    }
+
+    T*
+    tryPeek(uint32_t& ticket)
+    {
+        uint32_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& c = cells_[pos & (N - 1)];
+            const int32_t diff = (int32_t)(c.seq.load(std::memory_order_acquire) - (pos + 1));
+
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    ticket = pos;
+                    return &c.value;
+                }
+            }
+            else if (diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void
+    release(uint32_t ticket)
+    {
+        cells_[ticket & (N - 1)].seq.store(ticket + N, std::memory_order_release);
+    }
+
+  private:
+    struct Cell
+    {
+        std::atomic<uint32_t> seq;
+        T value;
+    };
+
+    Cell cells_[N];
+    std::atomic<uint32_t> enqueuePos_{0};
+    std::atomic<uint32_t> dequeuePos_{0};
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "models/Command.h"
+#include "utils/Scheduler.h"
 
 #include <Arduino.h>
 #include <queue>
@@ -15,6 +16,7 @@ class CommandQueue
             return false;
 
         queue_.push(cmd);
+        Scheduler::notify(WakeEvent::COMMAND);
         return true;
     }
 
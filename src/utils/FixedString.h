@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+#include <string.h>
+
+// NUL-terminated string with its storage inline, for the per-key, per-tap
+// and per-message paths that must not allocate. An append that does not fit
+// is refused whole and leaves the contents unchanged.
+template <size_t N>
+class FixedString
+{
+    static_assert(N > 0 && N < 0xFFFF, "FixedString capacity out of range");
+
+  public:
+    FixedString()
+    {
+        buf_[0] = '\0';
+    }
+
+    explicit FixedString(const char* s) : FixedString()
+    {
+        append(s);
+    }
+
+    static constexpr size_t
+    capacity()
+    {
+        return N;
+    }
+
+    size_t
+    length() const
+    {
+        return len_;
+    }
+
+    bool
+    isEmpty() const
+    {
+        return len_ == 0;
+    }
+
+    const char*
+    c_str() const
+    {
+        return buf_;
+    }
+
+    char
+    operator[](size_t i) const
+    {
+        return buf_[i];
+    }
+
+    void
+    clear()
+    {
+        len_ = 0;
+        buf_[0] = '\0';
+    }
+
+    // Also overwrites the old contents, for secrets such as PINs.
+    void
+    wipe()
+    {
+        volatile char* p = buf_;
+        for (size_t i = 0; i <= N; ++i)
+            p[i] = '\0';
+        len_ = 0;
+    }
+
+    bool
+    append(char c)
+    {
+        if (len_ >= N)
+            return false;
+
+        buf_[len_++] = c;
+        buf_[len_] = '\0';
+        return true;
+    }
+
+    bool
+    append(const char* s, size_t n)
+    {
+        if (n > N - len_)
+            return false;
+
+        memcpy(buf_ + len_, s, n);
+        len_ += n;
+        buf_[len_] = '\0';
+        return true;
+    }
+
+    bool
+    append(const char* s)
+    {
+        return append(s, strlen(s));
+    }
+
+    // Two upper-case hex digits.
+    bool
+    appendHex(uint8_t b)
+    {
+        static const char kDigits[] = "0123456789ABCDEF";
+        const char hex[2] = {kDigits[b >> 4], kDigits[b & 0x0F]};
+        return append(hex, sizeof(hex));
+    }
+
+    bool
+    equals(const char* s, size_t n) const
+    {
+        return n == len_ && memcmp(buf_, s, n) == 0;
+    }
+
+    bool
+    operator==(const FixedString& other) const
+    {
+        return equals(other.buf_, other.len_);
+    }
+
+    bool
+    operator!=(const FixedString& other) const
+    {
+        return !(*this == other);
+    }
+
+  private:
+    char buf_[N + 1];
+    uint16_t len_{0};
+};
@@ -0,0 +1,310 @@
+#include "utils/HeapMonitor.h"
+
+#include "utils/Logger.h"
+
+#include <atomic>
+
+namespace
+{
+constexpr const char* TAG = "HEAP";
+
+// 5 minutes of history at the 30 s health period.
+constexpr size_t kWindow = 10;
+
+constexpr uint32_t kCriticalFree = 20000;
+constexpr uint32_t kWarnFree = 30000;
+// mbedTLS and the JSON documents need contiguous blocks of about this size.
+constexpr uint32_t kCriticalBlock = 8192;
+constexpr uint32_t kWarnBlock = 16384;
+constexpr uint8_t kWarnFragPct = 60;
+// Consecutive samples below kCriticalBlock, or consecutive evaluations
+// projecting it within kHorizonMs, before restarting.
+constexpr uint8_t kCriticalSamples = 3;
+constexpr uint32_t kHorizonMs = 10UL * 60UL * 1000UL;
+
+struct Sample
+{
+    uint32_t atMs;
+    uint32_t freeBytes;
+    uint32_t largest;
+};
+
+Sample s_samples[kWindow];
+size_t s_count = 0;
+size_t s_next = 0;
+uint8_t s_lowBlockRun = 0;
+uint8_t s_projectedRun = 0;
+
+const Sample&
+newest()
+{
+    return s_samples[(s_next + kWindow - 1) % kWindow];
+}
+
+// 0 is the oldest sample in the window.
+const Sample&
+at(size_t i)
+{
+    const size_t first = s_count < kWindow ? 0 : s_next;
+    return s_samples[(first + i) % kWindow];
+}
+
+// Least-squares slope over every sample in the window, in bytes per minute,
+// so one outlier at either end cannot fake a trend. Ten samples every 30 s:
+// double is cheap enough and cannot overflow.
+int32_t
+perMinute(uint32_t Sample::*field)
+{
+    if (s_count < 2)
+        return 0;
+
+    const uint32_t t0 = at(0).atMs;
+    double meanT = 0;
+    double meanV = 0;
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        meanT += (double)(at(i).atMs - t0);
+        meanV += (double)(at(i).*field);
+    }
+    meanT /= s_count;
+    meanV /= s_count;
+
+    double num = 0;
+    double den = 0;
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        const double dt = (double)(at(i).atMs - t0) - meanT;
+        num += dt * ((double)(at(i).*field) - meanV);
+        den += dt * dt;
+    }
+    return den > 0 ? (int32_t)(num / den * 60000.0) : 0;
+}
+
+#ifdef ENABLE_HEAP_TRACKING
+struct TagCounts
+{
+    std::atomic<uint32_t> allocs{0};
+    std::atomic<uint32_t> bytes{0};
+};
+
+TagCounts s_tags[(size_t)HeapTag::Count];
+std::atomic<uint32_t> s_frees{0};
+TaskHandle_t s_appTask = nullptr;
+HeapTag s_current = HeapTag::Other; // only changed by the app task
+
+const char* const kTagNames[(size_t)HeapTag::Count] = {
+    "other", "mqtt", "publish", "passcodes", "cards",
+};
+
+void
+countAlloc(size_t n)
+{
+    const HeapTag tag =
+        (s_appTask && xTaskGetCurrentTaskHandle() == s_appTask) ? s_current : HeapTag::Other;
+    TagCounts& c = s_tags[(size_t)tag];
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add((uint32_t)n, std::memory_order_relaxed);
+}
+#endif
+} // namespace
+
+#ifdef ENABLE_HEAP_TRACKING
+// Linked in with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free.
+extern "C"
+{
+    void*
+    __real_malloc(size_t n);
+    void*
+    __real_calloc(size_t n, size_t size);
+    void*
+    __real_realloc(void* p, size_t n);
+    void
+    __real_free(void* p);
+
+    void*
+    __wrap_malloc(size_t n)
+    {
+        countAlloc(n);
+        return __real_malloc(n);
+    }
+
+    void*
+    __wrap_calloc(size_t n, size_t size)
+    {
+        countAlloc(n * size);
+        return __real_calloc(n, size);
+    }
+
+    void*
+    __wrap_realloc(void* p, size_t n)
+    {
+        countAlloc(n);
+        return __real_realloc(p, n);
+    }
+
+    void
+    __wrap_free(void* p)
+    {
+        if (p)
+            s_frees.fetch_add(1, std::memory_order_relaxed);
+        __real_free(p);
+    }
+}
+
+HeapTag
+HeapMonitor::enter(HeapTag tag)
+{
+    const HeapTag previous = s_current;
+    s_current = tag;
+    return previous;
+}
+
+void
+HeapMonitor::leave(HeapTag previous)
+{
+    s_current = previous;
+}
+#endif
+
+void
+HeapMonitor::begin()
+{
+#ifdef ENABLE_HEAP_TRACKING
+    s_appTask = xTaskGetCurrentTaskHandle();
+#endif
+    sample();
+}
+
+void
+HeapMonitor::sample()
+{
+    Sample& s = s_samples[s_next];
+    s.atMs = millis();
+    s.freeBytes = ESP.getFreeHeap();
+    s.largest = ESP.getMaxAllocHeap();
+
+    s_next = (s_next + 1) % kWindow;
+    if (s_count < kWindow)
+        s_count++;
+
+    if (s.largest < kCriticalBlock)
+        s_lowBlockRun++;
+    else
+        s_lowBlockRun = 0;
+}
+
+HeapVerdict
+HeapMonitor::evaluate()
+{
+    if (s_count == 0)
+        return HeapVerdict::Ok;
+
+    const Sample& s = newest();
+
+    if (s.freeBytes < kCriticalFree)
+    {
+        LOG_E(TAG, "free heap %u < %u bytes", (unsigned)s.freeBytes, (unsigned)kCriticalFree);
+        return HeapVerdict::Restart;
+    }
+
+    if (s_lowBlockRun >= kCriticalSamples)
+    {
+        LOG_E(
+            TAG, "largest block %u < %u bytes for %u samples", (unsigned)s.largest,
+            (unsigned)kCriticalBlock, (unsigned)s_lowBlockRun
+        );
+        return HeapVerdict::Restart;
+    }
+
+    // Only trust the trend over a full window, only act on it once the
+    // largest block is already small, and only once the projection has held
+    // for several evaluations in a row.
+    const int32_t trend = largestBlockTrend();
+    uint32_t msLeft = UINT32_MAX;
+    if (s_count == kWindow && trend < 0 && s.largest < kWarnBlock)
+    {
+        const uint32_t headroom = s.largest > kCriticalBlock ? s.largest - kCriticalBlock : 0;
+        msLeft = (uint32_t)((uint64_t)headroom * 60000 / (uint32_t)-trend);
+    }
+
+    if (msLeft < kHorizonMs)
+    {
+        if (s_projectedRun < kCriticalSamples)
+            s_projectedRun++;
+    }
+    else
+    {
+        s_projectedRun = 0;
+    }
+
+    if (s_projectedRun >= kCriticalSamples)
+    {
+        LOG_E(
+            TAG, "largest block %u bytes shrinking %ld B/min, ~%u s to %u", (unsigned)s.largest,
+            (long)trend, (unsigned)(msLeft / 1000), (unsigned)kCriticalBlock
+        );
+        return HeapVerdict::Restart;
+    }
+
+    const uint8_t frag = fragmentationPct();
+    if (s.freeBytes < kWarnFree || s.largest < kWarnBlock || frag >= kWarnFragPct)
+    {
+        LOG_W(
+            TAG, "free=%u largest=%u frag=%u%% trend=%ld B/min", (unsigned)s.freeBytes,
+            (unsigned)s.largest, (unsigned)frag, (long)trend
+        );
+        return HeapVerdict::Warn;
+    }
+
+    return HeapVerdict::Ok;
+}
+
+int32_t
+HeapMonitor::freeTrend()
+{
+    return perMinute(&Sample::freeBytes);
+}
+
+int32_t
+HeapMonitor::largestBlockTrend()
+{
+    return perMinute(&Sample::largest);
+}
+
+uint8_t
+HeapMonitor::fragmentationPct()
+{
+    if (s_count == 0 || newest().freeBytes == 0)
+        return 0;
+
+    const Sample& s = newest();
+    return (uint8_t)(100 - (uint64_t)s.largest * 100 / s.freeBytes);
+}
+
+void
+HeapMonitor::toJson(JsonObject out)
+{
+    if (s_count == 0)
+        return;
+
+    const Sample& s = newest();
+    out["free"] = s.freeBytes;
+    out["minFree"] = (uint32_t)ESP.getMinFreeHeap();
+    out["largest"] = s.largest;
+    out["fragPct"] = fragmentationPct();
+    out["freeTrend"] = freeTrend();
+    out["largestTrend"] = largestBlockTrend();
+
+#ifdef ENABLE_HEAP_TRACKING
+    out["frees"] = s_frees.load(std::memory_order_relaxed);
+
+    JsonArray allocs = out.createNestedArray("allocs");
+    for (size_t i = 0; i < (size_t)HeapTag::Count; ++i)
+    {
+        JsonObject o = allocs.createNestedObject();
+        o["tag"] = kTagNames[i];
+        o["n"] = s_tags[i].allocs.load(std::memory_order_relaxed);
+        o["bytes"] = s_tags[i].bytes.load(std::memory_order_relaxed);
+    }
+#endif
+}
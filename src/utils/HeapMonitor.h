@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Heap health beyond the raw free byte count: the largest free block (what
+// a String or TLS record can actually get), the all-time minimum and the
+// trend of both over the last few samples. The restart policy in
+// evaluate() uses those instead of a single free-heap threshold.
+//
+// With -DENABLE_HEAP_TRACKING (and the --wrap linker flags listed in
+// platformio.ini) malloc/calloc/realloc/free are also counted, per
+// HeapTag for allocations made by the app task inside a HEAP_SCOPE.
+
+enum class HeapTag : uint8_t
+{
+    Other,
+    Mqtt,
+    Publish,
+    Passcodes,
+    Cards,
+    Count
+};
+
+enum class HeapVerdict : uint8_t
+{
+    Ok,
+    Warn,
+    Restart
+};
+
+class HeapMonitor
+{
+  public:
+    // Call from the app task; allocations from other tasks count as Other.
+    static void
+    begin();
+
+    // One sample per health tick.
+    static void
+    sample();
+
+    // Judges the most recent samples; logs the reason for anything but Ok.
+    static HeapVerdict
+    evaluate();
+
+    static void
+    toJson(JsonObject out);
+
+    // Least-squares slope over the sample window in bytes per minute;
+    // negative when shrinking.
+    static int32_t
+    freeTrend();
+
+    static int32_t
+    largestBlockTrend();
+
+    static uint8_t
+    fragmentationPct();
+
+#ifdef ENABLE_HEAP_TRACKING
+    static HeapTag
+    enter(HeapTag tag);
+
+    static void
+    leave(HeapTag previous);
+#endif
+};
+
+#ifdef ENABLE_HEAP_TRACKING
+
+class HeapScope
+{
+  public:
+    explicit HeapScope(HeapTag tag) : previous_(HeapMonitor::enter(tag)) {}
+
+    ~HeapScope()
+    {
+        HeapMonitor::leave(previous_);
+    }
+
+  private:
+    HeapTag previous_;
+};
+
+#define HEAP_SCOPE(tag) HeapScope heapScope_(tag)
+
+#else
+
+#define HEAP_SCOPE(tag) \
+    do                  \
+    {                   \
+    } while (0)
+
+#endif
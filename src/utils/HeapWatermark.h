@@ -0,0 +1,48 @@
+#pragma once
+#include "utils/Logger.h"
+
+#include <Arduino.h>
+
+// Lowest free heap seen between construction and destruction. Call sample()
+// where usage peaks (e.g. once per record); the result is logged on exit.
+class HeapWatermark
+{
+  public:
+    HeapWatermark(const char* tag, const char* what)
+        : tag_(tag), what_(what), start_(ESP.getFreeHeap()), low_(start_)
+    {
+    }
+
+    ~HeapWatermark()
+    {
+        sample();
+        LOG_I(
+            tag_, "%s: peak heap use %u bytes (free %u -> low %u)", what_,
+            (unsigned)peakBytes(), (unsigned)start_, (unsigned)low_
+        );
+    }
+
+    void
+    sample()
+    {
+        const uint32_t freeNow = ESP.getFreeHeap();
+        if (freeNow < low_)
+            low_ = freeNow;
+    }
+
+    uint32_t
+    peakBytes() const
+    {
+        return start_ > low_ ? start_ - low_ : 0;
+    }
+
+  private:
+    HeapWatermark(const HeapWatermark&) = delete;
+    HeapWatermark&
+    operator=(const HeapWatermark&) = delete;
+
+    const char* tag_;
+    const char* what_;
+    uint32_t start_;
+    uint32_t low_;
+};
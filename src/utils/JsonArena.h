@@ -0,0 +1,77 @@
+#pragma once
+#include "utils/Logger.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// One JsonDocument allocated for the lifetime of its owner and lent out,
+// cleared, for one message at a time. ArduinoJson already bump-allocates
+// inside a document, so reusing it replaces a malloc/free of a different
+// size per message with nothing.
+//
+// A lease asking for more than the arena holds, or taken while the arena
+// is already lent out (a publish from inside a publish), gets a heap
+// document of its own instead.
+class JsonArena
+{
+  public:
+    explicit JsonArena(size_t capacity) : doc_(capacity) {}
+
+    class Lease
+    {
+      public:
+        Lease(JsonArena& arena, size_t capacity) : arena_(arena)
+        {
+            if (!arena_.busy_ && capacity <= arena_.doc_.capacity())
+            {
+                arena_.busy_ = true;
+                arena_.doc_.clear();
+                return;
+            }
+
+            arena_.fallbacks_++;
+            LOG_W(
+                "JSON", "arena %s, %u bytes from the heap", arena_.busy_ ? "busy" : "too small",
+                (unsigned)capacity
+            );
+            own_ = new DynamicJsonDocument(capacity);
+        }
+
+        ~Lease()
+        {
+            if (own_)
+                delete own_;
+            else
+                arena_.busy_ = false;
+        }
+
+        JsonDocument&
+        doc()
+        {
+            return own_ ? static_cast<JsonDocument&>(*own_) : arena_.doc_;
+        }
+
+      private:
+        Lease(const Lease&) = delete;
+        Lease&
+        operator=(const Lease&) = delete;
+
+        JsonArena& arena_;
+        DynamicJsonDocument* own_ = nullptr;
+    };
+
+    uint32_t
+    fallbacks() const
+    {
+        return fallbacks_;
+    }
+
+  private:
+    JsonArena(const JsonArena&) = delete;
+    JsonArena&
+    operator=(const JsonArena&) = delete;
+
+    DynamicJsonDocument doc_;
+    bool busy_ = false;
+    uint32_t fallbacks_ = 0;
+};
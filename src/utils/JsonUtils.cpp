@@ -7,6 +7,52 @@ JsonUtils::deserialize(const String& json, JsonDocument& doc)
     return !err;
 }
 
+bool
+JsonUtils::deserialize(Stream& in, JsonDocument& doc)
+{
+    in.setTimeout(0);
+    const DeserializationError err = deserializeJson(doc, in);
+    return !err;
+}
+
+bool
+JsonUtils::deserialize(Stream& in, JsonDocument& doc, const JsonDocument& filter)
+{
+    in.setTimeout(0);
+    const DeserializationError err =
+        deserializeJson(doc, in, DeserializationOption::Filter(filter));
+    return !err;
+}
+
+bool
+JsonUtils::forEachArrayItem(Stream& in, const char* key, JsonDocument& item, const ItemHandler& fn)
+{
+    in.setTimeout(0);
+
+    String pattern("\"");
+    pattern += key;
+    pattern += "\":[";
+
+    if (!in.find(pattern.c_str()))
+        return true;
+
+    while (isSpace(in.peek()))
+        in.read();
+    if (in.peek() == ']')
+        return true;
+
+    do
+    {
+        item.clear();
+        if (deserializeJson(item, in))
+            return false;
+
+        fn(item.as<JsonObjectConst>());
+    } while (in.findUntil(",", "]"));
+
+    return true;
+}
+
 String
 JsonUtils::serialize(const JsonDocument& doc)
 {
@@ -1,13 +1,29 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <functional>
 
 class JsonUtils
 {
   public:
+    using ItemHandler = std::function<void(JsonObjectConst item)>;
+
     static bool
     deserialize(const String& json, JsonDocument& doc);
 
+    static bool
+    deserialize(Stream& in, JsonDocument& doc);
+
+    // Only the members present in `filter` are kept in `doc`.
+    static bool
+    deserialize(Stream& in, JsonDocument& doc, const JsonDocument& filter);
+
+    // Walks the array stored under top-level `key`, parsing one element at a
+    // time into `item`, so memory is bounded by the largest element rather
+    // than the whole array. Expects compact JSON as written by serializeJson.
+    static bool
+    forEachArrayItem(Stream& in, const char* key, JsonDocument& item, const ItemHandler& fn);
+
     static String
     serialize(const JsonDocument& doc);
 
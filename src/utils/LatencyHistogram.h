@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+
+// Log2 histogram of durations in microseconds: bucket i counts samples in
+// [2^i, 2^(i+1)) with everything below 2 us in bucket 0 and everything from
+// 2^(BUCKETS-1) us up in the last. Fixed size, no allocation.
+class LatencyHistogram
+{
+  public:
+    static constexpr size_t BUCKETS = 24; // last bucket starts at ~8.4 s
+
+    void
+    record(uint32_t us)
+    {
+        size_t b = 0;
+        while (b + 1 < BUCKETS && (us >> (b + 1)) != 0)
+            b++;
+
+        counts_[b]++;
+        total_++;
+        if (us > max_)
+            max_ = us;
+    }
+
+    void
+    reset()
+    {
+        for (size_t i = 0; i < BUCKETS; ++i)
+            counts_[i] = 0;
+        total_ = 0;
+        max_ = 0;
+    }
+
+    uint32_t
+    count(size_t bucket) const
+    {
+        return bucket < BUCKETS ? counts_[bucket] : 0;
+    }
+
+    uint32_t
+    total() const
+    {
+        return total_;
+    }
+
+    uint32_t
+    maxUs() const
+    {
+        return max_;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (0-100).
+    uint32_t
+    percentileUs(uint8_t p) const
+    {
+        if (total_ == 0)
+            return 0;
+
+        const uint64_t want = ((uint64_t)total_ * p + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= want && seen > 0)
+                return i + 1 < BUCKETS ? (2u << i) : max_;
+        }
+        return max_;
+    }
+
+  private:
+    uint32_t counts_[BUCKETS] = {};
+    uint32_t total_{0};
+    uint32_t max_{0};
+};
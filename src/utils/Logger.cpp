@@ -1,6 +1,498 @@
 #include "utils/Logger.h"
 
+#include "utils/BoundedQueue.h"
+
+#include <atomic>
 #include <stdarg.h>
+#include <string.h>
+
+namespace
+{
+constexpr size_t kSlots = 32;
+// Captured arguments per message; long %s arguments are cut to fit.
+constexpr size_t kArgBytes = 128;
+constexpr size_t kLineBytes = 256;
+
+constexpr UBaseType_t kTaskPriority = tskIDLE_PRIORITY;
+constexpr uint32_t kTaskStackBytes = 3072;
+constexpr TickType_t kTaskPeriod = pdMS_TO_TICKS(20);
+
+struct Record
+{
+    const char* tag;
+    const char* fmt;
+    LogLevel level;
+    uint8_t len;
+    bool truncated;
+    uint8_t args[kArgBytes];
+};
+
+enum class ArgKind : uint8_t
+{
+    Literal, // %%
+    Signed,
+    Unsigned,
+    Double,
+    Char,
+    Pointer,
+    String,
+    Unsupported
+};
+
+// One conversion of a printf format, parsed identically when capturing and
+// when formatting so both sides agree on the argument layout.
+struct Spec
+{
+    char flags[6];
+    uint8_t nFlags;
+    bool widthStar;
+    bool precStar;
+    int width; // -1 when absent
+    int prec;  // -1 when absent
+    char length[3];
+    char conv;
+    ArgKind kind;
+};
+
+BoundedQueue<Record, kSlots> s_ring;
+std::atomic<uint32_t> s_dropped{0};
+TaskHandle_t s_task = nullptr;
+
+const char*
+levelName(LogLevel level)
+{
+    return (level == LogLevel::ERROR) ? "E"
+        : (level == LogLevel::WARN)   ? "W"
+        : (level == LogLevel::INFO)   ? "I"
+                                      : "D";
+}
+
+void
+emit(LogLevel level, const char* tag, const char* msg)
+{
+    Serial.printf("[%s][%s] %s\n", levelName(level), tag, msg);
+}
+
+// p points just past '%'; returns the first character after the conversion.
+const char*
+parseSpec(const char* p, Spec& s)
+{
+    s = Spec();
+    s.width = -1;
+    s.prec = -1;
+
+    while (*p && strchr("-+ #0", *p) && s.nFlags < sizeof(s.flags) - 1)
+        s.flags[s.nFlags++] = *p++;
+
+    if (*p == '*')
+    {
+        s.widthStar = true;
+        p++;
+    }
+    else if (isdigit((unsigned char)*p))
+    {
+        s.width = 0;
+        while (isdigit((unsigned char)*p))
+            s.width = s.width * 10 + (*p++ - '0');
+    }
+
+    if (*p == '.')
+    {
+        p++;
+        s.prec = 0;
+        if (*p == '*')
+        {
+            s.precStar = true;
+            p++;
+        }
+        else
+        {
+            while (isdigit((unsigned char)*p))
+                s.prec = s.prec * 10 + (*p++ - '0');
+        }
+    }
+
+    size_t n = 0;
+    while (*p && strchr("hlzjtL", *p) && n < sizeof(s.length) - 1)
+        s.length[n++] = *p++;
+
+    s.conv = *p;
+    switch (s.conv)
+    {
+    case '%':
+        s.kind = ArgKind::Literal;
+        break;
+    case 'd':
+    case 'i':
+        s.kind = ArgKind::Signed;
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        s.kind = ArgKind::Unsigned;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        s.kind = s.length[0] == 'L' ? ArgKind::Unsupported : ArgKind::Double;
+        break;
+    case 'c':
+        s.kind = ArgKind::Char;
+        break;
+    case 'p':
+        s.kind = ArgKind::Pointer;
+        break;
+    case 's':
+        s.kind = ArgKind::String;
+        break;
+    default:
+        s.kind = ArgKind::Unsupported;
+        return p;
+    }
+    return p + 1;
+}
+
+class ArgWriter
+{
+  public:
+    explicit ArgWriter(Record& r) : r_(r) {}
+
+    bool
+    put(const void* data, size_t n)
+    {
+        if (r_.len + n > kArgBytes)
+        {
+            r_.truncated = true;
+            return false;
+        }
+        memcpy(r_.args + r_.len, data, n);
+        r_.len += n;
+        return true;
+    }
+
+    // u8 length, then the bytes; cut to whatever room is left.
+    bool
+    putString(const char* str, int maxLen)
+    {
+        if (!str)
+            str = "(null)";
+
+        size_t n = maxLen >= 0 ? strnlen(str, (size_t)maxLen) : strlen(str);
+        if (r_.len + 1u > kArgBytes)
+        {
+            r_.truncated = true;
+            return false;
+        }
+
+        const size_t room = kArgBytes - r_.len - 1;
+        const bool cut = n > room;
+        if (cut)
+            n = room;
+
+        r_.args[r_.len++] = (uint8_t)n;
+        memcpy(r_.args + r_.len, str, n);
+        r_.len += n;
+
+        if (cut)
+            r_.truncated = true;
+        return !cut;
+    }
+
+  private:
+    Record& r_;
+};
+
+class ArgReader
+{
+  public:
+    explicit ArgReader(const Record& r) : r_(r) {}
+
+    template <typename T>
+    bool
+    get(T& out)
+    {
+        if (pos_ + sizeof(T) > r_.len)
+            return false;
+        memcpy(&out, r_.args + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool
+    getString(char* out, size_t cap)
+    {
+        if (pos_ + 1 > r_.len)
+            return false;
+
+        size_t n = r_.args[pos_++];
+        if (pos_ + n > r_.len)
+            return false;
+
+        const size_t copy = n < cap - 1 ? n : cap - 1;
+        memcpy(out, r_.args + pos_, copy);
+        out[copy] = '\0';
+        pos_ += n;
+        return true;
+    }
+
+  private:
+    const Record& r_;
+    size_t pos_ = 0;
+};
+
+void
+capture(Record& r, const char* fmt, va_list args)
+{
+    ArgWriter w(r);
+
+    for (const char* p = fmt; *p;)
+    {
+        if (*p++ != '%')
+            continue;
+
+        Spec s;
+        p = parseSpec(p, s);
+        if (s.kind == ArgKind::Unsupported)
+        {
+            r.truncated = true;
+            return;
+        }
+        if (s.kind == ArgKind::Literal)
+            continue;
+
+        if (s.widthStar)
+        {
+            const int32_t v = va_arg(args, int);
+            if (!w.put(&v, sizeof(v)))
+                return;
+        }
+
+        int32_t prec = s.prec;
+        if (s.precStar)
+        {
+            prec = va_arg(args, int);
+            if (!w.put(&prec, sizeof(prec)))
+                return;
+        }
+
+        const char* len = s.length;
+        bool ok = true;
+        switch (s.kind)
+        {
+        case ArgKind::Signed:
+        {
+            int64_t v;
+            if (!strcmp(len, "ll") || !strcmp(len, "j"))
+                v = va_arg(args, long long);
+            else if (!strcmp(len, "l"))
+                v = va_arg(args, long);
+            else if (!strcmp(len, "z"))
+                v = (int64_t)va_arg(args, size_t);
+            else if (!strcmp(len, "t"))
+                v = va_arg(args, ptrdiff_t);
+            else if (!strcmp(len, "hh"))
+                v = (signed char)va_arg(args, int);
+            else if (!strcmp(len, "h"))
+                v = (short)va_arg(args, int);
+            else
+                v = va_arg(args, int);
+            ok = w.put(&v, sizeof(v));
+            break;
+        }
+        case ArgKind::Unsigned:
+        {
+            uint64_t v;
+            if (!strcmp(len, "ll") || !strcmp(len, "j"))
+                v = va_arg(args, unsigned long long);
+            else if (!strcmp(len, "l"))
+                v = va_arg(args, unsigned long);
+            else if (!strcmp(len, "z"))
+                v = va_arg(args, size_t);
+            else if (!strcmp(len, "t"))
+                v = (uint64_t)va_arg(args, ptrdiff_t);
+            else if (!strcmp(len, "hh"))
+                v = (unsigned char)va_arg(args, unsigned);
+            else if (!strcmp(len, "h"))
+                v = (unsigned short)va_arg(args, unsigned);
+            else
+                v = va_arg(args, unsigned);
+            ok = w.put(&v, sizeof(v));
+            break;
+        }
+        case ArgKind::Double:
+        {
+            const double v = va_arg(args, double);
+            ok = w.put(&v, sizeof(v));
+            break;
+        }
+        case ArgKind::Char:
+        {
+            const int32_t v = va_arg(args, int);
+            ok = w.put(&v, sizeof(v));
+            break;
+        }
+        case ArgKind::Pointer:
+        {
+            const uint64_t v = (uintptr_t)va_arg(args, void*);
+            ok = w.put(&v, sizeof(v));
+            break;
+        }
+        case ArgKind::String:
+            ok = w.putString(va_arg(args, const char*), prec);
+            break;
+        default:
+            break;
+        }
+
+        if (!ok)
+            return;
+    }
+}
+
+// Rebuilds the conversion with '*' resolved and a length modifier that
+// matches how the argument was stored.
+void
+buildSpec(char* out, size_t cap, const Spec& s, int width, int prec, const char* length)
+{
+    int n = snprintf(out, cap, "%%%s", s.flags);
+    if (s.widthStar || width >= 0)
+        n += snprintf(out + n, cap - n, "%d", width);
+    if (prec >= 0)
+        n += snprintf(out + n, cap - n, ".%d", prec);
+    snprintf(out + n, cap - n, "%s%c", length, s.conv);
+}
+
+void
+render(const Record& r, char* out, size_t cap)
+{
+    ArgReader in(r);
+    size_t pos = 0;
+    bool complete = true;
+
+    auto advance = [&](int n) {
+        if (n > 0)
+            pos += (size_t)n < cap - pos ? (size_t)n : cap - pos - 1;
+    };
+
+    const char* p = r.fmt;
+    while (*p && pos < cap - 1)
+    {
+        if (*p != '%')
+        {
+            out[pos++] = *p++;
+            continue;
+        }
+
+        Spec s;
+        p = parseSpec(p + 1, s);
+        if (s.kind == ArgKind::Literal)
+        {
+            out[pos++] = '%';
+            continue;
+        }
+        if (s.kind == ArgKind::Unsupported)
+        {
+            complete = false;
+            break;
+        }
+
+        int32_t width = s.width;
+        int32_t prec = s.prec;
+        if ((s.widthStar && !in.get(width)) || (s.precStar && !in.get(prec)))
+        {
+            complete = false;
+            break;
+        }
+
+        char spec[24];
+        bool ok = true;
+        switch (s.kind)
+        {
+        case ArgKind::Signed:
+        {
+            int64_t v;
+            if ((ok = in.get(v)))
+            {
+                buildSpec(spec, sizeof(spec), s, width, prec, "ll");
+                advance(snprintf(out + pos, cap - pos, spec, (long long)v));
+            }
+            break;
+        }
+        case ArgKind::Unsigned:
+        {
+            uint64_t v;
+            if ((ok = in.get(v)))
+            {
+                buildSpec(spec, sizeof(spec), s, width, prec, "ll");
+                advance(snprintf(out + pos, cap - pos, spec, (unsigned long long)v));
+            }
+            break;
+        }
+        case ArgKind::Double:
+        {
+            double v;
+            if ((ok = in.get(v)))
+            {
+                buildSpec(spec, sizeof(spec), s, width, prec, "");
+                advance(snprintf(out + pos, cap - pos, spec, v));
+            }
+            break;
+        }
+        case ArgKind::Char:
+        {
+            int32_t v;
+            if ((ok = in.get(v)))
+            {
+                buildSpec(spec, sizeof(spec), s, width, -1, "");
+                advance(snprintf(out + pos, cap - pos, spec, (int)v));
+            }
+            break;
+        }
+        case ArgKind::Pointer:
+        {
+            uint64_t v;
+            if ((ok = in.get(v)))
+            {
+                buildSpec(spec, sizeof(spec), s, width, -1, "");
+                advance(snprintf(out + pos, cap - pos, spec, (void*)(uintptr_t)v));
+            }
+            break;
+        }
+        case ArgKind::String:
+        {
+            char str[kArgBytes];
+            if ((ok = in.getString(str, sizeof(str))))
+            {
+                buildSpec(spec, sizeof(spec), s, width, -1, "");
+                advance(snprintf(out + pos, cap - pos, spec, str));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (!ok)
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    if ((r.truncated || !complete) && pos + 3 < cap)
+    {
+        memcpy(out + pos, "...", 3);
+        pos += 3;
+    }
+    out[pos] = '\0';
+}
+} // namespace
 
 LogLevel Logger::level_ = LogLevel::INFO;
 
@@ -8,6 +500,17 @@ void
 Logger::begin(uint32_t baud)
 {
     Serial.begin(baud);
+
+    if (s_task)
+        return;
+
+    if (xTaskCreate(
+            &Logger::taskMain_, "log", kTaskStackBytes, nullptr, kTaskPriority, &s_task
+        ) != pdPASS)
+    {
+        s_task = nullptr;
+        error("LOG", "log task not started, logging synchronously");
+    }
 }
 
 void
@@ -16,21 +519,75 @@ Logger::setLevel(LogLevel level)
     level_ = level;
 }
 
+uint32_t
+Logger::dropped()
+{
+    return s_dropped.load(std::memory_order_relaxed);
+}
+
 void
 Logger::log(LogLevel level, const char* tag, const char* fmt, va_list args)
 {
     if (level > level_)
         return;
 
-    char buffer[256];
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    if (!s_task)
+    {
+        char buffer[kLineBytes];
+        vsnprintf(buffer, sizeof(buffer), fmt, args);
+        emit(level, tag, buffer);
+        return;
+    }
+
+    uint32_t ticket;
+    Record* r = s_ring.tryClaim(ticket);
+    if (!r)
+    {
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    r->tag = tag;
+    r->fmt = fmt;
+    r->level = level;
+    r->len = 0;
+    r->truncated = false;
+    capture(*r, fmt, args);
+    s_ring.publish(ticket);
+}
+
+void
+Logger::taskMain_(void*)
+{
+    char line[kLineBytes];
+    uint32_t reported = 0;
+
+    for (;;)
+    {
+        uint32_t ticket;
+        while (const Record* r = s_ring.tryPeek(ticket))
+        {
+            render(*r, line, sizeof(line));
+            const LogLevel level = r->level;
+            const char* tag = r->tag;
+            s_ring.release(ticket);
+
+            emit(level, tag, line);
+        }
 
-    const char* lvl = (level == LogLevel::ERROR) ? "E"
-        : (level == LogLevel::WARN)              ? "W"
-        : (level == LogLevel::INFO)              ? "I"
-                                                 : "D";
+        const uint32_t dropped = s_dropped.load(std::memory_order_relaxed);
+        if (dropped != reported)
+        {
+            snprintf(
+                line, sizeof(line), "%u messages dropped (%u total)",
+                (unsigned)(dropped - reported), (unsigned)dropped
+            );
+            emit(LogLevel::WARN, "LOG", line);
+            reported = dropped;
+        }
 
-    Serial.printf("[%s][%s] %s\n", lvl, tag, buffer);
+        vTaskDelay(kTaskPeriod);
+    }
 }
 
 #define LOG_IMPL(fn, lvl)                                                                          \
@@ -1,6 +1,39 @@
 #pragma once
 #include <Arduino.h>
 
+// Compile-time filtering. LOG_MAX_LEVEL caps the whole build (set it from
+// build_flags); a file may lower its own cap by defining SL_LOG_FILE_LEVEL
+// before its first #include. Calls above either cap are removed together
+// with the evaluation of their arguments, so prefer the LOG_* macros to the
+// Logger functions. Logger::setLevel() still filters at run time below them.
+#define LOG_LEVEL_NONE (-1)
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef SL_LOG_FILE_LEVEL
+#define SL_LOG_FILE_LEVEL LOG_MAX_LEVEL
+#endif
+
+#define LOG_ENABLED(level) ((level) <= LOG_MAX_LEVEL && (level) <= SL_LOG_FILE_LEVEL)
+
+#define LOG_AT_(level, fn, tag, ...)                                                               \
+    do                                                                                             \
+    {                                                                                              \
+        if (LOG_ENABLED(level))                                                                    \
+            Logger::fn(tag, __VA_ARGS__);                                                          \
+    } while (0)
+
+#define LOG_E(tag, ...) LOG_AT_(LOG_LEVEL_ERROR, error, tag, __VA_ARGS__)
+#define LOG_W(tag, ...) LOG_AT_(LOG_LEVEL_WARN, warn, tag, __VA_ARGS__)
+#define LOG_I(tag, ...) LOG_AT_(LOG_LEVEL_INFO, info, tag, __VA_ARGS__)
+#define LOG_D(tag, ...) LOG_AT_(LOG_LEVEL_DEBUG, debug, tag, __VA_ARGS__)
+
 enum class LogLevel
 {
     ERROR = 0,
@@ -9,6 +42,14 @@ enum class LogLevel
     DEBUG
 };
 
+// Callers only capture their arguments into a lock-free ring; a low-priority
+// task formats and writes them to Serial. Because formatting is deferred,
+// tag and fmt must be string literals (or otherwise never freed); %s
+// arguments are copied. A full ring drops the message rather than blocking,
+// and the drops are counted and reported by the drain task.
+//
+// Before begin() starts the task, or if it could not be started, messages
+// are formatted and written synchronously as before.
 class Logger
 {
   public:
@@ -30,8 +71,15 @@ class Logger
     static void
     setLevel(LogLevel level);
 
+    // Messages lost to a full ring since boot.
+    static uint32_t
+    dropped();
+
   private:
     static LogLevel level_;
     static void
     log(LogLevel level, const char* tag, const char* fmt, va_list args);
+
+    static void
+    taskMain_(void*);
 };
@@ -0,0 +1,87 @@
+#include "utils/Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include "utils/Logger.h"
+
+namespace
+{
+constexpr size_t kSections = (size_t)ProfileSection::Count;
+
+struct Stat
+{
+    LatencyHistogram hist;
+    uint32_t minUs = UINT32_MAX;
+    uint64_t sumUs = 0;
+};
+
+Stat s_stats[kSections];
+
+const char* const kNames[kSections] = {
+    "commands", "provision", "network", "door",  "keypad",      "rfid",
+    "publish",  "expiry",    "health",  "flash", "mqttPublish",
+};
+} // namespace
+
+void
+Profiler::record(ProfileSection section, uint32_t us)
+{
+    Stat& s = s_stats[(size_t)section];
+    s.hist.record(us);
+    s.sumUs += us;
+    if (us < s.minUs)
+        s.minUs = us;
+}
+
+void
+Profiler::reset()
+{
+    for (Stat& s : s_stats)
+        s = Stat();
+}
+
+void
+Profiler::toJson(JsonArray out)
+{
+    for (size_t i = 0; i < kSections; ++i)
+    {
+        const Stat& s = s_stats[i];
+        const uint32_t n = s.hist.total();
+        if (n == 0)
+            continue;
+
+        JsonObject o = out.createNestedObject();
+        o["name"] = kNames[i];
+        o["n"] = n;
+        o["minUs"] = s.minUs;
+        o["avgUs"] = (uint32_t)(s.sumUs / n);
+        o["p99Us"] = s.hist.percentileUs(99);
+        o["maxUs"] = s.hist.maxUs();
+    }
+}
+
+void
+Profiler::logSummary()
+{
+    for (size_t i = 0; i < kSections; ++i)
+    {
+        const Stat& s = s_stats[i];
+        const uint32_t n = s.hist.total();
+        if (n == 0)
+            continue;
+
+        LOG_I(
+            "PROFILE", "%-12s n=%u min=%u avg=%u p99<=%u max=%u us", kNames[i], (unsigned)n,
+            (unsigned)s.minUs, (unsigned)(s.sumUs / n), (unsigned)s.hist.percentileUs(99),
+            (unsigned)s.hist.maxUs()
+        );
+    }
+}
+
+const char*
+Profiler::name(ProfileSection section)
+{
+    return kNames[(size_t)section];
+}
+
+#endif
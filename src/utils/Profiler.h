@@ -0,0 +1,76 @@
+#pragma once
+#include <Arduino.h>
+
+// Per-section call timing for the app task. Built only with
+// -DENABLE_PROFILER; otherwise PROFILE_SCOPE expands to nothing and the
+// class is not compiled in.
+//
+// Sections are recorded from the app task only; nothing here is locked.
+
+enum class ProfileSection : uint8_t
+{
+    Commands,
+    Provision,
+    Network,
+    Door,
+    Keypad,
+    Rfid,
+    Publish,
+    Expiry,
+    Health,
+    FlashWrite,
+    MqttPublish,
+    Count
+};
+
+#ifdef ENABLE_PROFILER
+
+#include "utils/LatencyHistogram.h"
+
+#include <ArduinoJson.h>
+
+class Profiler
+{
+  public:
+    static void
+    record(ProfileSection section, uint32_t us);
+
+    static void
+    reset();
+
+    // One entry per section that has samples.
+    static void
+    toJson(JsonArray out);
+
+    static void
+    logSummary();
+
+    static const char*
+    name(ProfileSection section);
+};
+
+class ProfileScope
+{
+  public:
+    explicit ProfileScope(ProfileSection section) : section_(section), startUs_(micros()) {}
+
+    ~ProfileScope()
+    {
+        Profiler::record(section_, micros() - startUs_);
+    }
+
+  private:
+    ProfileSection section_;
+    uint32_t startUs_;
+};
+
+#define PROFILE_SCOPE(section) ProfileScope profileScope_(section)
+
+#else
+
+#define PROFILE_SCOPE(section) \
+    do                         \
+    {                          \
+    } while (0)
+
+#endif
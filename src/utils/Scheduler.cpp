@@ -0,0 +1,127 @@
+#include "utils/Scheduler.h"
+
+#include "utils/Logger.h"
+
+TaskHandle_t Scheduler::s_task_ = nullptr;
+std::atomic<uint32_t> Scheduler::s_pending_{0};
+
+void
+Scheduler::begin()
+{
+    s_task_ = xTaskGetCurrentTaskHandle();
+}
+
+bool
+Scheduler::every(const char* name, uint32_t periodMs, Fn fn)
+{
+    return add_(name, periodMs ? periodMs : 1, 0, fn);
+}
+
+bool
+Scheduler::on(const char* name, uint32_t events, Fn fn)
+{
+    return add_(name, 0, events, fn);
+}
+
+bool
+Scheduler::paced(const char* name, PacedFn fn)
+{
+    return add_(name, 1, 0, nullptr, fn);
+}
+
+bool
+Scheduler::add_(const char* name, uint32_t periodMs, uint32_t events, Fn fn, PacedFn pacedFn)
+{
+    if (count_ >= kMaxTasks)
+    {
+        LOG_E("SCHED", "no slot for task %s", name);
+        return false;
+    }
+
+    tasks_[count_++] = Task{name, fn, pacedFn, periodMs, events, (uint32_t)millis()};
+    return true;
+}
+
+void
+Scheduler::runDue()
+{
+    const uint32_t events = s_pending_.exchange(0, std::memory_order_acq_rel);
+    const uint32_t now = millis();
+
+    for (size_t i = 0; i < count_; ++i)
+    {
+        Task& t = tasks_[i];
+
+        if (t.periodMs == 0)
+        {
+            if (events & t.events)
+                t.fn();
+            continue;
+        }
+
+        if ((int32_t)(now - t.dueMs) < 0)
+            continue;
+
+        if (t.pacedFn)
+        {
+            const uint32_t delayMs = t.pacedFn();
+            t.periodMs = delayMs ? delayMs : 1;
+            t.dueMs = millis() + t.periodMs;
+            continue;
+        }
+
+        t.fn();
+
+        // Keep the cadence, but do not replay missed periods after a stall.
+        t.dueMs += t.periodMs;
+        if ((int32_t)(now - t.dueMs) >= 0)
+            t.dueMs = now + t.periodMs;
+    }
+}
+
+void
+Scheduler::sleep()
+{
+    if (s_pending_.load(std::memory_order_acquire) != 0)
+        return;
+
+    const uint32_t now = millis();
+    uint32_t sleepMs = kMaxSleepMs;
+    for (size_t i = 0; i < count_; ++i)
+    {
+        const Task& t = tasks_[i];
+        if (t.periodMs == 0)
+            continue;
+
+        const int32_t left = (int32_t)(t.dueMs - now);
+        if (left <= 0)
+            return;
+        if ((uint32_t)left < sleepMs)
+            sleepMs = (uint32_t)left;
+    }
+
+    // A notify() between the check above and here leaves the notification
+    // count set, so this returns at once rather than missing it.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs));
+}
+
+void
+Scheduler::notify(uint32_t events)
+{
+    s_pending_.fetch_or(events, std::memory_order_release);
+    if (s_task_)
+        xTaskNotifyGive(s_task_);
+}
+
+void IRAM_ATTR
+Scheduler::notifyFromIsr(uint32_t events)
+{
+    s_pending_.fetch_or(events, std::memory_order_release);
+    if (!s_task_)
+        return;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_task_, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+
+// Reasons to wake the app task before its next deadline.
+namespace WakeEvent
+{
+constexpr uint32_t KEY = 1u << 0;     // keypad scanner queued a press
+constexpr uint32_t RFID = 1u << 1;    // reader IRQ fired
+constexpr uint32_t NETWORK = 1u << 2; // inbound MQTT message or new session
+constexpr uint32_t COMMAND = 1u << 3; // CommandQueue got a command
+} // namespace WakeEvent
+
+// Cooperative scheduler for the app task. Services register periodic tasks
+// and event handlers; runDue() runs whatever is due and sleep() blocks on the
+// task notification until the earliest deadline or an event, so an idle
+// lock leaves the CPU to the idle task instead of spinning through loop().
+//
+// Tasks run in registration order within a pass, on the app task only.
+class Scheduler
+{
+  public:
+    using Fn = std::function<void()>;
+    // Returns how many ms until the task next wants to run.
+    using PacedFn = std::function<uint32_t()>;
+
+    static constexpr size_t kMaxTasks = 16;
+
+    // Longest sleep, so the watchdog is fed even with nothing due.
+    static constexpr uint32_t kMaxSleepMs = 1000;
+
+    // Must be called from the task that will call sleep().
+    void
+    begin();
+
+    bool
+    every(const char* name, uint32_t periodMs, Fn fn);
+
+    // A periodic task that picks its own next deadline each run, for work
+    // whose cadence changes with its state.
+    bool
+    paced(const char* name, PacedFn fn);
+
+    // Runs `fn` in the pass after any of `events` is raised.
+    bool
+    on(const char* name, uint32_t events, Fn fn);
+
+    // Runs the handlers for pending events and every task that is due.
+    void
+    runDue();
+
+    // Blocks until the next deadline or event; returns at once if one is
+    // already pending.
+    void
+    sleep();
+
+    // Safe from any task.
+    static void
+    notify(uint32_t events);
+
+    static void IRAM_ATTR
+    notifyFromIsr(uint32_t events);
+
+  private:
+    struct Task
+    {
+        const char* name;
+        Fn fn;
+        PacedFn pacedFn;   // set for paced() tasks; periodMs is then the last delay
+        uint32_t periodMs; // 0 = event handler
+        uint32_t events;
+        uint32_t dueMs;
+    };
+
+    bool
+    add_(const char* name, uint32_t periodMs, uint32_t events, Fn fn, PacedFn pacedFn = nullptr);
+
+    Task tasks_[kMaxTasks];
+    size_t count_{0};
+
+    static TaskHandle_t s_task_;
+    static std::atomic<uint32_t> s_pending_;
+};
@@ -5,29 +5,35 @@ class SecureCompare
 {
   public:
     static bool
-    safeEquals(const String& a, const String& b)
+    safeEquals(const char* a, size_t aLen, const char* b, size_t bLen)
     {
-        const size_t maxLen = max(a.length(), b.length());
+        const size_t maxLen = max(aLen, bLen);
 
         volatile uint8_t result = 0;
 
         for (size_t i = 0; i < maxLen; i++)
         {
-            const uint8_t charA = (i < a.length()) ? a[i] : 0;
-            const uint8_t charB = (i < b.length()) ? b[i] : 0;
+            const uint8_t charA = (i < aLen) ? a[i] : 0;
+            const uint8_t charB = (i < bLen) ? b[i] : 0;
             result |= (uint8_t)(charA ^ charB);
         }
 
-        result |= (uint8_t)(a.length() ^ b.length());
+        result |= (uint8_t)(aLen ^ bLen);
         return result == 0;
     }
 
+    static bool
+    safeEquals(const String& a, const String& b)
+    {
+        return safeEquals(a.c_str(), a.length(), b.c_str(), b.length());
+    }
+
     static bool
     safeEquals(const char* a, const char* b)
     {
         if (!a || !b)
             return false;
 
-        return safeEquals(String(a), String(b));
+        return safeEquals(a, strlen(a), b, strlen(b));
     }
 };
@@ -0,0 +1,139 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Bounded lock-free ring of variable-length frames for exactly one producer
+// task and one consumer task. Each frame is a u16 length followed by its
+// bytes; frames may wrap around the end of the buffer.
+//
+// Producer: beginWrite(len), write(...) until len bytes, endWrite().
+// Consumer: len = beginRead(), read(...) any amount, endRead().
+// Nothing becomes visible to the other side before endWrite()/endRead().
+template <size_t N>
+class SpscByteRing
+{
+    static_assert((N & (N - 1)) == 0, "SpscByteRing size must be a power of two");
+    static_assert(N <= 0x8000, "SpscByteRing frames use a u16 length");
+
+  public:
+    static constexpr size_t FRAME_HEADER = 2;
+
+    // Largest frame that would fit right now.
+    size_t
+    freeSpace() const
+    {
+        const uint32_t used = head_.load(std::memory_order_relaxed) -
+            tail_.load(std::memory_order_acquire);
+        const size_t free = N - used;
+        return free > FRAME_HEADER ? free - FRAME_HEADER : 0;
+    }
+
+    bool
+    beginWrite(size_t len)
+    {
+        if (len == 0 || len > freeSpace())
+            return false;
+
+        wpos_ = head_.load(std::memory_order_relaxed);
+        wend_ = wpos_ + FRAME_HEADER + len;
+
+        const uint8_t hdr[FRAME_HEADER] = {(uint8_t)len, (uint8_t)(len >> 8)};
+        copyIn_(hdr, sizeof(hdr));
+        return true;
+    }
+
+    // Writes past the reserved length are dropped.
+    void
+    write(const void* data, size_t n)
+    {
+        const size_t room = wend_ - wpos_;
+        copyIn_((const uint8_t*)data, n < room ? n : room);
+    }
+
+    // Publishes the frame; false (and nothing published) if it is short.
+    bool
+    endWrite()
+    {
+        if (wpos_ != wend_)
+            return false;
+
+        head_.store(wend_, std::memory_order_release);
+        return true;
+    }
+
+    bool
+    push(const void* data, size_t len)
+    {
+        if (!beginWrite(len))
+            return false;
+
+        write(data, len);
+        return endWrite();
+    }
+
+    // Length of the next frame, 0 when empty.
+    size_t
+    beginRead()
+    {
+        rpos_ = tail_.load(std::memory_order_relaxed);
+        if (rpos_ == head_.load(std::memory_order_acquire))
+            return 0;
+
+        uint8_t hdr[FRAME_HEADER];
+        copyOut_(hdr, sizeof(hdr));
+
+        const size_t len = hdr[0] | (hdr[1] << 8);
+        rend_ = rpos_ + len;
+        return len;
+    }
+
+    size_t
+    read(void* dst, size_t n)
+    {
+        const size_t left = rend_ - rpos_;
+        if (n > left)
+            n = left;
+
+        copyOut_((uint8_t*)dst, n);
+        return n;
+    }
+
+    // Releases the frame, including any bytes not read.
+    void
+    endRead()
+    {
+        tail_.store(rend_, std::memory_order_release);
+    }
+
+  private:
+    void
+    copyIn_(const uint8_t* src, size_t n)
+    {
+        const size_t at = wpos_ & (N - 1);
+        const size_t first = n < N - at ? n : N - at;
+        memcpy(buf_ + at, src, first);
+        memcpy(buf_, src + first, n - first);
+        wpos_ += n;
+    }
+
+    void
+    copyOut_(uint8_t* dst, size_t n)
+    {
+        const size_t at = rpos_ & (N - 1);
+        const size_t first = n < N - at ? n : N - at;
+        memcpy(dst, buf_ + at, first);
+        memcpy(dst + first, buf_, n - first);
+        rpos_ += n;
+    }
+
+    uint8_t buf_[N];
+
+    // Free-running byte counters; only the low bits index buf_.
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+
+    uint32_t wpos_{0}; // producer-only
+    uint32_t wend_{0};
+    uint32_t rpos_{0}; // consumer-only
+    uint32_t rend_{0};
+};
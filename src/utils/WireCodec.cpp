@@ -0,0 +1,64 @@
+#include "utils/WireCodec.h"
+
+WireFormat
+WireCodec::detect(const uint8_t* data, size_t len)
+{
+    if (len == 0)
+        return WireFormat::Json;
+
+    const uint8_t b = data[0];
+    if ((b >= 0x80 && b <= 0x8f) || b == 0xde || b == 0xdf)
+        return WireFormat::MsgPack;
+
+    return WireFormat::Json;
+}
+
+bool
+WireCodec::decode(const uint8_t* data, size_t len, JsonDocument& doc)
+{
+    // Read-only input: ArduinoJson copies strings into `doc`.
+    const char* in = (const char*)data;
+
+    const DeserializationError err = detect(data, len) == WireFormat::MsgPack
+        ? deserializeMsgPack(doc, in, len)
+        : deserializeJson(doc, in, len);
+    return !err;
+}
+
+size_t
+WireCodec::measure(const JsonDocument& doc, WireFormat format)
+{
+    return format == WireFormat::MsgPack ? measureMsgPack(doc) : measureJson(doc);
+}
+
+size_t
+WireCodec::encode(const JsonDocument& doc, Print& out, WireFormat format)
+{
+    return format == WireFormat::MsgPack ? serializeMsgPack(doc, out) : serializeJson(doc, out);
+}
+
+const char*
+WireCodec::name(WireFormat format)
+{
+    return format == WireFormat::MsgPack ? "msgpack" : "json";
+}
+
+bool
+WireCodec::parse(const char* name, WireFormat& out)
+{
+    if (!name)
+        return false;
+
+    if (strcmp(name, "json") == 0)
+    {
+        out = WireFormat::Json;
+        return true;
+    }
+
+    if (strcmp(name, "msgpack") == 0)
+    {
+        out = WireFormat::MsgPack;
+        return true;
+    }
+    return false;
+}
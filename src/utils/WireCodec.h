@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Payload encodings for MQTT. Both carry the same document schema; MsgPack
+// trades readability for smaller payloads and cheaper parsing.
+enum class WireFormat : uint8_t
+{
+    Json = 0,
+    MsgPack = 1
+};
+
+class WireCodec
+{
+  public:
+    // Every payload we accept is an object, so the first byte tells the
+    // encodings apart: a MessagePack map (0x80-0x8f, 0xde, 0xdf) or JSON.
+    static WireFormat
+    detect(const uint8_t* data, size_t len);
+
+    // Decodes either encoding, whichever the payload turns out to be.
+    static bool
+    decode(const uint8_t* data, size_t len, JsonDocument& doc);
+
+    static size_t
+    measure(const JsonDocument& doc, WireFormat format);
+
+    static size_t
+    encode(const JsonDocument& doc, Print& out, WireFormat format);
+
+    static const char*
+    name(WireFormat format);
+
+    // Accepts the names returned by name(); false leaves `out` untouched.
+    static bool
+    parse(const char* name, WireFormat& out);
+};
@@ -0,0 +1,270 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace
+{
+const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+
+std::mutex s_serialMutex;
+std::string s_serial;
+
+std::mt19937 s_random(1);
+
+uint8_t s_pins[64];
+
+constexpr uint32_t kHeapSize = 320 * 1024;
+constexpr uint32_t kFreeHeap = 200 * 1024;
+constexpr uint32_t kMaxAlloc = 110 * 1024;
+} // namespace
+
+size_t
+Print::printf(const char* fmt, ...)
+{
+    char small[128];
+    va_list args;
+
+    va_start(args, fmt);
+    const int n = vsnprintf(small, sizeof(small), fmt, args);
+    va_end(args);
+    if (n < 0)
+        return 0;
+
+    if ((size_t)n < sizeof(small))
+        return write((const uint8_t*)small, n);
+
+    std::string big(n + 1, '\0');
+    va_start(args, fmt);
+    vsnprintf(&big[0], big.size(), fmt, args);
+    va_end(args);
+    return write((const uint8_t*)big.data(), n);
+}
+
+namespace
+{
+// Naive restart is enough for the JSON keys and separators searched for.
+bool
+advanceMatch(const char* target, size_t len, size_t& matched, char c)
+{
+    if (len == 0)
+        return false;
+
+    if (c == target[matched])
+        matched++;
+    else
+        matched = c == target[0] ? 1 : 0;
+
+    return matched == len;
+}
+} // namespace
+
+bool
+Stream::find(const char* target)
+{
+    return findUntil(target, "");
+}
+
+bool
+Stream::findUntil(const char* target, const char* terminator)
+{
+    const size_t targetLen = strlen(target);
+    const size_t termLen = strlen(terminator);
+    if (targetLen == 0)
+        return true;
+
+    size_t targetMatched = 0;
+    size_t termMatched = 0;
+    for (int c; (c = read()) >= 0;)
+    {
+        if (advanceMatch(target, targetLen, targetMatched, (char)c))
+            return true;
+        if (advanceMatch(terminator, termLen, termMatched, (char)c))
+            return false;
+    }
+    return false;
+}
+
+void
+String::replace(const String& find, const String& with)
+{
+    if (find.s_.empty())
+        return;
+
+    for (size_t p = s_.find(find.s_); p != std::string::npos;
+         p = s_.find(find.s_, p + with.s_.size()))
+        s_.replace(p, find.s_.size(), with.s_);
+}
+
+void
+String::toUpperCase()
+{
+    for (char& c : s_)
+        c = (char)toupper((unsigned char)c);
+}
+
+void
+String::toLowerCase()
+{
+    for (char& c : s_)
+        c = (char)tolower((unsigned char)c);
+}
+
+long
+String::toInt() const
+{
+    return strtol(s_.c_str(), nullptr, 10);
+}
+
+unsigned long
+millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - s_start
+    )
+        .count();
+}
+
+unsigned long
+micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - s_start
+    )
+        .count();
+}
+
+void
+delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void
+delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void
+yield()
+{
+    std::this_thread::yield();
+}
+
+uint32_t
+esp_random()
+{
+    return (uint32_t)s_random();
+}
+
+long
+random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+        return howsmall;
+    return howsmall + (long)(esp_random() % (uint32_t)(howbig - howsmall));
+}
+
+void
+pinMode(uint8_t, uint8_t)
+{
+}
+
+void
+digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < sizeof(s_pins))
+        s_pins[pin] = val;
+}
+
+int
+digitalRead(uint8_t pin)
+{
+    return pin < sizeof(s_pins) ? s_pins[pin] : LOW;
+}
+
+void
+HardwareSerial::begin(unsigned long)
+{
+}
+
+size_t
+HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t
+HardwareSerial::write(const uint8_t* buf, size_t n)
+{
+    std::lock_guard<std::mutex> lock(s_serialMutex);
+    s_serial.append((const char*)buf, n);
+    return n;
+}
+
+uint32_t
+EspClass::getHeapSize()
+{
+    return kHeapSize;
+}
+
+uint32_t
+EspClass::getFreeHeap()
+{
+    return kFreeHeap;
+}
+
+uint32_t
+EspClass::getMinFreeHeap()
+{
+    return kFreeHeap;
+}
+
+uint32_t
+EspClass::getMaxAllocHeap()
+{
+    return kMaxAlloc;
+}
+
+BaseType_t
+xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle)
+{
+    std::thread t(fn, arg);
+    if (handle)
+        *handle = (TaskHandle_t)(uintptr_t)std::hash<std::thread::id>()(t.get_id());
+    t.detach();
+    return pdPASS;
+}
+
+void
+vTaskDelay(TickType_t ticks)
+{
+    delay(ticks * portTICK_PERIOD_MS);
+}
+
+TaskHandle_t
+xTaskGetCurrentTaskHandle()
+{
+    return (TaskHandle_t)(uintptr_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+std::string
+ArduinoShim::takeSerial()
+{
+    std::lock_guard<std::mutex> lock(s_serialMutex);
+    std::string out;
+    out.swap(s_serial);
+    return out;
+}
+
+void
+ArduinoShim::seedRandom(uint32_t seed)
+{
+    s_random.seed(seed);
+}
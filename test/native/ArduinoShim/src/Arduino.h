@@ -0,0 +1,164 @@
+#pragma once
+// Host stand-in for the ESP32 Arduino core, for the native unit tests only.
+// It covers what the storage and utility code under test touches and no
+// more; anything hardware-facing is deliberately missing so that pulling it
+// into a test fails to compile. The exception is plain GPIO (and Servo.h),
+// inert, so the door module links into the MQTT service tests.
+
+#include "Stream.h"
+#include "WString.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define IRAM_ATTR
+
+unsigned long
+millis();
+
+unsigned long
+micros();
+
+void
+delay(unsigned long ms);
+
+void
+delayMicroseconds(unsigned int us);
+
+void
+yield();
+
+// Deterministic, so failing tests reproduce; see ArduinoShim::seedRandom().
+uint32_t
+esp_random();
+
+long
+random(long howsmall, long howbig);
+
+// Levels are only remembered: a pin reads back what was last written, LOW
+// before that.
+void
+pinMode(uint8_t pin, uint8_t mode);
+
+void
+digitalWrite(uint8_t pin, uint8_t val);
+
+int
+digitalRead(uint8_t pin);
+
+inline bool
+isSpace(int c)
+{
+    return isspace(c) != 0;
+}
+
+class HardwareSerial : public Stream
+{
+  public:
+    void
+    begin(unsigned long baud);
+
+    size_t
+    write(uint8_t c) override;
+
+    size_t
+    write(const uint8_t* buf, size_t n) override;
+
+    using Print::write;
+
+    int
+    available() override
+    {
+        return 0;
+    }
+
+    int
+    read() override
+    {
+        return -1;
+    }
+
+    int
+    peek() override
+    {
+        return -1;
+    }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+  public:
+    uint32_t
+    getHeapSize();
+
+    uint32_t
+    getFreeHeap();
+
+    uint32_t
+    getMinFreeHeap();
+
+    uint32_t
+    getMaxAllocHeap();
+};
+
+extern EspClass ESP;
+
+// FreeRTOS, as far as the logger's drain task needs it. Tasks are detached
+// host threads and a tick is one millisecond.
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+
+BaseType_t
+xTaskCreate(
+    TaskFunction_t fn, const char* name, uint32_t stackBytes, void* arg, UBaseType_t priority,
+    TaskHandle_t* handle
+);
+
+void
+vTaskDelay(TickType_t ticks);
+
+TaskHandle_t
+xTaskGetCurrentTaskHandle();
+
+// Test-side controls with no Arduino counterpart.
+namespace ArduinoShim
+{
+// Everything written to Serial since the last call, which clears it.
+std::string
+takeSerial();
+
+void
+seedRandom(uint32_t seed);
+} // namespace ArduinoShim
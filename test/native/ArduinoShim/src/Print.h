@@ -0,0 +1,98 @@
+#pragma once
+#include "WString.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+class Print
+{
+  public:
+    virtual ~Print() = default;
+
+    virtual size_t
+    write(uint8_t c) = 0;
+
+    virtual size_t
+    write(const uint8_t* buf, size_t n)
+    {
+        size_t i = 0;
+        while (i < n && write(buf[i]) == 1)
+            i++;
+        return i;
+    }
+
+    size_t
+    write(const char* s)
+    {
+        return write((const uint8_t*)s, strlen(s));
+    }
+
+    size_t
+    write(const char* s, size_t n)
+    {
+        return write((const uint8_t*)s, n);
+    }
+
+    size_t
+    print(const char* s)
+    {
+        return write(s);
+    }
+
+    size_t
+    print(const String& s)
+    {
+        return write(s.c_str(), s.length());
+    }
+
+    size_t
+    print(char c)
+    {
+        return write((uint8_t)c);
+    }
+
+    size_t
+    print(long v)
+    {
+        return printf("%ld", v);
+    }
+
+    size_t
+    print(unsigned long v)
+    {
+        return printf("%lu", v);
+    }
+
+    size_t
+    print(int v)
+    {
+        return print((long)v);
+    }
+
+    size_t
+    print(unsigned v)
+    {
+        return print((unsigned long)v);
+    }
+
+    template <typename T>
+    size_t
+    println(const T& v)
+    {
+        return print(v) + println();
+    }
+
+    size_t
+    println()
+    {
+        return write("\r\n");
+    }
+
+    size_t
+    printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    virtual void
+    flush()
+    {
+    }
+};
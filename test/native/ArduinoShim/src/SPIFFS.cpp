@@ -0,0 +1,168 @@
+#include "SPIFFS.h"
+
+SPIFFSFS SPIFFS;
+
+namespace
+{
+constexpr size_t kTotalBytes = 1408 * 1024;
+} // namespace
+
+size_t
+File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t
+File::write(const uint8_t* buf, size_t n)
+{
+    if (!data_ || !writable_)
+        return 0;
+
+    data_->append((const char*)buf, n);
+    pos_ = data_->size();
+    return n;
+}
+
+int
+File::available()
+{
+    return data_ ? (int)(data_->size() - pos_) : 0;
+}
+
+int
+File::read()
+{
+    if (!data_ || pos_ >= data_->size())
+        return -1;
+    return (uint8_t)(*data_)[pos_++];
+}
+
+int
+File::peek()
+{
+    if (!data_ || pos_ >= data_->size())
+        return -1;
+    return (uint8_t)(*data_)[pos_];
+}
+
+size_t
+File::read(uint8_t* buf, size_t n)
+{
+    return readBytes(buf, n);
+}
+
+bool
+File::seek(uint32_t pos)
+{
+    if (!data_ || pos > data_->size())
+        return false;
+
+    pos_ = pos;
+    return true;
+}
+
+size_t
+File::position() const
+{
+    return pos_;
+}
+
+size_t
+File::size() const
+{
+    return data_ ? data_->size() : 0;
+}
+
+void
+File::close()
+{
+    data_.reset();
+    pos_ = 0;
+}
+
+bool
+SPIFFSFS::begin(bool)
+{
+    return true;
+}
+
+bool
+SPIFFSFS::format()
+{
+    files_.clear();
+    return true;
+}
+
+bool
+SPIFFSFS::exists(const char* path)
+{
+    return files_.count(path) > 0;
+}
+
+File
+SPIFFSFS::open(const char* path, const char* mode)
+{
+    File f;
+    auto it = files_.find(path);
+
+    if (mode[0] == 'r')
+    {
+        if (it == files_.end())
+            return f;
+        f.data_ = it->second;
+        return f;
+    }
+
+    if (mode[0] == 'w' || it == files_.end())
+        it = files_.insert(std::make_pair(std::string(path), std::make_shared<std::string>())).first;
+    if (mode[0] == 'w')
+        it->second = std::make_shared<std::string>();
+
+    f.data_ = it->second;
+    f.writable_ = true;
+    f.pos_ = f.data_->size();
+    return f;
+}
+
+bool
+SPIFFSFS::remove(const char* path)
+{
+    return files_.erase(path) > 0;
+}
+
+bool
+SPIFFSFS::rename(const char* from, const char* to)
+{
+    auto it = files_.find(from);
+    if (it == files_.end() || files_.count(to))
+        return false;
+
+    files_[to] = it->second;
+    files_.erase(from);
+    return true;
+}
+
+size_t
+SPIFFSFS::totalBytes()
+{
+    return kTotalBytes;
+}
+
+size_t
+SPIFFSFS::usedBytes()
+{
+    size_t used = 0;
+    for (const auto& f : files_)
+        used += f.second->size();
+    return used;
+}
+
+std::string&
+SPIFFSFS::contents(const char* path)
+{
+    auto& data = files_[path];
+    if (!data)
+        data = std::make_shared<std::string>();
+    return *data;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+// SPIFFS held in memory. Files are shared with open handles, so writes are
+// visible to readers at once rather than on close().
+class File : public Stream
+{
+  public:
+    File() = default;
+
+    explicit operator bool() const
+    {
+        return data_ != nullptr;
+    }
+
+    size_t
+    write(uint8_t c) override;
+
+    size_t
+    write(const uint8_t* buf, size_t n) override;
+
+    using Print::write;
+
+    int
+    available() override;
+
+    int
+    read() override;
+
+    int
+    peek() override;
+
+    size_t
+    read(uint8_t* buf, size_t n);
+
+    bool
+    seek(uint32_t pos);
+
+    size_t
+    position() const;
+
+    size_t
+    size() const;
+
+    void
+    close();
+
+  private:
+    friend class SPIFFSFS;
+
+    std::shared_ptr<std::string> data_;
+    size_t pos_{0};
+    bool writable_{false};
+};
+
+class SPIFFSFS
+{
+  public:
+    bool
+    begin(bool formatOnFail = false);
+
+    bool
+    format();
+
+    bool
+    exists(const char* path);
+
+    // Modes "r", "w" and "a".
+    File
+    open(const char* path, const char* mode = "r");
+
+    bool
+    remove(const char* path);
+
+    bool
+    rename(const char* from, const char* to);
+
+    size_t
+    totalBytes();
+
+    size_t
+    usedBytes();
+
+    // Shim only: the raw bytes of a file, created empty if missing, for tests
+    // that corrupt or inspect what was written.
+    std::string&
+    contents(const char* path);
+
+  private:
+    std::map<std::string, std::shared_ptr<std::string>> files_;
+};
+
+extern SPIFFSFS SPIFFS;
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+
+// Inert servo; remembers the last angle written.
+class Servo
+{
+  public:
+    int
+    attach(int pin)
+    {
+        pin_ = pin;
+        return 0;
+    }
+
+    void
+    write(int angle)
+    {
+        angle_ = angle;
+    }
+
+    int
+    read()
+    {
+        return angle_;
+    }
+
+    void
+    detach()
+    {
+        pin_ = -1;
+    }
+
+  private:
+    int pin_{-1};
+    int angle_{0};
+};
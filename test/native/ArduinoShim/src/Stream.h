@@ -0,0 +1,55 @@
+#pragma once
+#include "Print.h"
+
+// Host streams never block, so the timeout is kept for the API only: reads
+// stop at the first read() < 0.
+class Stream : public Print
+{
+  public:
+    virtual int
+    available() = 0;
+
+    virtual int
+    read() = 0;
+
+    virtual int
+    peek() = 0;
+
+    void
+    setTimeout(unsigned long ms)
+    {
+        timeoutMs_ = ms;
+    }
+
+    unsigned long
+    getTimeout() const
+    {
+        return timeoutMs_;
+    }
+
+    size_t
+    readBytes(char* buf, size_t n)
+    {
+        size_t i = 0;
+        for (int c; i < n && (c = read()) >= 0; ++i)
+            buf[i] = (char)c;
+        return i;
+    }
+
+    size_t
+    readBytes(uint8_t* buf, size_t n)
+    {
+        return readBytes((char*)buf, n);
+    }
+
+    // Consumes input up to and including `target`; false if it never appears.
+    bool
+    find(const char* target);
+
+    // As find(), but gives up once `terminator` has been consumed.
+    bool
+    findUntil(const char* target, const char* terminator);
+
+  private:
+    unsigned long timeoutMs_{1000};
+};
@@ -0,0 +1,252 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Arduino String on top of std::string, covering the members the firmware
+// uses.
+class String
+{
+  public:
+    String() = default;
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    explicit String(char c) : s_(1, c) {}
+    explicit String(int v) : s_(std::to_string(v)) {}
+    explicit String(unsigned v) : s_(std::to_string(v)) {}
+    explicit String(long v) : s_(std::to_string(v)) {}
+    explicit String(unsigned long v) : s_(std::to_string(v)) {}
+    explicit String(long long v) : s_(std::to_string(v)) {}
+    explicit String(unsigned long long v) : s_(std::to_string(v)) {}
+
+    size_t
+    length() const
+    {
+        return s_.size();
+    }
+
+    bool
+    isEmpty() const
+    {
+        return s_.empty();
+    }
+
+    const char*
+    c_str() const
+    {
+        return s_.c_str();
+    }
+
+    void
+    reserve(size_t n)
+    {
+        s_.reserve(n);
+    }
+
+    void
+    clear()
+    {
+        s_.clear();
+    }
+
+    bool
+    concat(const char* s, size_t n)
+    {
+        s_.append(s, n);
+        return true;
+    }
+
+    bool
+    concat(const char* s)
+    {
+        s_.append(s ? s : "");
+        return true;
+    }
+
+    bool
+    concat(const String& s)
+    {
+        s_.append(s.s_);
+        return true;
+    }
+
+    bool
+    concat(char c)
+    {
+        s_.push_back(c);
+        return true;
+    }
+
+    String&
+    operator+=(const String& s)
+    {
+        concat(s);
+        return *this;
+    }
+
+    String&
+    operator+=(const char* s)
+    {
+        concat(s);
+        return *this;
+    }
+
+    String&
+    operator+=(char c)
+    {
+        concat(c);
+        return *this;
+    }
+
+    char
+    operator[](size_t i) const
+    {
+        return i < s_.size() ? s_[i] : '\0';
+    }
+
+    char&
+    operator[](size_t i)
+    {
+        return s_[i];
+    }
+
+    char
+    charAt(size_t i) const
+    {
+        return (*this)[i];
+    }
+
+    bool
+    equals(const String& s) const
+    {
+        return s_ == s.s_;
+    }
+
+    bool
+    operator==(const String& s) const
+    {
+        return s_ == s.s_;
+    }
+
+    bool
+    operator==(const char* s) const
+    {
+        return s_ == (s ? s : "");
+    }
+
+    bool
+    operator!=(const String& s) const
+    {
+        return !(*this == s);
+    }
+
+    bool
+    operator!=(const char* s) const
+    {
+        return !(*this == s);
+    }
+
+    bool
+    operator<(const String& s) const
+    {
+        return s_ < s.s_;
+    }
+
+    bool
+    startsWith(const String& prefix) const
+    {
+        return s_.compare(0, prefix.s_.size(), prefix.s_) == 0;
+    }
+
+    bool
+    endsWith(const String& suffix) const
+    {
+        return s_.size() >= suffix.s_.size() &&
+            s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+    }
+
+    int
+    indexOf(char c, size_t from = 0) const
+    {
+        const size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+
+    int
+    indexOf(const String& s, size_t from = 0) const
+    {
+        const size_t p = s_.find(s.s_, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+
+    String
+    substring(size_t from) const
+    {
+        return from < s_.size() ? String(s_.substr(from)) : String();
+    }
+
+    String
+    substring(size_t from, size_t to) const
+    {
+        return from < to && from < s_.size() ? String(s_.substr(from, to - from)) : String();
+    }
+
+    void
+    trim()
+    {
+        const char* ws = " \t\r\n\f\v";
+        const size_t first = s_.find_first_not_of(ws);
+        if (first == std::string::npos)
+        {
+            s_.clear();
+            return;
+        }
+        s_ = s_.substr(first, s_.find_last_not_of(ws) - first + 1);
+    }
+
+    void
+    replace(const String& find, const String& with);
+
+    void
+    toUpperCase();
+
+    void
+    toLowerCase();
+
+    long
+    toInt() const;
+
+  private:
+    std::string s_;
+};
+
+// Only declared because ArduinoJson adapts it alongside String.
+class StringSumHelper : public String
+{
+  public:
+    StringSumHelper(const String& s) : String(s) {}
+};
+
+inline String
+operator+(const String& a, const String& b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
+
+inline String
+operator+(const String& a, const char* b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
+
+inline String
+operator+(const char* a, const String& b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
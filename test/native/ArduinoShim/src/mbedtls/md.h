@@ -0,0 +1,184 @@
+#pragma once
+// HMAC-SHA256 for mbedtls_md_hmac on the host, so digests and their cost
+// match the device. Only SHA-256 is provided.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t
+{
+    mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+inline const mbedtls_md_info_t*
+mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+    static const mbedtls_md_info_t kSha256 = {MBEDTLS_MD_SHA256};
+    return type == MBEDTLS_MD_SHA256 ? &kSha256 : nullptr;
+}
+
+namespace ArduinoShim
+{
+class Sha256
+{
+  public:
+    Sha256()
+    {
+        static const uint32_t kInit[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(h_, kInit, sizeof(h_));
+    }
+
+    void
+    update(const uint8_t* data, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            block_[used_++] = data[i];
+            if (used_ == 64)
+            {
+                compress_();
+                used_ = 0;
+            }
+        }
+        bits_ += (uint64_t)len * 8;
+    }
+
+    void
+    finish(uint8_t out[32])
+    {
+        const uint64_t bits = bits_;
+        const uint8_t pad = 0x80;
+        const uint8_t zero = 0;
+        update(&pad, 1);
+        while (used_ != 56)
+            update(&zero, 1);
+
+        uint8_t len[8];
+        for (int i = 0; i < 8; ++i)
+            len[i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(len, 8);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[4 * i] = (uint8_t)(h_[i] >> 24);
+            out[4 * i + 1] = (uint8_t)(h_[i] >> 16);
+            out[4 * i + 2] = (uint8_t)(h_[i] >> 8);
+            out[4 * i + 3] = (uint8_t)h_[i];
+        }
+    }
+
+  private:
+    static uint32_t
+    rotr_(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void
+    compress_()
+    {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+            0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+            0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+            0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+            0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+            0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+            0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+            0xc67178f2};
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+        {
+            w[i] = (uint32_t)block_[4 * i] << 24 | (uint32_t)block_[4 * i + 1] << 16 |
+                   (uint32_t)block_[4 * i + 2] << 8 | block_[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i)
+        {
+            const uint32_t s0 = rotr_(w[i - 15], 7) ^ rotr_(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr_(w[i - 2], 17) ^ rotr_(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = h_[0], b = h_[1], c = h_[2], d = h_[3];
+        uint32_t e = h_[4], f = h_[5], g = h_[6], h = h_[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            const uint32_t s1 = rotr_(e, 6) ^ rotr_(e, 11) ^ rotr_(e, 25);
+            const uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            const uint32_t s0 = rotr_(a, 2) ^ rotr_(a, 13) ^ rotr_(a, 22);
+            const uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        h_[0] += a;
+        h_[1] += b;
+        h_[2] += c;
+        h_[3] += d;
+        h_[4] += e;
+        h_[5] += f;
+        h_[6] += g;
+        h_[7] += h;
+    }
+
+    uint32_t h_[8];
+    uint8_t block_[64];
+    size_t used_{0};
+    uint64_t bits_{0};
+};
+} // namespace ArduinoShim
+
+inline int
+mbedtls_md_hmac(
+    const mbedtls_md_info_t* info, const unsigned char* key, size_t keylen,
+    const unsigned char* input, size_t ilen, unsigned char* output
+)
+{
+    if (!info)
+        return -1;
+
+    uint8_t k[64] = {};
+    if (keylen > sizeof(k))
+    {
+        ArduinoShim::Sha256 kh;
+        kh.update(key, keylen);
+        kh.finish(k);
+    }
+    else
+    {
+        memcpy(k, key, keylen);
+    }
+
+    uint8_t pad[64];
+    for (int i = 0; i < 64; ++i)
+        pad[i] = k[i] ^ 0x36;
+    ArduinoShim::Sha256 inner;
+    inner.update(pad, 64);
+    inner.update(input, ilen);
+    uint8_t innerDigest[32];
+    inner.finish(innerDigest);
+
+    for (int i = 0; i < 64; ++i)
+        pad[i] = k[i] ^ 0x5c;
+    ArduinoShim::Sha256 outer;
+    outer.update(pad, 64);
+    outer.update(innerDigest, 32);
+    outer.finish(output);
+    return 0;
+}
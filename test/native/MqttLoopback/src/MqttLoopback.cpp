@@ -0,0 +1,259 @@
+#include "MqttLoopback.h"
+
+#include "network/MqttManager.h"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+namespace
+{
+// The same limits as network/MqttManager.cpp, so paging decisions match.
+constexpr size_t kOutHeader = 3;
+constexpr size_t kMaxTopic = 255;
+constexpr size_t kOutboundRing = 8192 - 2;
+constexpr size_t kMaxInbound = 2048;
+constexpr size_t kInboundPerLoop = 4;
+
+bool s_connected = false;
+uint32_t s_sessions = 0;
+uint32_t s_seq = 0;
+MqttCallback s_callback = nullptr;
+
+bool s_keepPayloads = true;
+std::vector<MqttLoopback::Message> s_published;
+size_t s_publishedCount = 0;
+size_t s_publishedBytes = 0;
+std::vector<std::string> s_subscriptions;
+std::deque<MqttLoopback::Message> s_inbound;
+
+class StringWriter : public Print
+{
+  public:
+    explicit StringWriter(std::string& out) : out_(out) {}
+
+    size_t
+    write(uint8_t c) override
+    {
+        out_.push_back((char)c);
+        return 1;
+    }
+
+    size_t
+    write(const uint8_t* data, size_t size) override
+    {
+        out_.append((const char*)data, size);
+        return size;
+    }
+
+  private:
+    std::string& out_;
+};
+
+bool
+record(const char* topic, std::string& payload, bool retained)
+{
+    const size_t topicLen = strlen(topic);
+    if (topicLen == 0 || topicLen > kMaxTopic || payload.empty() ||
+        kOutHeader + topicLen + payload.size() > kOutboundRing)
+        return false;
+
+    s_seq++;
+    s_publishedCount++;
+    s_publishedBytes += payload.size();
+    if (s_keepPayloads)
+    {
+        s_published.push_back(MqttLoopback::Message{topic, std::string(), retained});
+        s_published.back().payload.swap(payload);
+    }
+    return true;
+}
+} // namespace
+
+namespace MqttLoopback
+{
+void
+connect()
+{
+    s_connected = true;
+    s_sessions++;
+}
+
+void
+disconnect()
+{
+    s_connected = false;
+}
+
+void
+clear()
+{
+    s_published.clear();
+    s_publishedCount = 0;
+    s_publishedBytes = 0;
+    s_subscriptions.clear();
+    s_inbound.clear();
+}
+
+void
+keepPayloads(bool keep)
+{
+    s_keepPayloads = keep;
+}
+
+const std::vector<Message>&
+published()
+{
+    return s_published;
+}
+
+size_t
+publishedCount()
+{
+    return s_publishedCount;
+}
+
+size_t
+publishedBytes()
+{
+    return s_publishedBytes;
+}
+
+const std::vector<std::string>&
+subscriptions()
+{
+    return s_subscriptions;
+}
+
+void
+inject(const char* topic, const uint8_t* payload, size_t length)
+{
+    s_inbound.push_back(Message{topic, std::string((const char*)payload, length), false});
+}
+
+void
+inject(const char* topic, const char* payload)
+{
+    inject(topic, (const uint8_t*)payload, strlen(payload));
+}
+} // namespace MqttLoopback
+
+void
+MqttManager::begin(const AppConfig&, const String&)
+{
+}
+
+void
+MqttManager::loop()
+{
+}
+
+void
+MqttManager::reconnect()
+{
+}
+
+bool
+MqttManager::connected()
+{
+    return s_connected;
+}
+
+uint32_t
+MqttManager::sessionCount()
+{
+    return s_sessions;
+}
+
+bool
+MqttManager::publish(const char* topic, const String& payload, bool retained)
+{
+    if (!s_connected)
+        return false;
+
+    std::string copy(payload.c_str(), payload.length());
+    return record(topic, copy, retained);
+}
+
+bool
+MqttManager::publishDoc(
+    const char* topic, const JsonDocument& doc, WireFormat format, bool retained
+)
+{
+    if (!s_connected)
+        return false;
+
+    std::string payload;
+    payload.reserve(WireCodec::measure(doc, format));
+    StringWriter out(payload);
+    WireCodec::encode(doc, out, format);
+    return record(topic, payload, retained);
+}
+
+void
+MqttManager::subscribe(const char* topic, int)
+{
+    if (s_connected)
+        s_subscriptions.push_back(topic);
+}
+
+void
+MqttManager::setCallback(MqttCallback cb)
+{
+    s_callback = cb;
+}
+
+void
+MqttManager::dispatchInbound()
+{
+    static char topic[kMaxTopic + 1];
+    static uint8_t payload[kMaxInbound];
+
+    for (size_t n = 0; n < kInboundPerLoop && !s_inbound.empty(); ++n)
+    {
+        // Moved out, so dispatching allocates nothing of its own.
+        const MqttLoopback::Message m = std::move(s_inbound.front());
+        s_inbound.pop_front();
+
+        // Copied like the inbound ring does, and cut to the client's buffer.
+        const size_t topicLen = std::min(m.topic.size(), kMaxTopic);
+        memcpy(topic, m.topic.data(), topicLen);
+        topic[topicLen] = '\0';
+        const size_t length = std::min(m.payload.size(), kMaxInbound);
+        memcpy(payload, m.payload.data(), length);
+
+        if (s_callback)
+            s_callback(topic, payload, length);
+    }
+}
+
+// Everything is written as soon as it is queued.
+size_t
+MqttManager::outboundFree()
+{
+    return kOutboundRing - kOutHeader - kMaxTopic;
+}
+
+bool
+MqttManager::outboundFits(size_t payloadBytes, size_t frames)
+{
+    return frames * (kOutHeader + kMaxTopic + payloadBytes) <= kOutboundRing;
+}
+
+uint32_t
+MqttManager::lastQueued()
+{
+    return s_seq;
+}
+
+Delivery
+MqttManager::delivery(uint32_t seq)
+{
+    return seq <= s_seq ? Delivery::Written : Delivery::Failed;
+}
+
+int
+MqttManager::getRetryAttempts()
+{
+    return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+// network/MqttManager.cpp for the host. Publishes are encoded and recorded
+// as the network task would have written them, at once; subscriptions are
+// recorded; messages injected here reach the app callback on the next
+// MqttManager::dispatchInbound(). Starts disconnected.
+namespace MqttLoopback
+{
+struct Message
+{
+    std::string topic;
+    std::string payload;
+    bool retained;
+};
+
+// Like a broker session coming up: connected() turns true and
+// sessionCount() is bumped.
+void
+connect();
+
+void
+disconnect();
+
+// Forgets publishes, subscriptions and pending inbound messages.
+void
+clear();
+
+// Payloads are only counted when not kept (large benchmarks).
+void
+keepPayloads(bool keep);
+
+const std::vector<Message>&
+published();
+
+size_t
+publishedCount();
+
+size_t
+publishedBytes();
+
+const std::vector<std::string>&
+subscriptions();
+
+void
+inject(const char* topic, const uint8_t* payload, size_t length);
+
+void
+inject(const char* topic, const char* payload);
+} // namespace MqttLoopback
@@ -0,0 +1,2 @@
+#pragma once
+// network/MqttManager.h includes this; the loopback never talks to a broker.
@@ -0,0 +1,440 @@
+// Timings for the credential store hot paths at 10 to 5000 entries, and card
+// lookups up to 10000. Each
+// result is printed as one JSON object per line, prefixed "BENCH ", so runs
+// can be compared between firmware versions:
+//
+//   pio test -e native -f test_benchmark -v | grep '^BENCH ' | cut -c7-
+//
+// Host timings are only comparable with each other. Flash bytes match the
+// device; allocation counts also include the in-memory SPIFFS growing its
+// files on writes.
+
+#include "models/PinAuthState.h"
+#include "models/SwipeAddState.h"
+#include "storage/CardRepository.h"
+#include "storage/FileSystem.h"
+#include "storage/PasscodeRepository.h"
+#include "storage/RecordFile.h"
+#include "utils/Logger.h"
+
+#include <SPIFFS.h>
+#include <unity.h>
+
+#include <new>
+#include <vector>
+
+namespace
+{
+const size_t kSizes[] = {10, 100, 1000, 5000};
+
+// The card counts a multi-tenant door is sized for.
+const size_t kLookupSizes[] = {100, 1000, 10000};
+
+// Lookups per measurement; writes are far slower, so fewer of them.
+constexpr size_t kLookups = 2000;
+constexpr size_t kWrites = 10;
+
+// Journaled changes per measurement: enough to include two compactions.
+constexpr size_t kJournalOps = 130;
+
+size_t s_allocs = 0;
+size_t s_allocBytes = 0;
+
+struct Counters
+{
+    unsigned long us;
+    size_t allocs;
+    size_t allocBytes;
+    uint32_t flashBytes;
+
+    static Counters
+    now()
+    {
+        return Counters{micros(), s_allocs, s_allocBytes, FileSystem::bytesWritten()};
+    }
+};
+
+void
+report(const char* bench, size_t n, size_t ops, const Counters& start)
+{
+    const Counters end = Counters::now();
+    printf(
+        "BENCH {\"bench\":\"%s\",\"n\":%u,\"ops\":%u,\"usPerOp\":%.3f,\"allocsPerOp\":%.2f,"
+        "\"allocBytesPerOp\":%.1f,\"flashBytesPerOp\":%.1f}\n",
+        bench, (unsigned)n, (unsigned)ops, (double)(end.us - start.us) / ops,
+        (double)(end.allocs - start.allocs) / ops,
+        (double)(end.allocBytes - start.allocBytes) / ops,
+        (double)(end.flashBytes - start.flashBytes) / ops
+    );
+}
+
+String
+uidFor(size_t i)
+{
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08X", (unsigned)(0x10000000u + i * 2654435761u % 0x0FFFFFFFu));
+    return String(hex);
+}
+
+String
+codeFor(size_t i)
+{
+    return String((unsigned long)(10000000 + i));
+}
+
+void
+fillCards(CardRepository& repo, size_t n)
+{
+    SPIFFS.format();
+    repo.load();
+    for (size_t i = 0; i < n; ++i)
+        repo.add(uidFor(i), "Card");
+}
+
+// Writes the snapshot add() would have left behind, as /iccards.bin records
+// (1: ts, rev; 2: uid, name): adding 10000 cards one by one rewrites the
+// file 10000 times.
+void
+writeCards(size_t n)
+{
+    SPIFFS.format();
+    const bool ok = FileSystem::writeFileAtomic(
+        AppPaths::CARDS_BIN,
+        [n](Print& out)
+        {
+            if (!RecordFile::writeHeader(out, RecordFile::Kind::Cards) ||
+                !RecordWriter(1).putU64(0).putU64(0).writeTo(out))
+                return false;
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!RecordWriter(2).putString(uidFor(i)).putString("Card").writeTo(out))
+                    return false;
+            }
+            return true;
+        }
+    );
+    TEST_ASSERT_TRUE(ok);
+}
+
+// The UID as the reader hands it over.
+std::vector<uint8_t>
+uidBytesFor(size_t i)
+{
+    const String hex = uidFor(i);
+    std::vector<uint8_t> out(hex.length() / 2);
+    for (size_t b = 0; b < out.size(); ++b)
+        out[b] = (uint8_t)strtoul(hex.substring(2 * b, 2 * b + 2).c_str(), nullptr, 16);
+    return out;
+}
+
+void
+fillPasscodes(PasscodeRepository& repo, size_t n)
+{
+    SPIFFS.format();
+    repo.load();
+
+    std::vector<Passcode> items(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        items[i].code = codeFor(i);
+        items[i].type = "timed";
+        items[i].effectiveAt = 0;
+        items[i].expireAt = 0;
+    }
+    repo.setItems(items, 1);
+}
+} // namespace
+
+// Counts every heap allocation made through new, which is what String and
+// the standard containers use.
+void*
+operator new(size_t n)
+{
+    s_allocs++;
+    s_allocBytes += n;
+    if (void* p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::ERROR);
+}
+
+void
+tearDown()
+{
+}
+
+void
+bench_cards()
+{
+    for (size_t n : kSizes)
+    {
+        CardRepository repo;
+        fillCards(repo, n);
+        TEST_ASSERT_EQUAL(n, repo.size());
+
+        size_t hits = 0;
+        Counters start = Counters::now();
+        for (size_t i = 0; i < kLookups; ++i)
+            hits += repo.exists(uidFor(i % n)) ? 1 : 0;
+        report("cards.exists.hit", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        const uint8_t miss[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+        start = Counters::now();
+        for (size_t i = 0; i < kLookups; ++i)
+            hits += repo.exists(miss, sizeof(miss)) ? 1 : 0;
+        report("cards.exists.miss", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        start = Counters::now();
+        for (size_t i = 0; i < kWrites; ++i)
+            TEST_ASSERT_TRUE(repo.add(uidFor(n + i), "Card"));
+        report("cards.add", n, kWrites, start);
+
+        CardRepository loaded;
+        start = Counters::now();
+        TEST_ASSERT_TRUE(loaded.load());
+        report("cards.load", n, 1, start);
+        TEST_ASSERT_EQUAL(n + kWrites, loaded.size());
+    }
+}
+
+// What an RFID tap costs: the reader's bytes looked up directly, and the hex
+// form MQTT commands use.
+void
+bench_card_lookups()
+{
+    for (size_t n : kLookupSizes)
+    {
+        writeCards(n);
+        CardRepository repo;
+        TEST_ASSERT_TRUE(repo.load());
+        TEST_ASSERT_EQUAL(n, repo.size());
+
+        std::vector<std::vector<uint8_t>> taps;
+        std::vector<String> hex;
+        taps.reserve(kLookups);
+        hex.reserve(kLookups);
+        for (size_t i = 0; i < kLookups; ++i)
+        {
+            // Spread over the whole list, not just its first kLookups cards.
+            const size_t card = i * (n / kLookups + 1) % n;
+            taps.push_back(uidBytesFor(card));
+            hex.push_back(uidFor(card));
+        }
+
+        size_t hits = 0;
+        Counters start = Counters::now();
+        for (const auto& uid : taps)
+            hits += repo.exists(uid.data(), uid.size()) ? 1 : 0;
+        report("cards.lookup.bytes.hit", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        const uint8_t miss[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+        start = Counters::now();
+        for (size_t i = 0; i < kLookups; ++i)
+            hits += repo.exists(miss, sizeof(miss)) ? 1 : 0;
+        report("cards.lookup.bytes.miss", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        start = Counters::now();
+        for (const String& uid : hex)
+            hits += repo.exists(uid) ? 1 : 0;
+        report("cards.lookup.hex.hit", n, kLookups, start);
+        TEST_ASSERT_EQUAL(2 * kLookups, hits);
+    }
+}
+
+void
+bench_passcodes()
+{
+    for (size_t n : kSizes)
+    {
+        PasscodeRepository repo;
+        fillPasscodes(repo, n);
+        TEST_ASSERT_EQUAL(n, repo.listItems().size());
+
+        size_t hits = 0;
+        Counters start = Counters::now();
+        for (size_t i = 0; i < kLookups; ++i)
+        {
+            const String code = codeFor(i % n);
+            hits += repo.validateAndConsume(code.c_str(), code.length(), 1000) ? 1 : 0;
+        }
+        report("passcodes.validate.hit", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        start = Counters::now();
+        for (size_t i = 0; i < kLookups; ++i)
+            hits += repo.validateAndConsume("99999999", 8, 1000) ? 1 : 0;
+        report("passcodes.validate.miss", n, kLookups, start);
+        TEST_ASSERT_EQUAL(kLookups, hits);
+
+        // One-time codes are erased and journaled on use.
+        for (size_t i = 0; i < kWrites; ++i)
+        {
+            Passcode p;
+            p.code = codeFor(n + i);
+            p.type = "one_time";
+            p.effectiveAt = 0;
+            p.expireAt = 0;
+            repo.addItem(p);
+        }
+        start = Counters::now();
+        for (size_t i = 0; i < kWrites; ++i)
+        {
+            const String code = codeFor(n + i);
+            hits += repo.validateAndConsume(code.c_str(), code.length(), 1000) ? 1 : 0;
+        }
+        report("passcodes.validate.consume", n, kWrites, start);
+        TEST_ASSERT_EQUAL(kLookups + kWrites, hits);
+
+        start = Counters::now();
+        for (size_t i = 0; i < kWrites; ++i)
+            TEST_ASSERT_TRUE(repo.setMaster("123456"));
+        report("passcodes.saveAll", n, kWrites, start);
+
+        PasscodeRepository loaded;
+        start = Counters::now();
+        TEST_ASSERT_TRUE(loaded.load());
+        report("passcodes.load", n, 1, start);
+        TEST_ASSERT_EQUAL(n, loaded.listItems().size());
+    }
+}
+
+// Flash written per passcode change. "rewrite" is the whole snapshot, what
+// every change cost before the journal; the others are journaled, with their
+// share of the compactions.
+void
+bench_passcode_flash()
+{
+    for (size_t n : kSizes)
+    {
+        PasscodeRepository repo;
+        fillPasscodes(repo, n);
+
+        Counters start = Counters::now();
+        for (size_t i = 0; i < kWrites; ++i)
+            TEST_ASSERT_TRUE(repo.setMaster("123456"));
+        report("passcodes.flash.rewrite", n, kWrites, start);
+        const uint32_t rewrite = (FileSystem::bytesWritten() - start.flashBytes) / kWrites;
+
+        start = Counters::now();
+        for (size_t i = 0; i < 2 * kJournalOps; ++i)
+        {
+            Passcode p;
+            p.code = codeFor(n + i);
+            p.type = "one_time";
+            p.effectiveAt = 0;
+            p.expireAt = 0;
+            TEST_ASSERT_TRUE(repo.addItem(p));
+        }
+        report("passcodes.flash.add", n, 2 * kJournalOps, start);
+        const uint32_t add = (FileSystem::bytesWritten() - start.flashBytes) / (2 * kJournalOps);
+
+        start = Counters::now();
+        for (size_t i = 0; i < kJournalOps; ++i)
+        {
+            const String code = codeFor(n + i);
+            TEST_ASSERT_TRUE(repo.validateAndConsume(code.c_str(), code.length(), 1000));
+        }
+        report("passcodes.flash.consume", n, kJournalOps, start);
+
+        start = Counters::now();
+        for (size_t i = kJournalOps; i < 2 * kJournalOps; ++i)
+            TEST_ASSERT_TRUE(repo.removeItemByCode(codeFor(n + i)));
+        report("passcodes.flash.remove", n, kJournalOps, start);
+
+        TEST_ASSERT_EQUAL(n, repo.listItems().size());
+        if (n >= 100)
+            TEST_ASSERT_LESS_THAN(rewrite / 4, add);
+    }
+}
+
+// The input paths must not touch the heap. keypad.pin is one PIN entry:
+// eight key presses into the PIN buffer, then '#' checking it against the
+// master and the items as KeypadService does. rfid.tap formats the reader's
+// UID as RfidService::getUID_ does, looks it up and keeps it as the held card.
+void
+bench_keypress_and_tap()
+{
+    const size_t n = 1000;
+    PasscodeRepository passcodes;
+    fillPasscodes(passcodes, n);
+    TEST_ASSERT_TRUE(passcodes.setMaster("24681357"));
+    writeCards(n);
+    CardRepository cards;
+    TEST_ASSERT_TRUE(cards.load());
+
+    const String hit = codeFor(n / 2);
+    PinAuthState pin;
+    size_t unlocks = 0;
+    Counters start = Counters::now();
+    for (size_t i = 0; i < kLookups; ++i)
+    {
+        // Every other PIN is a stored one.
+        const char* digits = i % 2 ? "99999999" : hit.c_str();
+        for (const char* d = digits; *d; ++d)
+            pin.appendDigit(*d, (int)PinAuthState::kMaxDigits);
+
+        const PinAuthState::Buffer& buffer = pin.getBuffer();
+        if (passcodes.matchesMaster(buffer.c_str(), buffer.length()) ||
+            passcodes.validateAndConsume(buffer.c_str(), buffer.length(), 1000))
+            unlocks++;
+        pin.clearBuffer();
+    }
+    report("keypad.pin", n, kLookups, start);
+    TEST_ASSERT_EQUAL(kLookups / 2, unlocks);
+    TEST_ASSERT_EQUAL(0, s_allocs - start.allocs);
+
+    std::vector<std::vector<uint8_t>> taps;
+    for (size_t i = 0; i < kLookups; ++i)
+        taps.push_back(uidBytesFor(i % n));
+
+    CardUidHex held;
+    size_t granted = 0;
+    start = Counters::now();
+    for (const auto& tap : taps)
+    {
+        CardUidHex uid;
+        for (uint8_t b : tap)
+            uid.appendHex(b);
+
+        granted += cards.exists(tap.data(), tap.size()) ? 1 : 0;
+        held = uid;
+    }
+    report("rfid.tap", n, kLookups, start);
+    TEST_ASSERT_EQUAL(kLookups, granted);
+    TEST_ASSERT_TRUE(held.equals(uidFor((kLookups - 1) % n).c_str(), 8));
+    TEST_ASSERT_EQUAL(0, s_allocs - start.allocs);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_cards);
+    RUN_TEST(bench_card_lookups);
+    RUN_TEST(bench_passcodes);
+    RUN_TEST(bench_passcode_flash);
+    RUN_TEST(bench_keypress_and_tap);
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+#include "utils/BoundedQueue.h"
+
+#include <unity.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+bool
+push(BoundedQueue<int, 4>& q, int v)
+{
+    uint32_t ticket;
+    int* cell = q.tryClaim(ticket);
+    if (!cell)
+        return false;
+
+    *cell = v;
+    q.publish(ticket);
+    return true;
+}
+
+bool
+pop(BoundedQueue<int, 4>& q, int& v)
+{
+    uint32_t ticket;
+    int* cell = q.tryPeek(ticket);
+    if (!cell)
+        return false;
+
+    v = *cell;
+    q.release(ticket);
+    return true;
+}
+} // namespace
+
+void
+setUp()
+{
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_fifo_order()
+{
+    BoundedQueue<int, 4> q;
+    int v = 0;
+    TEST_ASSERT_FALSE(pop(q, v));
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 3; ++i)
+            TEST_ASSERT_TRUE(push(q, round * 10 + i));
+
+        for (int i = 0; i < 3; ++i)
+        {
+            TEST_ASSERT_TRUE(pop(q, v));
+            TEST_ASSERT_EQUAL(round * 10 + i, v);
+        }
+        TEST_ASSERT_FALSE(pop(q, v));
+    }
+}
+
+void
+test_full_queue_refuses()
+{
+    BoundedQueue<int, 4> q;
+    for (int i = 0; i < 4; ++i)
+        TEST_ASSERT_TRUE(push(q, i));
+    TEST_ASSERT_FALSE(push(q, 4));
+
+    int v = 0;
+    TEST_ASSERT_TRUE(pop(q, v));
+    TEST_ASSERT_TRUE(push(q, 4));
+}
+
+// A claimed cell is invisible to the consumer until published, and it holds
+// back everything claimed after it.
+void
+test_unpublished_cell_blocks_consumer()
+{
+    BoundedQueue<int, 4> q;
+    uint32_t first;
+    int* cell = q.tryClaim(first);
+    TEST_ASSERT_NOT_NULL(cell);
+    *cell = 1;
+
+    TEST_ASSERT_TRUE(push(q, 2));
+
+    int v = 0;
+    TEST_ASSERT_FALSE(pop(q, v));
+
+    q.publish(first);
+    TEST_ASSERT_TRUE(pop(q, v));
+    TEST_ASSERT_EQUAL(1, v);
+    TEST_ASSERT_TRUE(pop(q, v));
+    TEST_ASSERT_EQUAL(2, v);
+}
+
+void
+test_concurrent_producers_lose_nothing()
+{
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 20000;
+
+    BoundedQueue<uint32_t, 64> q;
+    std::atomic<int> done{0};
+    std::vector<std::thread> producers;
+
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back(
+            [&, p]()
+            {
+                for (int i = 0; i < kPerProducer; ++i)
+                {
+                    uint32_t ticket;
+                    uint32_t* cell;
+                    while (!(cell = q.tryClaim(ticket)))
+                        std::this_thread::yield();
+
+                    *cell = ((uint32_t)p << 24) | (uint32_t)i;
+                    q.publish(ticket);
+                }
+                done++;
+            }
+        );
+    }
+
+    // Each producer's values must come out in the order it pushed them.
+    std::vector<int> next(kProducers, 0);
+    int received = 0;
+    bool ordered = true;
+    while (received < kProducers * kPerProducer)
+    {
+        uint32_t ticket;
+        const uint32_t* cell = q.tryPeek(ticket);
+        if (!cell)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const uint32_t v = *cell;
+        q.release(ticket);
+
+        const int p = (int)(v >> 24);
+        ordered = ordered && (int)(v & 0xFFFFFF) == next[p];
+        next[p]++;
+        received++;
+    }
+
+    for (auto& t : producers)
+        t.join();
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL(kProducers, done.load());
+    for (int p = 0; p < kProducers; ++p)
+        TEST_ASSERT_EQUAL(kPerProducer, next[p]);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_full_queue_refuses);
+    RUN_TEST(test_unpublished_cell_blocks_consumer);
+    RUN_TEST(test_concurrent_producers_lose_nothing);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#include "storage/ChangeLog.h"
+
+#include <unity.h>
+
+#include <vector>
+
+namespace
+{
+using Log = ChangeLog<int, 4>;
+
+std::vector<int>
+valuesSince(const Log& log, uint32_t since)
+{
+    std::vector<int> out;
+    log.forEachSince(since, [&](const Log::Entry& e) { out.push_back(e.value); });
+    return out;
+}
+} // namespace
+
+void
+setUp()
+{
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_record_bumps_revision()
+{
+    Log log;
+    TEST_ASSERT_EQUAL_UINT32(0, log.rev());
+    TEST_ASSERT_EQUAL_UINT32(1, log.record(ChangeOp::Add, 10));
+    TEST_ASSERT_EQUAL_UINT32(2, log.record(ChangeOp::Remove, 20));
+    TEST_ASSERT_EQUAL_UINT32(2, log.rev());
+}
+
+void
+test_entries_since_oldest_first()
+{
+    Log log;
+    log.record(ChangeOp::Add, 10);
+    log.record(ChangeOp::Add, 20);
+    log.record(ChangeOp::Rename, 30);
+
+    TEST_ASSERT_TRUE(log.covers(0));
+    TEST_ASSERT_EQUAL(3, log.countSince(0));
+
+    const std::vector<int> v = valuesSince(log, 1);
+    TEST_ASSERT_EQUAL(2, v.size());
+    TEST_ASSERT_EQUAL(20, v[0]);
+    TEST_ASSERT_EQUAL(30, v[1]);
+
+    // Already current: covered, nothing to send.
+    TEST_ASSERT_TRUE(log.covers(3));
+    TEST_ASSERT_EQUAL(0, log.countSince(3));
+}
+
+void
+test_ring_forgets_old_entries()
+{
+    Log log;
+    for (int i = 1; i <= 6; ++i)
+        log.record(ChangeOp::Add, i * 10);
+
+    TEST_ASSERT_FALSE(log.covers(0));
+    TEST_ASSERT_FALSE(log.covers(1));
+    TEST_ASSERT_TRUE(log.covers(2));
+    TEST_ASSERT_EQUAL(0, log.countSince(1));
+
+    const std::vector<int> v = valuesSince(log, 2);
+    TEST_ASSERT_EQUAL(4, v.size());
+    TEST_ASSERT_EQUAL(30, v[0]);
+    TEST_ASSERT_EQUAL(60, v[3]);
+}
+
+void
+test_future_revision_is_not_covered()
+{
+    Log log;
+    log.record(ChangeOp::Add, 10);
+
+    TEST_ASSERT_FALSE(log.covers(2));
+    TEST_ASSERT_EQUAL(0, log.countSince(2));
+}
+
+void
+test_bump_and_reset_drop_history()
+{
+    Log log;
+    log.record(ChangeOp::Add, 10);
+    log.bump();
+
+    TEST_ASSERT_EQUAL_UINT32(2, log.rev());
+    TEST_ASSERT_FALSE(log.covers(1));
+    TEST_ASSERT_TRUE(log.covers(2));
+
+    log.reset(100);
+    TEST_ASSERT_EQUAL_UINT32(100, log.rev());
+    TEST_ASSERT_FALSE(log.covers(99));
+
+    log.record(ChangeOp::Master, 7);
+    TEST_ASSERT_TRUE(log.covers(100));
+    TEST_ASSERT_EQUAL(7, valuesSince(log, 100)[0]);
+}
+
+void
+test_op_names()
+{
+    TEST_ASSERT_EQUAL_STRING("add", changeOpName(ChangeOp::Add));
+    TEST_ASSERT_EQUAL_STRING("remove", changeOpName(ChangeOp::Remove));
+    TEST_ASSERT_EQUAL_STRING("rename", changeOpName(ChangeOp::Rename));
+    TEST_ASSERT_EQUAL_STRING("master", changeOpName(ChangeOp::Master));
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_record_bumps_revision);
+    RUN_TEST(test_entries_since_oldest_first);
+    RUN_TEST(test_ring_forgets_old_entries);
+    RUN_TEST(test_future_revision_is_not_covered);
+    RUN_TEST(test_bump_and_reset_drop_history);
+    RUN_TEST(test_op_names);
+    return UNITY_END();
+}
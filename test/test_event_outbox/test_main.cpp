@@ -0,0 +1,304 @@
+#include "storage/EventOutbox.h"
+#include "storage/RecordFile.h"
+
+#include <SPIFFS.h>
+#include <unity.h>
+
+#include <string>
+
+namespace
+{
+constexpr const char* PATH = AppPaths::OUTBOX_BIN;
+
+OutboxEvent
+event(uint64_t n)
+{
+    OutboxEvent e;
+    e.kind = OutboxEvent::Kind::Log;
+    e.ts = n;
+    e.a = "unlock";
+    e.b = "keypad";
+    e.c = String((unsigned long)n);
+    return e;
+}
+
+// Pops everything one at a time; returns how many came out, and whether
+// their timestamps ran consecutively from `first`.
+size_t
+drain(EventOutbox& box, uint64_t first, bool& inOrder)
+{
+    inOrder = true;
+    size_t n = 0;
+    OutboxEvent e;
+    while (box.peek(&e, 1) == 1)
+    {
+        inOrder = inOrder && e.ts == first + n && e.c == String((unsigned long)(first + n));
+        box.pop();
+        n++;
+    }
+    return n;
+}
+} // namespace
+
+void
+setUp()
+{
+    SPIFFS.format();
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_ram_only_round_trip()
+{
+    EventOutbox box;
+    for (uint64_t i = 0; i < 5; ++i)
+        box.push(event(i));
+
+    TEST_ASSERT_EQUAL(5, box.depth());
+    TEST_ASSERT_FALSE(SPIFFS.exists(PATH));
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(5, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_TRUE(box.empty());
+}
+
+void
+test_spills_to_flash_in_order()
+{
+    EventOutbox box;
+    for (uint64_t i = 0; i < 50; ++i)
+        box.push(event(i));
+
+    TEST_ASSERT_EQUAL(50, box.depth());
+    TEST_ASSERT_TRUE(SPIFFS.exists(PATH));
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(50, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_FALSE(SPIFFS.exists(PATH));
+}
+
+void
+test_peek_batches_do_not_cross_file_and_ram()
+{
+    EventOutbox box;
+    for (uint64_t i = 0; i < EventOutbox::kRamEvents + 3; ++i)
+        box.push(event(i));
+
+    OutboxEvent batch[32];
+    uint64_t next = 0;
+    size_t n;
+    while ((n = box.peek(batch, 32)) > 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            TEST_ASSERT_EQUAL_UINT64(next + i, batch[i].ts);
+        next += n;
+        box.pop(n);
+    }
+    TEST_ASSERT_EQUAL_UINT64(EventOutbox::kRamEvents + 3, next);
+}
+
+void
+test_survives_reboot()
+{
+    {
+        EventOutbox box;
+        for (uint64_t i = 0; i < 35; ++i)
+            box.push(event(i));
+    }
+
+    // Only the spilled part outlives the RAM ring.
+    EventOutbox box;
+    box.begin();
+    TEST_ASSERT_EQUAL(2 * EventOutbox::kRamEvents, box.depth());
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(2 * EventOutbox::kRamEvents, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+void
+test_reboot_mid_drain_resends_from_file_start()
+{
+    {
+        EventOutbox box;
+        for (uint64_t i = 0; i < 20; ++i)
+            box.push(event(i));
+        box.pop(3);
+    }
+
+    // The read offset is RAM-only: delivery is at-least-once.
+    EventOutbox box;
+    box.begin();
+    TEST_ASSERT_EQUAL(EventOutbox::kRamEvents, box.depth());
+
+    OutboxEvent e;
+    TEST_ASSERT_EQUAL(1, box.peek(&e, 1));
+    TEST_ASSERT_EQUAL_UINT64(0, e.ts);
+}
+
+void
+test_torn_file_tail_is_ignored_on_reboot()
+{
+    {
+        EventOutbox box;
+        for (uint64_t i = 0; i < 20; ++i)
+            box.push(event(i));
+    }
+    std::string& raw = SPIFFS.contents(PATH);
+    raw.resize(raw.size() - 3);
+
+    EventOutbox box;
+    box.begin();
+    TEST_ASSERT_EQUAL(EventOutbox::kRamEvents - 1, box.depth());
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(EventOutbox::kRamEvents - 1, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+void
+test_drop_newest_keeps_the_oldest()
+{
+    EventOutbox box;
+    box.configure(40, EventOutbox::DropPolicy::DropNewest);
+    for (uint64_t i = 0; i < 50; ++i)
+        box.push(event(i));
+
+    TEST_ASSERT_EQUAL(40, box.depth());
+    TEST_ASSERT_EQUAL_UINT32(10, box.dropped());
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(40, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+void
+test_drop_oldest_keeps_the_newest()
+{
+    EventOutbox box;
+    box.configure(40, EventOutbox::DropPolicy::DropOldest);
+    for (uint64_t i = 0; i < 500; ++i)
+        box.push(event(i));
+
+    // Each push over the limit drops exactly one, so the queue stays full.
+    TEST_ASSERT_EQUAL_UINT32(40, box.depth());
+    TEST_ASSERT_EQUAL_UINT32(460, box.dropped());
+
+    OutboxEvent e;
+    TEST_ASSERT_EQUAL(1, box.peek(&e, 1));
+    const uint64_t first = e.ts;
+    TEST_ASSERT_EQUAL_UINT64(460, first);
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(500 - first, drain(box, first, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+// Dropping from the head of the file only moves the read offset; once it
+// passes the compaction threshold the file is rewritten without the dead
+// prefix.
+void
+test_dropped_head_is_compacted()
+{
+    EventOutbox box;
+    box.configure(64, EventOutbox::DropPolicy::DropOldest);
+
+    size_t largest = 0;
+    for (uint64_t i = 0; i < 2000; ++i)
+    {
+        box.push(event(i));
+        largest = std::max(largest, SPIFFS.contents(PATH).size());
+    }
+
+    TEST_ASSERT_LESS_THAN(8192, largest);
+    TEST_ASSERT_EQUAL_UINT32(2000, box.depth() + box.dropped());
+}
+
+void
+test_head_index_counts_pops_and_front_drops()
+{
+    EventOutbox box;
+    box.configure(EventOutbox::kRamEvents, EventOutbox::DropPolicy::DropOldest);
+    TEST_ASSERT_EQUAL_UINT32(0, box.headIndex());
+
+    for (uint64_t i = 0; i < 10; ++i)
+        box.push(event(i));
+    box.pop(4);
+    TEST_ASSERT_EQUAL_UINT32(4, box.headIndex());
+
+    // Full: each push drops one from the front.
+    for (uint64_t i = 10; i < 25; ++i)
+        box.push(event(i));
+    TEST_ASSERT_EQUAL_UINT32(4 + box.dropped(), box.headIndex());
+}
+
+// A peeked batch stays at the front while more events arrive and spill, so
+// popping it later removes exactly those events.
+void
+test_batch_held_across_spill()
+{
+    EventOutbox box;
+    for (uint64_t i = 0; i < 10; ++i)
+        box.push(event(i));
+
+    OutboxEvent batch[8];
+    const size_t n = box.peek(batch, 8);
+    const uint32_t head = box.headIndex();
+    TEST_ASSERT_EQUAL(8, n);
+
+    for (uint64_t i = 10; i < 40; ++i)
+        box.push(event(i));
+
+    TEST_ASSERT_EQUAL_UINT32(head, box.headIndex());
+    box.pop(n);
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(32, drain(box, 8, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+// An event no record can hold is refused at push, so it cannot wedge every
+// later spill behind it.
+void
+test_oversized_event_is_refused()
+{
+    EventOutbox box;
+
+    OutboxEvent big = event(0);
+    big.c = String(std::string(RecordFile::MAX_STRING + 1, 'x').c_str());
+    box.push(big);
+    TEST_ASSERT_EQUAL(0, box.depth());
+    TEST_ASSERT_EQUAL_UINT32(1, box.dropped());
+
+    for (uint64_t i = 0; i < 3 * EventOutbox::kRamEvents; ++i)
+        box.push(event(i));
+
+    bool inOrder;
+    TEST_ASSERT_EQUAL(3 * EventOutbox::kRamEvents, drain(box, 0, inOrder));
+    TEST_ASSERT_TRUE(inOrder);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ram_only_round_trip);
+    RUN_TEST(test_spills_to_flash_in_order);
+    RUN_TEST(test_peek_batches_do_not_cross_file_and_ram);
+    RUN_TEST(test_survives_reboot);
+    RUN_TEST(test_reboot_mid_drain_resends_from_file_start);
+    RUN_TEST(test_torn_file_tail_is_ignored_on_reboot);
+    RUN_TEST(test_drop_newest_keeps_the_oldest);
+    RUN_TEST(test_drop_oldest_keeps_the_newest);
+    RUN_TEST(test_dropped_head_is_compacted);
+    RUN_TEST(test_head_index_counts_pops_and_front_drops);
+    RUN_TEST(test_batch_held_across_spill);
+    RUN_TEST(test_oversized_event_is_refused);
+    return UNITY_END();
+}
@@ -0,0 +1,293 @@
+// Heap fragmentation after a long run of MQTT messages, with the documents
+// leased from a JsonArena per direction as the services do, and with a
+// fresh document per message as they did before. Results are printed like
+// test_benchmark's:
+//
+//   pio test -e native -f test_json_arena_soak -v | grep '^BENCH ' | cut -c7-
+//
+// The host heap says nothing about the device's, so the run is replayed on
+// SimHeap, a first-fit allocator with coalescing (a simple stand-in for the
+// ESP32 heap) the size of what the firmware has left once WiFi and TLS are
+// up. Each message takes its document while the handler's other allocations
+// come and go around it, some of them long-lived (queued events, log lines,
+// added cards).
+
+#include "utils/Logger.h"
+
+#include <unity.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace
+{
+constexpr size_t kHeapBytes = 48 * 1024;
+constexpr size_t kMessages = 200000;
+
+// Document sizes leased by MqttService and PublishService.
+constexpr size_t kInboundJsonBytes = 512;
+constexpr size_t kItemJsonBytes = 136;
+constexpr size_t kPageJsonBytes = 128 + 32 * kItemJsonBytes;
+constexpr size_t kEventJsonBytes = 112;
+
+// Allocations that outlive their message, oldest freed first.
+constexpr size_t kLiveSlots = 192;
+
+// Matches multi_heap's block header and alignment closely enough.
+constexpr size_t kBlockHeader = 8;
+constexpr size_t kAlign = 8;
+
+constexpr size_t kNone = (size_t)-1;
+
+class SimHeap
+{
+  public:
+    explicit SimHeap(size_t bytes)
+    {
+        free_[0] = bytes;
+    }
+
+    // Offset of the new block, or kNone when no free block is large enough.
+    size_t
+    alloc(size_t n)
+    {
+        const size_t size = (n + kBlockHeader + kAlign - 1) / kAlign * kAlign;
+        for (auto it = free_.begin(); it != free_.end(); ++it)
+        {
+            if (it->second < size)
+                continue;
+
+            const size_t offset = it->first;
+            const size_t rest = it->second - size;
+            free_.erase(it);
+            if (rest)
+                free_[offset + size] = rest;
+            used_[offset] = size;
+            return offset;
+        }
+        failures_++;
+        return kNone;
+    }
+
+    void
+    release(size_t offset)
+    {
+        if (offset == kNone)
+            return;
+
+        auto used = used_.find(offset);
+        size_t size = used->second;
+        used_.erase(used);
+
+        auto next = free_.find(offset + size);
+        if (next != free_.end())
+        {
+            size += next->second;
+            free_.erase(next);
+        }
+
+        auto after = free_.lower_bound(offset);
+        if (after != free_.begin())
+        {
+            auto prev = std::prev(after);
+            if (prev->first + prev->second == offset)
+            {
+                prev->second += size;
+                return;
+            }
+        }
+        free_[offset] = size;
+    }
+
+    size_t
+    freeBytes() const
+    {
+        size_t total = 0;
+        for (const auto& b : free_)
+            total += b.second;
+        return total;
+    }
+
+    size_t
+    largestFree() const
+    {
+        size_t largest = 0;
+        for (const auto& b : free_)
+            largest = std::max(largest, b.second);
+        return largest;
+    }
+
+    size_t
+    failures() const
+    {
+        return failures_;
+    }
+
+  private:
+    std::map<size_t, size_t> free_; // offset -> size
+    std::map<size_t, size_t> used_;
+    size_t failures_ = 0;
+};
+
+// Deterministic, so both runs see the same messages.
+class Lcg
+{
+  public:
+    uint32_t
+    next(uint32_t bound)
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return (state_ >> 8) % bound;
+    }
+
+  private:
+    uint32_t state_ = 12345;
+};
+
+// Where a message's document comes from: JsonArena::Lease uses the arena
+// when the document fits, else the heap. Messages are handled one at a time
+// here, so an arena is never busy.
+struct Message
+{
+    size_t arenaBytes;
+    size_t docBytes;
+};
+
+// One message's document: a request, an event batch, a change list or a
+// snapshot page, in roughly the mix a busy door sees.
+Message
+nextMessage(Lcg& rng)
+{
+    const uint32_t kind = rng.next(10);
+    if (kind < 5)
+        return Message{kInboundJsonBytes, rng.next(2) ? kInboundJsonBytes : 256};
+    if (kind < 8)
+        return Message{kPageJsonBytes, 64 + (1 + rng.next(8)) * kEventJsonBytes};
+    if (kind < 9)
+        return Message{kPageJsonBytes, 128 + (1 + rng.next(32)) * kItemJsonBytes};
+    return Message{kPageJsonBytes, kPageJsonBytes};
+}
+
+struct Result
+{
+    size_t freeBytes;
+    size_t largestFree;
+    size_t minLargestFree;   // between messages
+    size_t minInFlightFree;  // while one is being handled
+    size_t docAllocs;        // documents taken from the heap after boot
+    size_t failures;
+};
+
+void
+report(const char* label, const Result& r)
+{
+    const unsigned frag =
+        r.freeBytes ? (unsigned)(100 - (uint64_t)r.largestFree * 100 / r.freeBytes) : 0;
+    printf(
+        "BENCH {\"bench\":\"heap.soak\",\"case\":\"%s\",\"messages\":%u,\"heapBytes\":%u,"
+        "\"freeBytes\":%u,\"largestFree\":%u,\"minLargestFree\":%u,"
+        "\"minInFlightFree\":%u,\"fragPct\":%u,\"docAllocs\":%u,\"failedAllocs\":%u}\n",
+        label, (unsigned)kMessages, (unsigned)kHeapBytes, (unsigned)r.freeBytes,
+        (unsigned)r.largestFree, (unsigned)r.minLargestFree, (unsigned)r.minInFlightFree, frag,
+        (unsigned)r.docAllocs, (unsigned)r.failures
+    );
+}
+
+// Replays the soak. With `useArenas` documents are leased as the services
+// do now, and only a fallback lease takes heap; otherwise every document is
+// allocated for its message and freed after it.
+Result
+soak(bool useArenas)
+{
+    SimHeap heap(kHeapBytes);
+    Lcg rng;
+
+    // Taken at boot, before anything else, like the services' members.
+    if (useArenas)
+    {
+        heap.alloc(kInboundJsonBytes);
+        heap.alloc(kPageJsonBytes);
+    }
+
+    std::vector<size_t> live(kLiveSlots, kNone);
+    size_t nextLive = 0;
+    size_t minLargest = heap.largestFree();
+    size_t minInFlight = minLargest;
+    size_t docAllocs = 0;
+
+    for (size_t i = 0; i < kMessages; ++i)
+    {
+        const Message m = nextMessage(rng);
+
+        // The payload as received, then the document.
+        const size_t payload = heap.alloc(16 + rng.next(384));
+
+        size_t doc = kNone;
+        if (!useArenas || m.docBytes > m.arenaBytes)
+        {
+            doc = heap.alloc(m.docBytes);
+            docAllocs++;
+        }
+
+        // Strings built while handling; one in four outlives the message
+        // and replaces the oldest survivor.
+        const size_t scratch = heap.alloc(16 + rng.next(96));
+        minInFlight = std::min(minInFlight, heap.largestFree());
+        if (rng.next(4) == 0)
+        {
+            heap.release(live[nextLive]);
+            live[nextLive] = heap.alloc(24 + rng.next(96));
+            nextLive = (nextLive + 1) % kLiveSlots;
+        }
+        heap.release(scratch);
+
+        heap.release(doc);
+        heap.release(payload);
+        minLargest = std::min(minLargest, heap.largestFree());
+    }
+
+    // Measured as a running device would be, survivors still held.
+    return Result{
+        heap.freeBytes(), heap.largestFree(), minLargest, minInFlight, docAllocs, heap.failures()};
+}
+} // namespace
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::ERROR);
+}
+
+void
+tearDown()
+{
+}
+
+void
+bench_fragmentation_soak()
+{
+    const Result fresh = soak(false);
+    report("fresh", fresh);
+
+    const Result arenas = soak(true);
+    report("arena", arenas);
+
+    // The arenas hold their size for good, so between messages the largest
+    // block is smaller by about that much. What they buy is the headroom the
+    // rest of the firmware sees while a message is handled: no document is
+    // taken from the heap, so the worst case does not dip below it.
+    TEST_ASSERT_EQUAL(kMessages, fresh.docAllocs);
+    TEST_ASSERT_EQUAL(0, arenas.docAllocs);
+    TEST_ASSERT_EQUAL(0, arenas.failures);
+    TEST_ASSERT_GREATER_OR_EQUAL(fresh.minInFlightFree, arenas.minInFlightFree);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_fragmentation_soak);
+    return UNITY_END();
+}
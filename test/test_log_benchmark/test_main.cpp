@@ -0,0 +1,127 @@
+// What a disabled log call costs. LOG_D under the default cap is compiled
+// out together with its arguments; calling Logger::debug() directly is how
+// every call site logged before the macros, filtered only at run time after
+// its arguments were built. Results are printed like test_benchmark's:
+//
+//   pio test -e native -f test_log_benchmark -v | grep '^BENCH ' | cut -c7-
+//
+// The flash side is measured on the firmware: compare the sizes printed by
+//
+//   pio run -e esp32dev -e esp32dev_logall
+
+// Debug calls in this file are always above the cap, whatever the build's.
+#define SL_LOG_FILE_LEVEL LOG_LEVEL_INFO
+
+#include "utils/Logger.h"
+
+#include <unity.h>
+
+#include <new>
+
+namespace
+{
+constexpr size_t kCalls = 100000;
+
+// A payload like the ones MqttService logs, cut like logPayloadTruncated_.
+const char* const kPayload =
+    "{\"action\":\"add\",\"type\":\"timed\",\"code\":\"12345678\",\"effectiveAt\":1700000000}";
+
+size_t s_allocs = 0;
+size_t s_evaluations = 0;
+
+String
+preview(const String& payload)
+{
+    s_evaluations++;
+    return payload.substring(0, 32) + "...";
+}
+
+struct Counters
+{
+    unsigned long us;
+    size_t allocs;
+    size_t evaluations;
+
+    static Counters
+    now()
+    {
+        return Counters{micros(), s_allocs, s_evaluations};
+    }
+};
+
+// Returns how many times the arguments were evaluated.
+size_t
+report(const char* label, const Counters& start)
+{
+    const Counters end = Counters::now();
+    const size_t evaluations = end.evaluations - start.evaluations;
+    printf(
+        "BENCH {\"bench\":\"log.disabled\",\"case\":\"%s\",\"ops\":%u,\"usPerOp\":%.4f,"
+        "\"allocsPerOp\":%.2f,\"argsEvaluatedPerOp\":%.2f}\n",
+        label, (unsigned)kCalls, (double)(end.us - start.us) / kCalls,
+        (double)(end.allocs - start.allocs) / kCalls, (double)evaluations / kCalls
+    );
+    return evaluations;
+}
+} // namespace
+
+// Counts every heap allocation made through new, which is what String uses.
+void*
+operator new(size_t n)
+{
+    s_allocs++;
+    if (void* p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::INFO);
+    ArduinoShim::takeSerial();
+}
+
+void
+tearDown()
+{
+}
+
+void
+bench_disabled_debug_calls()
+{
+    const String payload(kPayload);
+
+    Counters start = Counters::now();
+    for (size_t i = 0; i < kCalls; ++i)
+        LOG_D("MQTT", "payload #%u: %s", (unsigned)i, preview(payload).c_str());
+    TEST_ASSERT_EQUAL(0, report("LOG_D", start));
+    TEST_ASSERT_EQUAL(0, s_allocs - start.allocs);
+
+    start = Counters::now();
+    for (size_t i = 0; i < kCalls; ++i)
+        Logger::debug("MQTT", "payload #%u: %s", (unsigned)i, preview(payload).c_str());
+    TEST_ASSERT_EQUAL(kCalls, report("Logger::debug", start));
+
+    TEST_ASSERT_EQUAL_STRING("", ArduinoShim::takeSerial().c_str());
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_disabled_debug_calls);
+    return UNITY_END();
+}
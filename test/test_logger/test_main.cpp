@@ -0,0 +1,185 @@
+#include "utils/Logger.h"
+
+#include <unity.h>
+
+#include <string>
+
+namespace
+{
+// Serial output until `lines` lines have been written, or 2 s have passed.
+std::string
+awaitLines(size_t lines)
+{
+    std::string out;
+    const unsigned long start = millis();
+    while ((size_t)std::count(out.begin(), out.end(), '\n') < lines && millis() - start < 2000)
+    {
+        out += ArduinoShim::takeSerial();
+        delay(5);
+    }
+    return out;
+}
+
+std::string
+expected(const char* level, const char* tag, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+std::string
+expected(const char* level, const char* tag, const char* fmt, ...)
+{
+    char msg[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    return std::string("[") + level + "][" + tag + "] " + msg + "\n";
+}
+
+// Logs through the drain task and compares with what vsnprintf makes of the
+// same format and arguments.
+#define CHECK_RENDERS_LIKE_PRINTF(fmt, ...)                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        Logger::info("FMT", fmt, __VA_ARGS__);                                                     \
+        TEST_ASSERT_EQUAL_STRING(                                                                  \
+            expected("I", "FMT", fmt, __VA_ARGS__).c_str(), awaitLines(1).c_str()                  \
+        );                                                                                         \
+    } while (0)
+} // namespace
+
+void
+setUp()
+{
+    ArduinoShim::takeSerial();
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_synchronous_before_begin()
+{
+    Logger::warn("BOOT", "early %d", 42);
+    TEST_ASSERT_EQUAL_STRING("[W][BOOT] early 42\n", ArduinoShim::takeSerial().c_str());
+}
+
+void
+test_runtime_level_filters()
+{
+    Logger::debug("BOOT", "hidden");
+    TEST_ASSERT_EQUAL_STRING("", ArduinoShim::takeSerial().c_str());
+
+    Logger::setLevel(LogLevel::DEBUG);
+    Logger::debug("BOOT", "shown");
+    Logger::setLevel(LogLevel::INFO);
+    TEST_ASSERT_EQUAL_STRING("[D][BOOT] shown\n", ArduinoShim::takeSerial().c_str());
+}
+
+// From here on messages are captured into the ring and rendered by the task.
+void
+test_begin_defers_output()
+{
+    Logger::begin();
+    Logger::error("NET", "lost after %u ms", 1500u);
+    TEST_ASSERT_EQUAL_STRING("[E][NET] lost after 1500 ms\n", awaitLines(1).c_str());
+}
+
+void
+test_integer_conversions()
+{
+    CHECK_RENDERS_LIKE_PRINTF("%d %i %u %x %X %o", -7, 12, 3000000000u, 0xBEEFu, 0xBEEFu, 8u);
+    CHECK_RENDERS_LIKE_PRINTF("%ld %lu %lld %llu", -70000L, 70000UL, -(1LL << 40), 1ULL << 63);
+    CHECK_RENDERS_LIKE_PRINTF("%zu %hhd %hu %+d % d", (size_t)123, -5, 65535, 4, 4);
+    CHECK_RENDERS_LIKE_PRINTF("[%6d] [%-6d] [%06d] [%#x]", 42, 42, -42, 255u);
+}
+
+void
+test_float_char_pointer_conversions()
+{
+    CHECK_RENDERS_LIKE_PRINTF("%f %.2f %8.3f %e %g", 3.5, 2.0 / 3.0, -1.25, 12345.678, 0.0001);
+    CHECK_RENDERS_LIKE_PRINTF("%c%c 100%% %p", 'o', 'k', (void*)0x1234);
+}
+
+void
+test_star_width_and_precision()
+{
+    CHECK_RENDERS_LIKE_PRINTF("[%*d] [%-*d] [%.*f] [%.*s]", 5, 1, 4, 2, 3, 3.14159, 2, "abc");
+}
+
+void
+test_strings_are_copied()
+{
+    char buf[16];
+    strcpy(buf, "before");
+    Logger::info("STR", "[%s] [%8s] [%-8s] [%.3s]", buf, buf, buf, buf);
+    strcpy(buf, "after!");
+
+    TEST_ASSERT_EQUAL_STRING(
+        "[I][STR] [before] [  before] [before  ] [bef]\n", awaitLines(1).c_str()
+    );
+
+    const char* nothing = nullptr;
+    Logger::info("STR", "%s", nothing);
+    TEST_ASSERT_EQUAL_STRING("[I][STR] (null)\n", awaitLines(1).c_str());
+}
+
+void
+test_long_argument_is_cut_and_marked()
+{
+    std::string big(300, 'x');
+    Logger::info("CUT", "len=%u %s tail=%d", 300u, big.c_str(), 1);
+
+    const std::string out = awaitLines(1);
+    TEST_ASSERT_EQUAL_STRING("[I][CUT] len=300 x", out.substr(0, 18).c_str());
+    TEST_ASSERT_EQUAL_STRING("...\n", out.substr(out.size() - 4).c_str());
+    TEST_ASSERT_LESS_THAN(200, out.size());
+}
+
+void
+test_unsupported_conversion_stops_rendering()
+{
+    Logger::info("BAD", "ok=%d then %Lf", 1, 2.0L);
+    TEST_ASSERT_EQUAL_STRING("[I][BAD] ok=1 then ...\n", awaitLines(1).c_str());
+}
+
+// A burst larger than the ring loses messages rather than blocking; every
+// message is either printed or counted, and the loss is reported.
+void
+test_overflow_is_counted_and_reported()
+{
+    constexpr int kBurst = 500;
+    const uint32_t droppedBefore = Logger::dropped();
+
+    for (int i = 0; i < kBurst; ++i)
+        Logger::info("BURST", "message %d", i);
+
+    const uint32_t dropped = Logger::dropped() - droppedBefore;
+    const std::string out = awaitLines(kBurst - dropped + (dropped ? 1 : 0));
+
+    size_t printed = 0;
+    for (size_t at = 0; (at = out.find("[I][BURST]", at)) != std::string::npos; ++at)
+        printed++;
+
+    TEST_ASSERT_EQUAL(kBurst, printed + dropped);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_TRUE(out.find("[W][LOG] ") != std::string::npos);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_synchronous_before_begin);
+    RUN_TEST(test_runtime_level_filters);
+    RUN_TEST(test_begin_defers_output);
+    RUN_TEST(test_integer_conversions);
+    RUN_TEST(test_float_char_pointer_conversions);
+    RUN_TEST(test_star_width_and_precision);
+    RUN_TEST(test_strings_are_copied);
+    RUN_TEST(test_long_argument_is_cut_and_marked);
+    RUN_TEST(test_unsupported_conversion_stops_rendering);
+    RUN_TEST(test_overflow_is_counted_and_reported);
+    return UNITY_END();
+}
@@ -0,0 +1,380 @@
+// Timings for the MQTT side of the app loop, against the loopback
+// MqttManager (test/native/MqttLoopback): routing and handling one inbound
+// message per topic, and publishing the passcode and card lists at 10 to
+// 5000 entries. Results are printed like test_benchmark's:
+//
+//   pio test -e native -f test_mqtt_benchmark -v | grep '^BENCH ' | cut -c7-
+//
+// Host timings are only comparable with each other. "pubBytes" is what went
+// to the broker, so it also compares JSON with MessagePack. mqtt.route.strings
+// is the routing dispatch_ did before its table, for reference.
+
+#include "app/AppContext.h"
+#include "app/services/MqttService.h"
+#include "app/services/PublishService.h"
+#include "app/services/Topics.h"
+#include "hardware/DoorHardware.h"
+#include "network/MqttManager.h"
+#include "storage/FileSystem.h"
+#include "utils/Logger.h"
+
+#include <MqttLoopback.h>
+#include <SPIFFS.h>
+#include <unity.h>
+
+#include <new>
+#include <vector>
+
+namespace
+{
+const size_t kSizes[] = {10, 100, 1000, 5000};
+
+// Messages per topic; handlers that write flash get fewer.
+constexpr size_t kMessages = 500;
+constexpr size_t kWrites = 10;
+
+// No list is anywhere near this many pages.
+constexpr size_t kMaxLoops = 10000;
+
+size_t s_allocs = 0;
+size_t s_allocBytes = 0;
+
+struct Counters
+{
+    unsigned long us;
+    size_t allocs;
+    size_t allocBytes;
+    uint32_t flashBytes;
+    size_t pubMessages;
+    size_t pubBytes;
+
+    static Counters
+    now()
+    {
+        return Counters{
+            micros(),
+            s_allocs,
+            s_allocBytes,
+            FileSystem::bytesWritten(),
+            MqttLoopback::publishedCount(),
+            MqttLoopback::publishedBytes()};
+    }
+};
+
+void
+report(const char* bench, const char* label, size_t n, size_t ops, const Counters& start)
+{
+    const Counters end = Counters::now();
+    printf(
+        "BENCH {\"bench\":\"%s\",\"case\":\"%s\",\"n\":%u,\"ops\":%u,\"usPerOp\":%.3f,"
+        "\"allocsPerOp\":%.2f,\"allocBytesPerOp\":%.1f,\"flashBytesPerOp\":%.1f,"
+        "\"pubPerOp\":%.2f,\"pubBytesPerOp\":%.1f}\n",
+        bench, label, (unsigned)n, (unsigned)ops, (double)(end.us - start.us) / ops,
+        (double)(end.allocs - start.allocs) / ops,
+        (double)(end.allocBytes - start.allocBytes) / ops,
+        (double)(end.flashBytes - start.flashBytes) / ops,
+        (double)(end.pubMessages - start.pubMessages) / ops,
+        (double)(end.pubBytes - start.pubBytes) / ops
+    );
+}
+
+String
+uidFor(size_t i)
+{
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08X", (unsigned)(0x10000000u + i * 2654435761u % 0x0FFFFFFFu));
+    return String(hex);
+}
+
+String
+codeFor(size_t i)
+{
+    return String((unsigned long)(10000000 + i));
+}
+
+// The app as App.cpp wires it, minus the hardware loops and the network task.
+struct Rig
+{
+    AppState app;
+    LockConfig config;
+    PasscodeRepository passcodes;
+    CardRepository cards;
+    PublishService publish;
+    Servo servo;
+    DoorHardware door;
+    AppContext ctx;
+    MqttService mqtt;
+
+    Rig()
+        : publish(app, passcodes, cards, config), door(servo, 2, 13, 4, true, 50),
+          ctx{app, publish}, mqtt(app, passcodes, cards, publish, config, door)
+    {
+        app.init("AA:BB:CC:DD:EE:FF");
+        passcodes.load();
+        cards.load();
+        publish.begin();
+        door.begin(ctx);
+        mqtt.attachCallback();
+    }
+
+    // Runs publish loops until one sends nothing; returns the loops run.
+    size_t
+    drain()
+    {
+        size_t loops = 0;
+        for (; loops < kMaxLoops; ++loops)
+        {
+            const size_t before = MqttLoopback::publishedCount();
+            publish.loop();
+            publish.flush();
+            if (MqttLoopback::publishedCount() == before)
+                break;
+        }
+        return loops;
+    }
+};
+
+void
+fill(Rig& rig, size_t n)
+{
+    std::vector<Passcode> items(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        items[i].code = codeFor(i);
+        items[i].type = "timed";
+        items[i].effectiveAt = 0;
+        items[i].expireAt = 0;
+    }
+    rig.passcodes.setItems(items, 1);
+
+    for (size_t i = 0; i < n; ++i)
+        rig.cards.add(uidFor(i), "Card");
+}
+
+Topics::Topic
+topicFor(const Rig& rig, const char* suffix)
+{
+    return Topics::join(rig.app.mqttTopicPrefix, suffix);
+}
+
+// Times dispatchInbound() alone, `ops` messages; whatever they start (list
+// pages, event batches) is drained outside the measurement. Returns the
+// allocations dispatching made.
+template <typename Payload>
+size_t
+benchTopic(Rig& rig, const char* suffix, size_t ops, Payload payloadFor)
+{
+    const Topics::Topic topic = topicFor(rig, suffix);
+    std::vector<String> payloads;
+    payloads.reserve(ops);
+    for (size_t i = 0; i < ops; ++i)
+        payloads.push_back(payloadFor(i));
+
+    const Counters start = Counters::now();
+    unsigned long us = 0;
+    size_t allocs = 0;
+    size_t allocBytes = 0;
+    for (size_t i = 0; i < ops; ++i)
+    {
+        MqttLoopback::inject(topic.c_str(), payloads[i].c_str());
+
+        const Counters t0 = Counters::now();
+        MqttManager::dispatchInbound();
+        us += micros() - t0.us;
+        allocs += s_allocs - t0.allocs;
+        allocBytes += s_allocBytes - t0.allocBytes;
+
+        rig.drain();
+    }
+
+    // Time and allocations are the dispatch's own; flash and publishes
+    // include the drain, so replies are accounted for.
+    const Counters end = Counters::now();
+    Counters adjusted = start;
+    adjusted.us = end.us - us;
+    adjusted.allocs = end.allocs - allocs;
+    adjusted.allocBytes = end.allocBytes - allocBytes;
+    report("mqtt.dispatch", suffix, rig.passcodes.listItems().size(), ops, adjusted);
+    return allocs;
+}
+
+// How dispatch_ routed before the table: the prefix copied, every topic
+// concatenated as a String and compared in turn, the message copied into
+// Strings first. Returns the matching suffix's position, or -1.
+int
+routeByStrings(const String& prefix, const char* topic, const uint8_t* payload, size_t length)
+{
+    static const char* const kOrder[] = {
+        Topics::Suffix::PASSCODES,      Topics::Suffix::PASSCODES_REQ,
+        Topics::Suffix::PASSCODES_SYNC, Topics::Suffix::ICCARDS,
+        Topics::Suffix::ICCARDS_REQ,    Topics::Suffix::ICCARDS_SYNC,
+        Topics::Suffix::CONTROL,        Topics::Suffix::INFO,
+        Topics::Suffix::BATTERY_REQ,    Topics::Suffix::DIAGNOSTICS_REQ};
+
+    const String topicStr(topic);
+    String payloadStr;
+    for (size_t i = 0; i < length; ++i)
+        payloadStr += (char)payload[i];
+
+    const String base = prefix;
+    for (size_t i = 0; i < sizeof(kOrder) / sizeof(kOrder[0]); ++i)
+    {
+        if (topicStr == base + kOrder[i])
+            return (int)i;
+    }
+    return -1;
+}
+
+Rig* s_rig = nullptr;
+} // namespace
+
+// Counts every heap allocation made through new, which is what String and
+// the standard containers use.
+void*
+operator new(size_t n)
+{
+    s_allocs++;
+    s_allocBytes += n;
+    if (void* p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::ERROR);
+    SPIFFS.format();
+    MqttLoopback::clear();
+    MqttLoopback::keepPayloads(false);
+    MqttLoopback::connect();
+    s_rig = new Rig();
+}
+
+void
+tearDown()
+{
+    delete s_rig;
+    s_rig = nullptr;
+    MqttLoopback::disconnect();
+}
+
+void
+bench_dispatch_per_topic()
+{
+    Rig& rig = *s_rig;
+    fill(rig, 100);
+    rig.drain();
+
+    auto fixed = [](const char* json) { return [json](size_t) { return String(json); }; };
+
+    benchTopic(
+        rig, Topics::Suffix::PASSCODES, kWrites,
+        [](size_t i)
+        {
+            return "{\"action\":\"add\",\"type\":\"timed\",\"code\":\"" + codeFor(100000 + i) +
+                   "\"}";
+        }
+    );
+    benchTopic(
+        rig, Topics::Suffix::ICCARDS, kWrites,
+        [](size_t i) { return "{\"action\":\"add\",\"uid\":\"" + uidFor(100000 + i) + "\"}"; }
+    );
+    benchTopic(rig, Topics::Suffix::PASSCODES_REQ, kWrites, fixed("{}"));
+    benchTopic(rig, Topics::Suffix::ICCARDS_REQ, kWrites, fixed("{}"));
+    benchTopic(rig, Topics::Suffix::PASSCODES_SYNC, kMessages, fixed("{\"since\":0}"));
+    benchTopic(rig, Topics::Suffix::ICCARDS_SYNC, kMessages, fixed("{\"since\":0}"));
+    benchTopic(rig, Topics::Suffix::CONTROL, kMessages, fixed("{\"action\":\"lock\"}"));
+    benchTopic(rig, Topics::Suffix::INFO, kMessages, fixed("{\"encoding\":\"json\"}"));
+    benchTopic(rig, Topics::Suffix::BATTERY_REQ, kMessages, fixed("{}"));
+    benchTopic(rig, Topics::Suffix::DIAGNOSTICS_REQ, kMessages, fixed("{}"));
+
+    // Routing alone: a topic under the prefix that no route takes is
+    // compared with the whole table, and must not allocate.
+    TEST_ASSERT_EQUAL(0, benchTopic(rig, "/unknown", kMessages, fixed("{}")));
+}
+
+// The same messages routed the old way, for comparison with the table.
+void
+bench_route_by_strings()
+{
+    Rig& rig = *s_rig;
+    struct Case
+    {
+        const char* suffix;
+        int route;
+    };
+    const Case cases[] = {
+        {Topics::Suffix::PASSCODES, 0}, {Topics::Suffix::DIAGNOSTICS_REQ, 9}, {"/unknown", -1}};
+    const uint8_t payload[] = "{\"since\":0}";
+
+    for (const Case& c : cases)
+    {
+        const Topics::Topic topic = topicFor(rig, c.suffix);
+        bool agrees = true;
+        const Counters start = Counters::now();
+        for (size_t i = 0; i < kMessages; ++i)
+        {
+            const int route = routeByStrings(
+                rig.app.mqttTopicPrefix, topic.c_str(), payload, sizeof(payload) - 1
+            );
+            agrees = agrees && route == c.route;
+        }
+        report("mqtt.route.strings", c.suffix, 0, kMessages, start);
+        TEST_ASSERT_TRUE(agrees);
+    }
+}
+
+void
+bench_publish_lists()
+{
+    for (size_t n : kSizes)
+    {
+        // One rig per size: the lists are built up front, outside the timing.
+        tearDown();
+        setUp();
+        Rig& rig = *s_rig;
+        fill(rig, n);
+        rig.drain();
+
+        for (WireFormat format : {WireFormat::Json, WireFormat::MsgPack})
+        {
+            rig.app.wireFormat = format;
+            const char* name = WireCodec::name(format);
+
+            Counters start = Counters::now();
+            rig.publish.publishPasscodeList();
+            const size_t passcodeLoops = rig.drain();
+            report("publish.passcodeList", name, n, 1, start);
+            TEST_ASSERT_LESS_THAN(kMaxLoops, passcodeLoops);
+
+            start = Counters::now();
+            rig.publish.publishICCardList();
+            const size_t cardLoops = rig.drain();
+            report("publish.icCardList", name, n, 1, start);
+            TEST_ASSERT_LESS_THAN(kMaxLoops, cardLoops);
+        }
+    }
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_dispatch_per_topic);
+    RUN_TEST(bench_route_by_strings);
+    RUN_TEST(bench_publish_lists);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+#include "storage/PasscodeIndex.h"
+
+#include <unity.h>
+
+#include <vector>
+
+namespace
+{
+// Mirrors PasscodeRepository: the index maps tags to positions in a vector,
+// and a tag hit is confirmed against the full item. FNV-1a stands in for the
+// digest; `tagMask` forces collisions.
+struct Model
+{
+    PasscodeIndex index;
+    std::vector<String> items;
+    uint32_t tagMask;
+
+    explicit Model(uint32_t mask = 0xFFFFFFFFu) : tagMask(mask)
+    {
+        index.clear();
+    }
+
+    uint32_t
+    tagOf(const String& code) const
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < code.length(); ++i)
+            h = (h ^ (uint8_t)code[i]) * 16777619u;
+        return h & tagMask;
+    }
+
+    void
+    add(const String& code)
+    {
+        index.insert(tagOf(code), (uint16_t)items.size());
+        items.push_back(code);
+    }
+
+    int
+    find(const String& code) const
+    {
+        return index.find(tagOf(code), [&](uint16_t pos) { return items[pos] == code; });
+    }
+
+    void
+    removeAt(size_t pos)
+    {
+        index.eraseAndShift(tagOf(items[pos]), (uint16_t)pos);
+        items.erase(items.begin() + pos);
+    }
+
+    int
+    linearFind(const String& code) const
+    {
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            if (items[i] == code)
+                return (int)i;
+        }
+        return -1;
+    }
+};
+
+String
+codeFor(long n)
+{
+    return String(100000 + n);
+}
+} // namespace
+
+void
+setUp()
+{
+    ArduinoShim::seedRandom(1);
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_empty_index_finds_nothing()
+{
+    Model m;
+    TEST_ASSERT_EQUAL(-1, m.find("1234"));
+    TEST_ASSERT_EQUAL(0, m.index.size());
+}
+
+void
+test_finds_every_inserted_code()
+{
+    Model m;
+    for (long i = 0; i < 500; ++i)
+        m.add(codeFor(i));
+
+    TEST_ASSERT_EQUAL(500, m.index.size());
+    for (long i = 0; i < 500; ++i)
+        TEST_ASSERT_EQUAL((int)i, m.find(codeFor(i)));
+    TEST_ASSERT_EQUAL(-1, m.find(codeFor(500)));
+}
+
+void
+test_duplicate_code_resolves_to_lowest_position()
+{
+    Model m;
+    m.add("1111");
+    m.add("2222");
+    m.add("1111");
+
+    TEST_ASSERT_EQUAL(0, m.find("1111"));
+
+    m.removeAt(0);
+    TEST_ASSERT_EQUAL(1, m.find("1111"));
+    TEST_ASSERT_EQUAL(0, m.find("2222"));
+}
+
+void
+test_erase_shifts_later_positions()
+{
+    Model m;
+    for (long i = 0; i < 40; ++i)
+        m.add(codeFor(i));
+
+    m.removeAt(10);
+    TEST_ASSERT_EQUAL(-1, m.find(codeFor(10)));
+    TEST_ASSERT_EQUAL(9, m.find(codeFor(9)));
+    TEST_ASSERT_EQUAL(10, m.find(codeFor(11)));
+    TEST_ASSERT_EQUAL(38, m.find(codeFor(39)));
+}
+
+// Tags are only 32 bits of the digest; equal tags must still find the
+// right item.
+void
+test_tag_collisions_are_confirmed()
+{
+    Model m(0x3);
+    for (long i = 0; i < 100; ++i)
+        m.add(codeFor(i));
+
+    for (long i = 0; i < 100; ++i)
+        TEST_ASSERT_EQUAL((int)i, m.find(codeFor(i)));
+    TEST_ASSERT_EQUAL(-1, m.find(codeFor(100)));
+
+    m.removeAt(50);
+    TEST_ASSERT_EQUAL(-1, m.find(codeFor(50)));
+    TEST_ASSERT_EQUAL(50, m.find(codeFor(51)));
+}
+
+// Random adds and removes against a linear search. The table stays small
+// enough that clusters regularly wrap past the end, which is where the
+// backward-shift delete can go wrong.
+void
+test_backward_shift_delete_matches_linear_search()
+{
+    Model m;
+    bool agrees = true;
+
+    for (int step = 0; step < 20000 && agrees; ++step)
+    {
+        const String code = codeFor(random(0, 64));
+        if (random(0, 3) < 2 && m.items.size() < 40)
+        {
+            m.add(code);
+        }
+        else
+        {
+            const int pos = m.linearFind(code);
+            agrees = m.find(code) == pos;
+            if (pos >= 0)
+                m.removeAt((size_t)pos);
+        }
+
+        agrees = agrees && m.index.size() == m.items.size();
+    }
+    TEST_ASSERT_TRUE(agrees);
+
+    for (long i = 0; i < 64; ++i)
+        TEST_ASSERT_EQUAL(m.linearFind(codeFor(i)), m.find(codeFor(i)));
+}
+
+void
+test_clear_forgets_everything()
+{
+    Model m;
+    for (long i = 0; i < 20; ++i)
+        m.add(codeFor(i));
+
+    m.index.clear();
+    m.items.clear();
+    TEST_ASSERT_EQUAL(0, m.index.size());
+    TEST_ASSERT_EQUAL(-1, m.find(codeFor(3)));
+
+    m.add(codeFor(3));
+    TEST_ASSERT_EQUAL(0, m.find(codeFor(3)));
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_index_finds_nothing);
+    RUN_TEST(test_finds_every_inserted_code);
+    RUN_TEST(test_duplicate_code_resolves_to_lowest_position);
+    RUN_TEST(test_erase_shifts_later_positions);
+    RUN_TEST(test_tag_collisions_are_confirmed);
+    RUN_TEST(test_backward_shift_delete_matches_linear_search);
+    RUN_TEST(test_clear_forgets_everything);
+    return UNITY_END();
+}
@@ -0,0 +1,285 @@
+#include "storage/FileSystem.h"
+#include "storage/PasscodeRepository.h"
+#include "storage/RecordFile.h"
+
+#include <SPIFFS.h>
+#include <unity.h>
+
+namespace
+{
+constexpr const char* SNAPSHOT = AppPaths::PASSCODES_BIN;
+constexpr const char* JOURNAL = AppPaths::PASSCODES_JOURNAL;
+
+// Matches kCompactRecords in PasscodeRepository.cpp.
+constexpr int kCompactRecords = 64;
+
+Passcode
+passcode(const char* code, const char* type = "timed")
+{
+    Passcode p;
+    p.code = code;
+    p.type = type;
+    p.effectiveAt = 0;
+    p.expireAt = 0;
+    return p;
+}
+
+String
+codeFor(int n)
+{
+    return String(200000 + n);
+}
+
+// The repository only holds digests, so tests ask it which of the codes
+// they know about it still has.
+const char* const kProbe[] = {"1111", "2222", "3333", "4444", "9999"};
+
+// Probe codes present, comma separated; the item count must agree, so
+// nothing unexpected is stored either.
+String
+codes(const PasscodeRepository& repo)
+{
+    String out;
+    size_t found = 0;
+    for (const char* code : kProbe)
+    {
+        if (!repo.containsCode(code))
+            continue;
+        if (!out.isEmpty())
+            out += ",";
+        out += code;
+        found++;
+    }
+    if (found != repo.listItems().size())
+        out += ",?";
+    return out;
+}
+
+String
+reloaded()
+{
+    PasscodeRepository repo;
+    repo.load();
+    return codes(repo);
+}
+
+bool
+onFlash(const char* path, const char* text)
+{
+    return SPIFFS.exists(path) && SPIFFS.contents(path).find(text) != std::string::npos;
+}
+} // namespace
+
+void
+setUp()
+{
+    SPIFFS.format();
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_changes_go_to_the_journal_only()
+{
+    PasscodeRepository repo;
+    repo.load();
+    TEST_ASSERT_TRUE(repo.addItem(passcode("1111")));
+    TEST_ASSERT_TRUE(repo.addItem(passcode("2222")));
+    TEST_ASSERT_TRUE(repo.removeItemByCode("1111"));
+
+    TEST_ASSERT_FALSE(SPIFFS.exists(SNAPSHOT));
+    TEST_ASSERT_TRUE(SPIFFS.exists(JOURNAL));
+    TEST_ASSERT_EQUAL_STRING("2222", reloaded().c_str());
+}
+
+void
+test_replay_on_top_of_snapshot()
+{
+    PasscodeRepository repo;
+    repo.load();
+    repo.addItem(passcode("1111"));
+    repo.addItem(passcode("2222"));
+    TEST_ASSERT_TRUE(repo.setMaster("9999"));
+
+    // The snapshot took over everything the journal held.
+    TEST_ASSERT_TRUE(SPIFFS.exists(SNAPSHOT));
+    TEST_ASSERT_FALSE(SPIFFS.exists(JOURNAL));
+
+    repo.addItem(passcode("3333", "one_time"));
+    repo.removeItemByCode("1111");
+    TEST_ASSERT_TRUE(repo.validateAndConsume("3333", 4, 1000));
+    const uint32_t rev = repo.rev();
+
+    PasscodeRepository again;
+    TEST_ASSERT_TRUE(again.load());
+    TEST_ASSERT_EQUAL_STRING("2222", codes(again).c_str());
+    TEST_ASSERT_TRUE(again.hasMaster());
+    TEST_ASSERT_TRUE(again.matchesMaster("9999", 4));
+    TEST_ASSERT_FALSE(again.matchesMaster("2222", 4));
+    TEST_ASSERT_EQUAL_UINT32(rev, again.rev());
+}
+
+// A reboot between writing the snapshot and removing the journal replays
+// records the snapshot already holds.
+void
+test_replay_is_idempotent()
+{
+    PasscodeRepository repo;
+    repo.load();
+    repo.addItem(passcode("1111"));
+    repo.addItem(passcode("2222"));
+    const std::string journal = SPIFFS.contents(JOURNAL);
+
+    repo.setMaster("9999");
+    SPIFFS.contents(JOURNAL) = journal;
+
+    TEST_ASSERT_EQUAL_STRING("1111,2222", reloaded().c_str());
+}
+
+void
+test_torn_journal_tail_keeps_the_prefix()
+{
+    PasscodeRepository repo;
+    repo.load();
+    repo.addItem(passcode("1111"));
+    repo.addItem(passcode("2222"));
+    repo.addItem(passcode("3333"));
+
+    std::string& raw = SPIFFS.contents(JOURNAL);
+    raw.resize(raw.size() - 2);
+
+    PasscodeRepository again;
+    again.load();
+    TEST_ASSERT_EQUAL_STRING("1111,2222", codes(again).c_str());
+
+    // Folded straight away so later appends are not stranded behind the tear.
+    TEST_ASSERT_FALSE(SPIFFS.exists(JOURNAL));
+    again.addItem(passcode("4444"));
+    TEST_ASSERT_EQUAL_STRING("1111,2222,4444", reloaded().c_str());
+}
+
+void
+test_journal_is_compacted()
+{
+    PasscodeRepository repo;
+    repo.load();
+    for (int i = 0; i < kCompactRecords; ++i)
+        repo.addItem(passcode(codeFor(i).c_str()));
+
+    TEST_ASSERT_FALSE(SPIFFS.exists(SNAPSHOT));
+    const size_t fullJournal = SPIFFS.contents(JOURNAL).size();
+
+    // The next change folds the journal into a fresh snapshot.
+    repo.addItem(passcode(codeFor(kCompactRecords).c_str()));
+    TEST_ASSERT_TRUE(SPIFFS.exists(SNAPSHOT));
+    TEST_ASSERT_FALSE(SPIFFS.exists(JOURNAL));
+
+    repo.removeItemByCode(codeFor(0));
+    TEST_ASSERT_LESS_THAN(fullJournal, SPIFFS.contents(JOURNAL).size());
+
+    PasscodeRepository again;
+    again.load();
+    TEST_ASSERT_EQUAL(kCompactRecords, again.listItems().size());
+    TEST_ASSERT_FALSE(again.containsCode(codeFor(0)));
+    TEST_ASSERT_TRUE(again.containsCode(codeFor(1)));
+    TEST_ASSERT_TRUE(again.containsCode(codeFor(kCompactRecords)));
+}
+
+void
+test_invalid_items_are_not_journaled()
+{
+    PasscodeRepository repo;
+    repo.load();
+    TEST_ASSERT_FALSE(repo.addItem(passcode("")));
+    TEST_ASSERT_FALSE(repo.addItem(passcode("1234", "forever")));
+    TEST_ASSERT_FALSE(SPIFFS.exists(JOURNAL));
+}
+
+void
+test_codes_never_reach_flash()
+{
+    PasscodeRepository repo;
+    repo.load();
+    repo.addItem(passcode("731904"));
+    repo.setMaster("558213");
+    repo.addItem(passcode("640027", "one_time"));
+    repo.removeItemByCode("731904");
+
+    TEST_ASSERT_TRUE(SPIFFS.exists(AppPaths::PASSCODES_KEY));
+    for (const char* code : {"731904", "558213", "640027"})
+    {
+        TEST_ASSERT_FALSE(onFlash(SNAPSHOT, code));
+        TEST_ASSERT_FALSE(onFlash(JOURNAL, code));
+    }
+
+    // The key persists, so the digests still match after a reboot.
+    PasscodeRepository again;
+    again.load();
+    TEST_ASSERT_TRUE(again.matchesMaster("558213", 6));
+    TEST_ASSERT_TRUE(again.containsCode("640027"));
+    TEST_ASSERT_FALSE(again.containsCode("731904"));
+}
+
+// Snapshots and journals from before hashing hold codes in the clear.
+void
+test_plaintext_files_are_rehashed()
+{
+    FileSystem::writeFileAtomic(
+        SNAPSHOT,
+        [](Print& out)
+        {
+            RecordFile::writeHeader(out, RecordFile::Kind::Passcodes);
+            RecordWriter meta(1);
+            meta.putU64(0).putString("9999").putU64(7);
+            meta.writeTo(out);
+            for (const char* code : {"1111", "2222"})
+            {
+                RecordWriter w(2);
+                w.putString(code).putU8(2).putU64(0).putU64(0);
+                w.writeTo(out);
+            }
+            return true;
+        }
+    );
+    FileSystem::writeFileAtomic(
+        JOURNAL,
+        [](Print& out)
+        {
+            RecordFile::writeHeader(out, RecordFile::Kind::PasscodeJournal);
+            RecordWriter rm(4);
+            rm.putString("1111");
+            rm.writeTo(out);
+            return true;
+        }
+    );
+
+    PasscodeRepository repo;
+    TEST_ASSERT_TRUE(repo.load());
+    TEST_ASSERT_EQUAL_STRING("2222", codes(repo).c_str());
+    TEST_ASSERT_TRUE(repo.matchesMaster("9999", 4));
+    TEST_ASSERT_EQUAL_UINT32(8, repo.rev());
+
+    // Saved again as digests straight away.
+    TEST_ASSERT_FALSE(SPIFFS.exists(JOURNAL));
+    TEST_ASSERT_FALSE(onFlash(SNAPSHOT, "9999"));
+    TEST_ASSERT_FALSE(onFlash(SNAPSHOT, "2222"));
+    TEST_ASSERT_EQUAL_STRING("2222", reloaded().c_str());
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_changes_go_to_the_journal_only);
+    RUN_TEST(test_replay_on_top_of_snapshot);
+    RUN_TEST(test_replay_is_idempotent);
+    RUN_TEST(test_torn_journal_tail_keeps_the_prefix);
+    RUN_TEST(test_journal_is_compacted);
+    RUN_TEST(test_invalid_items_are_not_journaled);
+    RUN_TEST(test_codes_never_reach_flash);
+    RUN_TEST(test_plaintext_files_are_rehashed);
+    return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// validateAndConsume must take as long for any wrong code as for any other:
+// one keyed hash of the input and a probe of the digest index, whatever the
+// code is, how close it is to a stored one, and how many codes are stored.
+// Each case is timed in batches and compared by median, with generous
+// bounds so a busy host does not fail the suite.
+//
+// The throughput lines are printed like test_benchmark's:
+//
+//   pio test -e native -f test_passcode_timing -v | grep '^BENCH ' | cut -c7-
+
+#include "storage/PasscodeRepository.h"
+#include "utils/Logger.h"
+
+#include <SPIFFS.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+constexpr size_t kBatch = 200;
+constexpr size_t kRounds = 31;
+
+// Slowest case over fastest; real leaks (a scan, an early-exit compare)
+// differ by far more than this at 1000 codes.
+constexpr double kMaxRatio = 1.5;
+
+constexpr long kNow = 1000;
+
+String
+codeFor(size_t i)
+{
+    return String((unsigned long)(10000000 + i));
+}
+
+void
+fill(PasscodeRepository& repo, size_t n)
+{
+    SPIFFS.format();
+    repo.load();
+
+    // Timed codes stay valid, so a hit can be repeated.
+    std::vector<Passcode> items(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        items[i].code = codeFor(i);
+        items[i].type = "timed";
+        items[i].effectiveAt = 0;
+        items[i].expireAt = 0;
+    }
+    repo.setItems(items, 1);
+}
+
+// Median microseconds per validation of `code`, or -1 if any result was
+// not `expect`.
+double
+medianUs(PasscodeRepository& repo, const char* code, bool expect)
+{
+    const size_t len = strlen(code);
+    std::vector<double> rounds;
+    rounds.reserve(kRounds);
+
+    bool agrees = true;
+    for (size_t r = 0; r < kRounds; ++r)
+    {
+        const unsigned long start = micros();
+        for (size_t i = 0; i < kBatch; ++i)
+            agrees = agrees && repo.validateAndConsume(code, len, kNow) == expect;
+        rounds.push_back((double)(micros() - start) / kBatch);
+    }
+    if (!agrees)
+        return -1;
+
+    std::nth_element(rounds.begin(), rounds.begin() + kRounds / 2, rounds.end());
+    return rounds[kRounds / 2];
+}
+
+void
+assertClose(double a, double b)
+{
+    TEST_ASSERT_TRUE_MESSAGE(a >= 0 && b >= 0, "wrong validation result");
+
+    const double hi = std::max(a, b);
+    const double lo = std::max(std::min(a, b), 0.001);
+    TEST_ASSERT_TRUE_MESSAGE(hi / lo <= kMaxRatio, "timings differ");
+}
+} // namespace
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::ERROR);
+}
+
+void
+tearDown()
+{
+}
+
+// A guess sharing every digit but the last with a stored code is rejected
+// as fast as one sharing none, or one of another length.
+void
+test_miss_time_does_not_depend_on_the_guess()
+{
+    PasscodeRepository repo;
+    fill(repo, 1000);
+
+    const String stored = codeFor(500);
+    const String near = stored.substring(0, stored.length() - 1) + "x";
+
+    const double nearUs = medianUs(repo, near.c_str(), false);
+    const double farUs = medianUs(repo, "99999999", false);
+    const double shortUs = medianUs(repo, "1", false);
+
+    assertClose(nearUs, farUs);
+    assertClose(nearUs, shortUs);
+}
+
+void
+test_miss_time_does_not_depend_on_the_count()
+{
+    PasscodeRepository small;
+    fill(small, 10);
+    const double smallUs = medianUs(small, "99999999", false);
+
+    PasscodeRepository large;
+    fill(large, 5000);
+    const double largeUs = medianUs(large, "99999999", false);
+
+    assertClose(smallUs, largeUs);
+}
+
+// The first and last stored codes cost the same to find.
+void
+test_hit_time_does_not_depend_on_the_position()
+{
+    PasscodeRepository repo;
+    fill(repo, 1000);
+
+    const double firstUs = medianUs(repo, codeFor(0).c_str(), true);
+    const double lastUs = medianUs(repo, codeFor(999).c_str(), true);
+
+    assertClose(firstUs, lastUs);
+}
+
+// Keypad codes per second against 1000 stored: every stored code once,
+// then as many misses.
+void
+bench_throughput_1k()
+{
+    const size_t n = 1000;
+    PasscodeRepository repo;
+    fill(repo, n);
+
+    std::vector<String> codes;
+    codes.reserve(2 * n);
+    for (size_t i = 0; i < 2 * n; ++i)
+        codes.push_back(codeFor(i));
+
+    size_t hits = 0;
+    const unsigned long start = micros();
+    for (const String& code : codes)
+        hits += repo.validateAndConsume(code.c_str(), code.length(), kNow) ? 1 : 0;
+    const unsigned long us = micros() - start;
+
+    TEST_ASSERT_EQUAL(n, hits);
+    printf(
+        "BENCH {\"bench\":\"passcodes.validate.throughput\",\"n\":%u,\"ops\":%u,"
+        "\"usPerOp\":%.3f,\"opsPerSec\":%.0f}\n",
+        (unsigned)n, (unsigned)codes.size(), (double)us / codes.size(),
+        us ? codes.size() * 1e6 / us : 0.0
+    );
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_miss_time_does_not_depend_on_the_guess);
+    RUN_TEST(test_miss_time_does_not_depend_on_the_count);
+    RUN_TEST(test_hit_time_does_not_depend_on_the_position);
+    RUN_TEST(bench_throughput_1k);
+    return UNITY_END();
+}
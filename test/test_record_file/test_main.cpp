@@ -0,0 +1,221 @@
+#include "storage/RecordFile.h"
+
+#include <unity.h>
+
+#include <string>
+
+namespace
+{
+class MemoryStream : public Stream
+{
+  public:
+    std::string data;
+    size_t pos = 0;
+
+    size_t
+    write(uint8_t c) override
+    {
+        data.push_back((char)c);
+        return 1;
+    }
+
+    using Print::write;
+
+    int
+    available() override
+    {
+        return (int)(data.size() - pos);
+    }
+
+    int
+    read() override
+    {
+        return pos < data.size() ? (uint8_t)data[pos++] : -1;
+    }
+
+    int
+    peek() override
+    {
+        return pos < data.size() ? (uint8_t)data[pos] : -1;
+    }
+};
+
+void
+writeSample(MemoryStream& s)
+{
+    RecordWriter w(9);
+    w.putU8(7).putU64(0x0102030405060708ull).putString("hi");
+    TEST_ASSERT_TRUE(w.writeTo(s));
+}
+} // namespace
+
+void
+setUp()
+{
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_header_round_trip()
+{
+    MemoryStream s;
+    TEST_ASSERT_TRUE(RecordFile::writeHeader(s, RecordFile::Kind::Outbox));
+    TEST_ASSERT_EQUAL(RecordFile::HEADER_SIZE, s.data.size());
+    TEST_ASSERT_EQUAL_MEMORY("SLRF", s.data.data(), 4);
+
+    TEST_ASSERT_TRUE(RecordFile::readHeader(s, RecordFile::Kind::Outbox));
+
+    s.pos = 0;
+    TEST_ASSERT_FALSE(RecordFile::readHeader(s, RecordFile::Kind::Cards));
+}
+
+void
+test_header_rejects_other_version()
+{
+    MemoryStream s;
+    RecordFile::writeHeader(s, RecordFile::Kind::Cards);
+    s.data[4] = RecordFile::VERSION + 1;
+
+    TEST_ASSERT_FALSE(RecordFile::readHeader(s, RecordFile::Kind::Cards));
+}
+
+// Pins the on-flash layout: type, little-endian length, payload, CRC-32
+// (IEEE, as zlib) over all three.
+void
+test_record_layout_and_crc()
+{
+    MemoryStream s;
+    writeSample(s);
+
+    const uint8_t expected[] = {
+        9,    12,   0,                                      // type, len
+        7,                                                  // u8
+        0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,     // u64
+        2,    'h',  'i',                                    // string
+        0x7D, 0x6F, 0x40, 0xB6,                             // crc32
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected), s.data.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected, s.data.data(), sizeof(expected));
+}
+
+void
+test_record_round_trip()
+{
+    MemoryStream s;
+    writeSample(s);
+    writeSample(s);
+
+    RecordReader r(s);
+    for (int i = 0; i < 2; ++i)
+    {
+        TEST_ASSERT_TRUE(r.next());
+        TEST_ASSERT_EQUAL_UINT8(9, r.type());
+
+        uint8_t u8 = 0;
+        uint64_t u64 = 0;
+        String str;
+        TEST_ASSERT_TRUE(r.getU8(u8));
+        TEST_ASSERT_TRUE(r.getU64(u64));
+        TEST_ASSERT_TRUE(r.getString(str));
+        TEST_ASSERT_EQUAL_UINT8(7, u8);
+        TEST_ASSERT_EQUAL_UINT64(0x0102030405060708ull, u64);
+        TEST_ASSERT_EQUAL_STRING("hi", str.c_str());
+
+        // Reading past the payload fails instead of running into the next record.
+        TEST_ASSERT_FALSE(r.getU8(u8));
+    }
+
+    TEST_ASSERT_FALSE(r.next());
+    TEST_ASSERT_FALSE(r.corrupt());
+    TEST_ASSERT_EQUAL(s.data.size(), r.consumed());
+}
+
+void
+test_flipped_bit_is_corrupt()
+{
+    MemoryStream s;
+    writeSample(s);
+    const size_t first = s.data.size();
+    writeSample(s);
+    s.data[first + 5] ^= 0x10;
+
+    RecordReader r(s);
+    TEST_ASSERT_TRUE(r.next());
+    TEST_ASSERT_FALSE(r.next());
+    TEST_ASSERT_TRUE(r.corrupt());
+    TEST_ASSERT_EQUAL(first, r.consumed());
+
+    // Stays stopped: nothing after a bad record is trusted.
+    TEST_ASSERT_FALSE(r.next());
+}
+
+void
+test_torn_tail_stops_loading()
+{
+    MemoryStream s;
+    writeSample(s);
+    const size_t first = s.data.size();
+    writeSample(s);
+
+    for (size_t cut = first + 1; cut < s.data.size(); ++cut)
+    {
+        MemoryStream torn;
+        torn.data = s.data.substr(0, cut);
+
+        RecordReader r(torn);
+        TEST_ASSERT_TRUE(r.next());
+        TEST_ASSERT_FALSE(r.next());
+        TEST_ASSERT_TRUE(r.corrupt());
+        TEST_ASSERT_EQUAL(first, r.consumed());
+    }
+}
+
+void
+test_oversized_payload_is_refused()
+{
+    RecordWriter w(1);
+    for (size_t i = 0; i < RecordFile::MAX_PAYLOAD / 8; ++i)
+        w.putU64(i);
+    TEST_ASSERT_TRUE(w.ok());
+
+    w.putU8(0);
+    TEST_ASSERT_FALSE(w.ok());
+
+    MemoryStream s;
+    TEST_ASSERT_FALSE(w.writeTo(s));
+    TEST_ASSERT_EQUAL(0, s.data.size());
+}
+
+void
+test_overlong_string_is_refused()
+{
+    RecordWriter w(1);
+    w.putString(String(std::string(RecordFile::MAX_STRING, 'x').c_str()));
+    TEST_ASSERT_TRUE(w.ok());
+
+    w.putString(String(std::string(RecordFile::MAX_STRING + 1, 'x').c_str()));
+    TEST_ASSERT_FALSE(w.ok());
+
+    MemoryStream s;
+    TEST_ASSERT_FALSE(w.writeTo(s));
+    TEST_ASSERT_EQUAL(0, s.data.size());
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_header_round_trip);
+    RUN_TEST(test_header_rejects_other_version);
+    RUN_TEST(test_record_layout_and_crc);
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_flipped_bit_is_corrupt);
+    RUN_TEST(test_torn_tail_stops_loading);
+    RUN_TEST(test_oversized_payload_is_refused);
+    RUN_TEST(test_overlong_string_is_refused);
+    return UNITY_END();
+}
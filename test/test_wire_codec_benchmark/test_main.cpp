@@ -0,0 +1,225 @@
+// JSON against MessagePack for the documents the device exchanges most:
+// encoded size, and the time to encode and decode each. Results are printed
+// like test_benchmark's:
+//
+//   pio test -e native -f test_wire_codec_benchmark -v | grep '^BENCH ' | cut -c7-
+//
+// The documents follow PublishService's and MqttService's schemas; list
+// pages are full (32 entries). Host timings are only comparable with each
+// other; sizes match the device.
+
+#include "config/AppPaths.h"
+#include "utils/Logger.h"
+#include "utils/WireCodec.h"
+
+#include <unity.h>
+
+#include <string>
+
+namespace
+{
+constexpr size_t kIterations = 2000;
+constexpr size_t kPageItems = 32;
+constexpr size_t kDocBytes = 8192;
+
+constexpr uint64_t kTs = 1700000000ULL;
+
+// Collects an encoding, reusing its buffer between runs.
+class BufferPrint : public Print
+{
+  public:
+    size_t
+    write(uint8_t c) override
+    {
+        data_.push_back((char)c);
+        return 1;
+    }
+
+    size_t
+    write(const uint8_t* data, size_t size) override
+    {
+        data_.append((const char*)data, size);
+        return size;
+    }
+
+    void
+    clear()
+    {
+        data_.clear();
+    }
+
+    const uint8_t*
+    data() const
+    {
+        return (const uint8_t*)data_.data();
+    }
+
+    size_t
+    size() const
+    {
+        return data_.size();
+    }
+
+  private:
+    std::string data_;
+};
+
+void
+buildPasscodeAdd(JsonDocument& doc)
+{
+    doc["action"] = "add";
+    doc["type"] = "timed";
+    doc["code"] = "12345678";
+    doc["effectiveAt"] = kTs;
+    doc["expireAt"] = kTs + 86400;
+}
+
+void
+buildControl(JsonDocument& doc)
+{
+    doc["action"] = "unlock";
+}
+
+void
+buildStateEvent(JsonDocument& doc)
+{
+    doc["state"] = "unlocked";
+    doc["source"] = "device";
+    doc["method"] = "keypad";
+    doc[AppJsonKeys::TS] = kTs;
+}
+
+void
+putPageHeader(JsonDocument& doc)
+{
+    doc[AppJsonKeys::TS] = kTs;
+    doc["rev"] = 1234;
+    doc["snapshot"] = 56;
+    doc["page"] = 0;
+    doc["pages"] = 4;
+}
+
+void
+buildPasscodePage(JsonDocument& doc)
+{
+    putPageHeader(doc);
+    JsonArray items = doc.createNestedArray(AppJsonKeys::PASSCODES);
+    for (size_t i = 0; i < kPageItems; ++i)
+    {
+        char id[17];
+        const unsigned long long digest = 0x9e3779b97f4a7c15ULL * (i + 1);
+        snprintf(id, sizeof(id), "%016llx", digest);
+
+        JsonObject o = items.createNestedObject();
+        o["id"] = id;
+        o["type"] = "timed";
+        o["effectiveAt"] = kTs;
+        o["expireAt"] = kTs + 86400 * (i + 1);
+    }
+}
+
+void
+buildCardPage(JsonDocument& doc)
+{
+    putPageHeader(doc);
+    JsonArray items = doc.createNestedArray(AppJsonKeys::CARDS);
+    for (size_t i = 0; i < kPageItems; ++i)
+    {
+        char uid[9];
+        snprintf(uid, sizeof(uid), "%08X", (unsigned)(0x10000000u + i * 2654435761u));
+
+        JsonObject o = items.createNestedObject();
+        o["uid"] = uid;
+        o["name"] = "Card";
+    }
+}
+
+// Prints one line per encoding; `bytes` is the encoded size.
+void
+benchDocument(
+    const char* label, void (*build)(JsonDocument&), WireFormat format, size_t& bytes
+)
+{
+    DynamicJsonDocument doc(kDocBytes);
+    build(doc);
+
+    BufferPrint out;
+    bytes = WireCodec::encode(doc, out, format);
+    TEST_ASSERT_EQUAL(WireCodec::measure(doc, format), bytes);
+
+    unsigned long start = micros();
+    for (size_t i = 0; i < kIterations; ++i)
+    {
+        out.clear();
+        WireCodec::encode(doc, out, format);
+    }
+    const double encodeUs = (double)(micros() - start) / kIterations;
+
+    // Decoded into one document, as the inbound arena is.
+    DynamicJsonDocument decoded(kDocBytes);
+    bool ok = true;
+    start = micros();
+    for (size_t i = 0; i < kIterations; ++i)
+        ok = WireCodec::decode(out.data(), out.size(), decoded) && ok;
+    const double decodeUs = (double)(micros() - start) / kIterations;
+    TEST_ASSERT_TRUE(ok);
+
+    printf(
+        "BENCH {\"bench\":\"codec\",\"case\":\"%s\",\"format\":\"%s\",\"ops\":%u,"
+        "\"bytes\":%u,\"encodeUsPerOp\":%.3f,\"decodeUsPerOp\":%.3f}\n",
+        label, WireCodec::name(format), (unsigned)kIterations, (unsigned)bytes, encodeUs,
+        decodeUs
+    );
+}
+
+void
+compare(const char* label, void (*build)(JsonDocument&))
+{
+    size_t json = 0;
+    size_t msgpack = 0;
+    benchDocument(label, build, WireFormat::Json, json);
+    benchDocument(label, build, WireFormat::MsgPack, msgpack);
+    TEST_ASSERT_LESS_OR_EQUAL(json, msgpack);
+}
+} // namespace
+
+void
+setUp()
+{
+    Logger::setLevel(LogLevel::ERROR);
+}
+
+void
+tearDown()
+{
+}
+
+void
+bench_commands()
+{
+    compare("command.passcodeAdd", buildPasscodeAdd);
+    compare("command.control", buildControl);
+}
+
+void
+bench_events()
+{
+    compare("event.state", buildStateEvent);
+}
+
+void
+bench_list_pages()
+{
+    compare("page.passcodes", buildPasscodePage);
+    compare("page.iccards", buildCardPage);
+}
+
+int
+main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_commands);
+    RUN_TEST(bench_events);
+    RUN_TEST(bench_list_pages);
+    return UNITY_END();
+}